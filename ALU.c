@@ -8,45 +8,56 @@
 
 
 /* 
-Checks the result of ALU operations and sets the flags accordingly, which are:
+Records the operands of an addition as the source of the ALU flags, which are:
   - zero (Z): set if the result of the operation was 0,
   - negative (N): set if the result of the operation was negative
   - carry (C): set if the result of the *unsigned* operation was incorrect (only for addition and subtraction)
 */
-void set_flags(short val, int set_carry, short arg_a, short arg_b) {
-    alu_flags.zero = 0;
-    alu_flags.carry = 0;
-    alu_flags.negative = 0;
-
-    if (val == 0)
-        alu_flags.zero = 1;
-    else if (val < 0)
-        alu_flags.negative = 1;
-    
-    // If the sign of the result does not match the sign of the operands, and the operands have the same
-    // sign, then there has been an overflow
-    if (set_carry == TRUE) {
-        if (arg_a > 0 && arg_b > 0 && ((unsigned short)(arg_a + arg_b)) < 0)
-            alu_flags.carry = 1;
-        else if (arg_a < 0 && arg_b < 0 && ((unsigned short)(arg_a + arg_b)) > 0)
-            alu_flags.carry = 1;
-    }
+void set_flags(struct ALU_last_op* last_op, short arg_a, short arg_b) {
+    last_op->operand_a = arg_a;
+    last_op->operand_b = arg_b;
 }
 
 
 /*
-Takes 2 operands and outputs the sum of their values to a register, then sets the ALU flags
-appropriately.
+Works out the flags from the operands of the last addition.
 */
-void addition(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg = get_register(output_reg, registers);
-    if (output_reg < 12)
-        result_reg.word_16 = operand_a + operand_b;
+struct ALU_flags get_alu_flags(const struct ALU_last_op* last_op) {
+    struct ALU_flags flags;
+    flags.zero = last_op_zero(last_op);
+    flags.negative = last_op_negative(last_op);
+    flags.carry = last_op_carry(last_op);
+    return flags;
+}
+
+
+/**
+ * @brief Sets the flags, such as when a process is switched back in, by recording operands whose sum 
+ * gives them. Every combination an addition can give has such operands, and the others, where the zero
+ * flag is set along with another, set just the zero flag.
+ * 
+ * @param last_op The operands of the last addition, which are replaced
+ * @param flags The flags to set
+ */
+void set_alu_flags(struct ALU_last_op* last_op, struct ALU_flags flags) {
+    if (flags.zero)
+        set_flags(last_op, 0, 0);
+    else if (flags.negative)
+        set_flags(last_op, -1, flags.carry ? -1 : 0);
+    else if (flags.carry)
+        set_flags(last_op, -0x8000, -1); // wraps around to 0x7FFF
     else
-        result_reg.word_32 = (result_reg.word_32 & 0xFFFF0000) | (operand_a + operand_b & 0x0000FFFF);
+        set_flags(last_op, 1, 0);
+}
 
-    set_flags(operand_a + operand_b, TRUE, operand_a, operand_b);
-    update_register(output_reg, result_reg, registers);
+
+/*
+Takes 2 operands and outputs the sum of their values to a register, then sets the ALU flags
+appropriately.
+*/
+void addition(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers, struct ALU_last_op* last_op) {
+    write_register_lower(registers, output_reg, operand_a + operand_b);
+    set_flags(last_op, operand_a, operand_b);
 }
 
 
@@ -54,9 +65,9 @@ void addition(short operand_a, short operand_b, unsigned int output_reg, Registe
 Performs subtraction by taking the compliment of operand B and adding one, thereby getting the
 2s-compliment of operand B, which is -B, and adding it to A, because A +- B = A - B.
 */
-void subtraction(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
+void subtraction(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers, struct ALU_last_op* last_op) {
     operand_b = (~operand_b) + 1;
-    addition(operand_a, operand_b, output_reg, registers);
+    addition(operand_a, operand_b, output_reg, registers, last_op);
 }
 
 
@@ -66,14 +77,8 @@ result in the output register.
 
 Does not set ALU flags.
 */
-void left_shift(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg;
-    if (output_reg < 12)
-        result_reg.word_16 = operand_a << operand_b;
-    else
-        result_reg.word_32 = operand_a << operand_b;
-
-    update_register(output_reg, result_reg, registers);
+void left_shift(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers) {
+    write_register(registers, output_reg, operand_a << operand_b);
 }
 
 
@@ -83,14 +88,8 @@ result in the output register.
 
 Does not set ALU flags.
 */
-void arithmetic_right_shift(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg;
-    if (output_reg < 12)
-        result_reg.word_16 = operand_a >> operand_b;
-    else
-        result_reg.word_32 = operand_a >> operand_b;
-
-    update_register(output_reg, result_reg, registers);
+void arithmetic_right_shift(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers) {
+    write_register(registers, output_reg, operand_a >> operand_b);
 }
 
 
@@ -100,14 +99,8 @@ result in the output register.
 
 Does not set ALU flags.
 */
-void logical_right_shift(unsigned short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg;
-    if (output_reg < 12)
-        result_reg.word_16 = operand_a >> operand_b;
-    else
-        result_reg.word_32 = operand_a >> operand_b;
-
-    update_register(output_reg, result_reg, registers);
+void logical_right_shift(unsigned short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers) {
+    write_register(registers, output_reg, operand_a >> operand_b);
 }
 
 
@@ -116,14 +109,8 @@ Performs the logical NAND operation on the 2 inputs and places the result in the
 
 Does not set ALU flags
 */
-void logical_nand(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg;
-    if (output_reg < 12)
-        result_reg.word_16 = ~(operand_a & operand_b);
-    else
-        result_reg.word_32 = ~(operand_a & operand_b);
-
-    update_register(output_reg, result_reg, registers);
+void logical_nand(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers) {
+    write_register(registers, output_reg, ~(operand_a & operand_b));
 }
 
 
@@ -132,12 +119,6 @@ Performs the logical OR operation on the 2 inputs and places the result in the o
 
 Does not set ALU flags
 */
-void logical_or(short operand_a, short operand_b, unsigned int output_reg, Register* registers) {
-    Register result_reg;
-    if (output_reg < 12)
-        result_reg.word_16 = operand_a | operand_b;
-    else
-        result_reg.word_32 = operand_a | operand_b;
-
-    update_register(output_reg, result_reg, registers);
+void logical_or(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers) {
+    write_register(registers, output_reg, operand_a | operand_b);
 }
@@ -7,17 +7,53 @@ struct ALU_flags {
     unsigned int zero : 1;
     unsigned int negative : 1;
     unsigned int carry : 1;
-} alu_flags;
+};
 
 
-void set_flags(short val, int set_carry, short arg_a, short arg_b);
-void addition(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void subtraction(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void left_shift(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void arithmetic_right_shift(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void logical_right_shift(unsigned short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void logical_nand(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
-void logical_or(short operand_a, short operand_b, unsigned int output_reg, Register* registers);
+/*
+The flags are not worked out by the operation that sets them. Instead the ALU keeps the operands of the 
+last addition, which subtraction is done with, and the flags are worked out from them only when a branch, 
+ADDC, SUBC or a context switch reads them.
+*/
+struct ALU_last_op {
+    short operand_a;
+    short operand_b;
+};
+
+
+void set_flags(struct ALU_last_op* last_op, short arg_a, short arg_b);
+struct ALU_flags get_alu_flags(const struct ALU_last_op* last_op);
+void set_alu_flags(struct ALU_last_op* last_op, struct ALU_flags flags);
+void addition(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers, struct ALU_last_op* last_op);
+void subtraction(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers, struct ALU_last_op* last_op);
+void left_shift(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers);
+void arithmetic_right_shift(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers);
+void logical_right_shift(unsigned short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers);
+void logical_nand(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers);
+void logical_or(short operand_a, short operand_b, unsigned int output_reg, uint32_t* registers);
+
+
+// zero (Z): set if the result of the operation was 0
+static inline int last_op_zero(const struct ALU_last_op* last_op) {
+    return (short)(last_op->operand_a + last_op->operand_b) == 0;
+}
+
+
+// negative (N): set if the result of the operation was negative
+static inline int last_op_negative(const struct ALU_last_op* last_op) {
+    return (short)(last_op->operand_a + last_op->operand_b) < 0;
+}
+
+
+/*
+carry (C): set if both operands were negative and the result was not 0, which is all that is left of 
+checking whether the sign of the result does not match the sign of the operands, as the result is
+unsigned
+*/
+static inline int last_op_carry(const struct ALU_last_op* last_op) {
+    return last_op->operand_a < 0 && last_op->operand_b < 0 && 
+        (unsigned short)(last_op->operand_a + last_op->operand_b) != 0;
+}
 
 
 #endif
@@ -3,16 +3,310 @@
 #include "internal_memory.h"
 #include "registers.h"
 #include "ALU.h"
+#include "control_unit.h"
+#include "decode_cache.h"
+#include "translator.h"
 #include "os/interrupt_handler.h"
 #include "os/microkernel.h"
 
 
 /*
-Takes a 16-bit binary command and decomposes it into 4-bit sections. Extracts the opcode and operands
-from the instruction, and then executes ir appropriately, making the correct modifications to the RAM
-and registers, pointers to which are passed as parameters.
+Gets the target of a JUMP, JAL or branch from its 2 operand registers, 1 before the destination so that
+the PC lands on it once it is incremented. Only the lower register is used, as ((upper << 16) + lower) - 1
+always expanded to with the old unparenthesised register macro, and targets in the 32-bit registers are 
+not moved back.
 */
-void execute_command(short command, RAM* ram, Register* registers, Process* process, FILE* hd_img) {
+#define BRANCH_TARGET(upper_reg, lower_reg) (read_register(registers, lower_reg) - (lower_reg < 12))
+
+
+void execute_nop(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    1 + 1; // waste a clock cycle
+}
+
+
+void execute_addc(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    addition(operand_1, last_op_carry(&process->cpu->last_op), instr->reg_3, registers, &process->cpu->last_op);
+}
+
+
+void execute_subc(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    subtraction(operand_1, last_op_carry(&process->cpu->last_op), instr->reg_3, registers, &process->cpu->last_op);
+}
+
+
+void execute_jump(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    write_register_32(registers, 15, BRANCH_TARGET(instr->reg_2, instr->reg_3));
+}
+
+
+void execute_jal(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    uint32_t target = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+    write_register_32(registers, 14, read_register(registers, 15));
+    write_register_32(registers, 15, target);
+}
+
+
+void execute_cmp(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    subtraction(operand_2, operand_1, 0, registers, &process->cpu->last_op); // output to $zero
+}
+
+
+void execute_beq(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    if (last_op_zero(&process->cpu->last_op))
+        write_register_32(registers, 15, BRANCH_TARGET(instr->reg_2, instr->reg_3));
+}
+
+
+void execute_bne(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    if (!last_op_zero(&process->cpu->last_op))
+        write_register_32(registers, 15, BRANCH_TARGET(instr->reg_2, instr->reg_3));
+}
+
+
+void execute_blt(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    if (!last_op_negative(&process->cpu->last_op))
+        write_register_32(registers, 15, BRANCH_TARGET(instr->reg_2, instr->reg_3));
+}
+
+
+void execute_bgt(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    if (last_op_negative(&process->cpu->last_op))
+        write_register_32(registers, 15, BRANCH_TARGET(instr->reg_2, instr->reg_3));
+}
+
+
+void execute_syscall(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    handle_interrupt_code(instr->immediate, machine, process);
+}
+
+
+void execute_atom(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    toggle_atomic_section(machine, process->cpu);
+}
+
+
+void execute_add(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    addition(operand_1, operand_2, instr->reg_1, registers, &process->cpu->last_op);
+}
+
+
+void execute_sub(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    subtraction(operand_1, operand_2, instr->reg_1, registers, &process->cpu->last_op);
+}
+
+
+void execute_addi(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    addition(operand_1, instr->immediate, instr->reg_1, registers, &process->cpu->last_op);
+}
+
+
+void execute_subi(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    subtraction(operand_1, instr->immediate, instr->reg_1, registers, &process->cpu->last_op);
+}
+
+
+void execute_sll(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    left_shift(operand_1, operand_2, instr->reg_1, registers);
+}
+
+
+void execute_srl(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    logical_right_shift(operand_1, operand_2, instr->reg_1, registers);
+}
+
+
+void execute_sra(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    arithmetic_right_shift(operand_1, operand_2, instr->reg_1, registers);
+}
+
+
+void execute_nand(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    logical_nand(operand_1, operand_2, instr->reg_1, registers);
+}
+
+
+void execute_or(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    logical_or(operand_1, operand_2, instr->reg_1, registers);
+}
+
+
+/*
+LOAD and STORE addresses are logical addresses of the running process. Loading from a page the process 
+does not have gives 0, and storing to one does nothing.
+*/
+void execute_load(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    int upper_addr = read_register_16(registers, 11);
+    uint32_t address = translate_address(process, (upper_addr << 16) + (operand_1 + operand_2), machine);
+    int immediate = address == NO_PHYSICAL_ADDR ? 0 : get_from_ram(machine->ram, address);
+    write_register(registers, instr->reg_1, immediate);
+}
+
+
+void execute_store(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int operand_1 = read_register(registers, instr->reg_2);
+    int operand_2 = read_register(registers, instr->reg_3);
+    int upper_addr = read_register_16(registers, 11);
+    int immediate = read_register_16(registers, instr->reg_1);
+    
+    uint32_t address = translate_write_address(process, (upper_addr << 16) + (operand_1 + operand_2), machine);
+    if (address != NO_PHYSICAL_ADDR) {
+        add_to_ram(machine->ram, address, immediate);
+        invalidate_decoded_frame(machine, process->cpu, address >> PAGE_OFFSET_BITS);
+    }
+}
+
+
+void execute_movui(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int immediate = read_register(registers, instr->reg_1);
+    immediate &= 0xFFFF00FF;
+    immediate |= instr->immediate;
+    write_register(registers, instr->reg_1, immediate);
+}
+
+
+void execute_movli(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int immediate = read_register(registers, instr->reg_1);
+    immediate &= 0xFFFFFF00;
+    immediate |= instr->immediate;
+    write_register(registers, instr->reg_1, immediate);
+}
+
+
+/*
+Invalid instructions are decoded as faulting, so end the process when they are fetched and are never
+executed.
+*/
+void execute_invalid(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {}
+
+
+/*
+Moves the PC from the first to the last instruction of a superinstruction, so that the last one sees 
+the PC where it would be if the instructions were executed one at a time.
+*/
+void step_to_last_fused(const DecodedInstr* instr, uint32_t* registers) {
+    write_register_32(registers, 15, read_register(registers, 15) + instr->length - 1);
+}
+
+
+/*
+MOVUI and MOVLI into the same register, which is not the PC.
+*/
+void execute_li16(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    int immediate = read_register(registers, instr->reg_1);
+    immediate &= 0xFFFF0000;
+    immediate |= instr->immediate;
+    write_register(registers, instr->reg_1, immediate);
+    step_to_last_fused(instr, registers);
+    process->cpu->fusion_stats->executed[FUSION_LI16]++;
+}
+
+
+/*
+CMP followed by a branch, whose registers are reg_4 and reg_5.
+*/
+void execute_cmp_branch(const DecodedInstr* instr, uint32_t* registers, Process* process, short taken) {
+    if (taken)
+        write_register_32(registers, 15, BRANCH_TARGET(instr->reg_4, instr->reg_5));
+
+    process->cpu->fusion_stats->executed[FUSION_CMP_BRANCH]++;
+}
+
+
+void execute_cmp_beq(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    execute_cmp(instr, machine, registers, process);
+    step_to_last_fused(instr, registers);
+    execute_cmp_branch(instr, registers, process, last_op_zero(&process->cpu->last_op));
+}
+
+
+void execute_cmp_bne(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    execute_cmp(instr, machine, registers, process);
+    step_to_last_fused(instr, registers);
+    execute_cmp_branch(instr, registers, process, !last_op_zero(&process->cpu->last_op));
+}
+
+
+void execute_cmp_blt(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    execute_cmp(instr, machine, registers, process);
+    step_to_last_fused(instr, registers);
+    execute_cmp_branch(instr, registers, process, !last_op_negative(&process->cpu->last_op));
+}
+
+
+void execute_cmp_bgt(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    execute_cmp(instr, machine, registers, process);
+    step_to_last_fused(instr, registers);
+    execute_cmp_branch(instr, registers, process, last_op_negative(&process->cpu->last_op));
+}
+
+
+/*
+MOVUI and MOVLI into $ua followed by a LOAD or STORE, whose registers are reg_1 to reg_3. The immediate 
+is the value given to $ua.
+*/
+void execute_abs_load(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    write_register(registers, 11, (uint16_t)instr->immediate);
+    step_to_last_fused(instr, registers);
+    execute_load(instr, machine, registers, process);
+    process->cpu->fusion_stats->executed[FUSION_ABS_LOAD]++;
+}
+
+
+void execute_abs_store(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process) {
+    write_register(registers, 11, (uint16_t)instr->immediate);
+    step_to_last_fused(instr, registers);
+    execute_store(instr, machine, registers, process);
+    process->cpu->fusion_stats->executed[FUSION_ABS_STORE]++;
+}
+
+
+// handler for each operation, indexed by opcode
+const InstrHandler instr_handlers[NUM_OPCODES] = {
+    [OP_NOP] = execute_nop, [OP_ADDC] = execute_addc, [OP_SUBC] = execute_subc, [OP_JUMP] = execute_jump, 
+    [OP_JAL] = execute_jal, [OP_CMP] = execute_cmp, [OP_BEQ] = execute_beq, [OP_BNE] = execute_bne, 
+    [OP_BLT] = execute_blt, [OP_BGT] = execute_bgt, [OP_SYSCALL] = execute_syscall, [OP_ATOM] = execute_atom, 
+    [OP_ADD] = execute_add, [OP_SUB] = execute_sub, [OP_ADDI] = execute_addi, [OP_SUBI] = execute_subi, 
+    [OP_SLL] = execute_sll, [OP_SRL] = execute_srl, [OP_SRA] = execute_sra, [OP_NAND] = execute_nand, 
+    [OP_OR] = execute_or, [OP_LOAD] = execute_load, [OP_STORE] = execute_store, [OP_MOVUI] = execute_movui, 
+    [OP_MOVLI] = execute_movli, [OP_INVALID] = execute_invalid, [OP_LI16] = execute_li16, 
+    [OP_CMP_BEQ] = execute_cmp_beq, [OP_CMP_BNE] = execute_cmp_bne, [OP_CMP_BLT] = execute_cmp_blt, 
+    [OP_CMP_BGT] = execute_cmp_bgt, [OP_ABS_LOAD] = execute_abs_load, [OP_ABS_STORE] = execute_abs_store,
+};
+
+// labels of the threaded interpreter for each operation, indexed by opcode, or NULL if it is not enabled
+const void** threaded_targets = NULL;
+
+
+/*
+Takes a 16-bit binary command and decomposes it into 4-bit sections, then picks the operation for its 
+opcode and resolves its immediate, so that it can be executed any number of times without being 
+decoded again. The registers are the 2nd, 3rd and 4th nibbles, so they are always valid indices and 
+are not checked again when executed, and 0x0000 and 0xFFFF are marked as halting the process. Invalid 
+instructions and syscalls are marked as faulting, so they end the process without being executed.
+*/
+void decode_command(uint16_t command, DecodedInstr* instr) {
     // convert instruction to a bit field containing each nibble of data
     struct {
         unsigned int nibble_1 : 4;
@@ -26,226 +320,103 @@ void execute_command(short command, RAM* ram, Register* registers, Process* proc
     instr_components.nibble_3 = (command & 0x00F0) >> 4;
     instr_components.nibble_4 = command & 0x000F;
 
-    int operand_1, operand_2, operand_3;
-    int immediate, mask, upper_addr;
-    short code;
-    Register result_reg;
+    instr->reg_1 = instr_components.nibble_2;
+    instr->reg_2 = instr_components.nibble_3;
+    instr->reg_3 = instr_components.nibble_4;
+    instr->reg_4 = 0;
+    instr->reg_5 = 0;
+    instr->halts = command == 0x0000 || command == 0xFFFF ? HALT_EXIT : 0;
+    instr->length = 1;
+    instr->chains = 0;
+    instr->immediate = 0;
+    instr->opcode = OP_NOP;
 
     if (instr_components.nibble_1 == 0xF) { // 8-bit opcode
         switch (instr_components.nibble_2) {
-            case 0x0: // ADDC
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                addition(operand_1, alu_flags.carry, instr_components.nibble_4, registers);
-                break;
-            
-            case 0x1: // SUBC
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                subtraction(operand_1, alu_flags.carry, instr_components.nibble_4, registers);
-                break;
-            
-            case 0x2: // JUMP
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-                
-                update_register(15, result_reg, registers);
-                break;
-            
-            case 0x3: // JAL
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-
-                update_register(14, get_register(15, registers), registers);
-                update_register(15, result_reg, registers);
-                break;
-            
-            case 0x4: // CMP
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                subtraction(operand_2, operand_1, 0, registers); // output to $zero
-                break;
-            
-            case 0x5: // BEQ
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-
-                if (alu_flags.zero == 1)
-                    update_register(15, result_reg, registers);
-
-                break;
-            
-            case 0x6: // BNE
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-
-                if (alu_flags.zero == 0)
-                    update_register(15, result_reg, registers);
-
-                break;
-            
-            case 0x7: // BLT
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-
-                if (alu_flags.negative == 0)
-                    update_register(15, result_reg, registers);
-
-                break;
-            
-            case 0x8: // BGT
-                result_reg.word_32 = instr_components.nibble_4 < 12 ? 
-                        ((GET_REG_VAL(instr_components.nibble_3) << 16) + GET_REG_VAL(instr_components.nibble_4)) - 1 : 
-                        GET_REG_VAL(instr_components.nibble_4);
-
-                if (alu_flags.negative == 1)
-                    update_register(15, result_reg, registers);
-
-                break;
-            
-            case 0x9: // IN
-                break;
-            
-            case 0xA: // OUT
-                break;
+            case 0x0: instr->opcode = OP_ADDC; break;
+            case 0x1: instr->opcode = OP_SUBC; break;
+            case 0x2: instr->opcode = OP_JUMP; break;
+            case 0x3: instr->opcode = OP_JAL; break;
+            case 0x4: instr->opcode = OP_CMP; break;
+            case 0x5: instr->opcode = OP_BEQ; break;
+            case 0x6: instr->opcode = OP_BNE; break;
+            case 0x7: instr->opcode = OP_BLT; break;
+            case 0x8: instr->opcode = OP_BGT; break;
+            case 0x9: break; // IN
+            case 0xA: break; // OUT
             
             case 0xC: // syscall
-                code = (instr_components.nibble_3 << 4) | instr_components.nibble_4;
-                handle_interrupt_code(code, registers, ram, process, hd_img);
-                break;
-            
-            case 0xD: // ATOM
-                toggle_periodic_interrupts();
+                instr->opcode = OP_SYSCALL;
+                instr->immediate = (instr_components.nibble_3 << 4) | instr_components.nibble_4;
+                if (instr->immediate < 1 || instr->immediate > MAX_SYSCALL)
+                    instr->halts = HALT_FAULT;
                 break;
             
-            case 0xF: // HALT
-                break;
-            
-            default: 
-                break;
+            case 0xD: instr->opcode = OP_ATOM; break;
+            case 0xF: break; // HALT
+            default: break;
         }
     } else { // 4-bit opcode
         switch (instr_components.nibble_1) {
-            case 0x0: // NOP
-                1 + 1; // waste a clock cycle
-                break;
-            
-            case 0x1: // ADD
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                addition(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
-            
-            case 0x2: // SUB
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                subtraction(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
+            case 0x0: break; // NOP
+            case 0x1: instr->opcode = OP_ADD; break;
+            case 0x2: instr->opcode = OP_SUB; break;
 
             case 0x3: // ADDI
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                addition(operand_1, instr_components.nibble_4, instr_components.nibble_2, registers);
+                instr->opcode = OP_ADDI;
+                instr->immediate = instr_components.nibble_4;
                 break;
             
             case 0x4: // SUBI
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                subtraction(operand_1, instr_components.nibble_4, instr_components.nibble_2, registers);
-                break;
-            
-            case 0x5: // SLL
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                left_shift(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
-            
-            case 0x6: // SRL
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                logical_right_shift(operand_1, operand_2, instr_components.nibble_2, registers);
+                instr->opcode = OP_SUBI;
+                instr->immediate = instr_components.nibble_4;
                 break;
             
-            case 0x7: // SRA
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                arithmetic_right_shift(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
-            
-            case 0x8: // NAND
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                logical_nand(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
-            
-            case 0x9: // OR
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                logical_or(operand_1, operand_2, instr_components.nibble_2, registers);
-                break;
-            
-            case 0xA: // LOAD
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                upper_addr = get_register(11, registers).word_16;
-
-                immediate = get_from_ram(ram, (upper_addr << 16) + (operand_1 + operand_2));
-                if (instr_components.nibble_2 < 12)
-                    result_reg.word_16 = immediate;
-                else
-                    result_reg.word_32 = immediate;
-
-                update_register(instr_components.nibble_2, result_reg, registers);
-                break;
-            
-            case 0xB: // STORE
-                operand_1 = GET_REG_VAL(instr_components.nibble_3);
-                operand_2 = GET_REG_VAL(instr_components.nibble_4);
-                upper_addr = get_register(11, registers).word_16;
-                immediate = instr_components.nibble_2 < 12 ?
-                            get_register(instr_components.nibble_2, registers).word_16 : 
-                            get_register(instr_components.nibble_2, registers).word_32 & 0x0000FFFF;
-                
-                add_to_ram(ram, (upper_addr << 16) + (operand_1 + operand_2), immediate);
-
-                break;
+            case 0x5: instr->opcode = OP_SLL; break;
+            case 0x6: instr->opcode = OP_SRL; break;
+            case 0x7: instr->opcode = OP_SRA; break;
+            case 0x8: instr->opcode = OP_NAND; break;
+            case 0x9: instr->opcode = OP_OR; break;
+            case 0xA: instr->opcode = OP_LOAD; break;
+            case 0xB: instr->opcode = OP_STORE; break;
             
             case 0xC: // MOVUI
-                immediate = GET_REG_VAL(instr_components.nibble_2);
-
-                mask = 0xFFFF00FF;
-                immediate &= mask;
-                immediate |= instr_components.nibble_3 << 12;
-                immediate |= instr_components.nibble_4 << 8;
-
-                if (instr_components.nibble_2 < 12)
-                    result_reg.word_16 = immediate;
-                else
-                    result_reg.word_32 = immediate;
-
-                update_register(instr_components.nibble_2, result_reg, registers);
+                instr->opcode = OP_MOVUI;
+                instr->immediate = (instr_components.nibble_3 << 12) | (instr_components.nibble_4 << 8);
                 break;
             
             case 0xD: // MOVLI
-                immediate = GET_REG_VAL(instr_components.nibble_2);
-
-                mask = 0xFFFFFF00;
-                immediate &= mask;
-                immediate |= instr_components.nibble_3 << 4;
-                immediate |= instr_components.nibble_4;
-
-                if (instr_components.nibble_2 < 12)
-                    result_reg.word_16 = immediate;
-                else
-                    result_reg.word_32 = immediate;
-
-                update_register(instr_components.nibble_2, result_reg, registers);
+                instr->opcode = OP_MOVLI;
+                instr->immediate = (instr_components.nibble_3 << 4) | instr_components.nibble_4;
                 break;
             
             default:
-                exit(-3);
+                instr->opcode = OP_INVALID;
+                instr->halts = HALT_FAULT;
                 break;
         }
     }
+
+    set_instr_operation(instr, instr->opcode);
+}
+
+
+/*
+Sets the opcode of a decoded instruction, along with the handler and label for it.
+*/
+void set_instr_operation(DecodedInstr* instr, Opcode opcode) {
+    instr->opcode = opcode;
+    instr->handler = instr_handlers[opcode];
+    instr->target = threaded_targets == NULL ? NULL : threaded_targets[opcode];
+}
+
+
+/*
+Takes a 16-bit binary command, decodes it, and then executes it appropriately on the CPU the process is 
+running on, making the correct modifications to the machine's RAM and the CPU's registers.
+*/
+void execute_command(short command, Machine* machine, Process* process) {
+    DecodedInstr instr;
+    decode_command(command, &instr);
+    instr.handler(&instr, machine, process->cpu->registers, process);
 }
@@ -2,11 +2,58 @@
 #define CONTROL_UNIT
 
 #include <stdio.h>
+#include <stdint.h>
 #include "internal_memory.h"
 #include "registers.h"
+#include "machine.h"
 #include "os/microkernel.h"
 
-void execute_command(short command, RAM* ram, Register* registers, Process* process, FILE* hd_img);
+#define HALT_EXIT 1 // the instruction ends the process normally
+#define HALT_FAULT 2 // the instruction cannot be executed, so the process is ended with exit status -1
+
+
+/*
+The operations an instruction can decode to. IN, OUT, HALT and the unused 8-bit opcodes do nothing, so
+decode to OP_NOP. The operations after OP_INVALID are superinstructions, which the block translator fuses
+from runs of 2 or 3 instructions.
+*/
+typedef enum Opcode {
+    OP_NOP, OP_ADDC, OP_SUBC, OP_JUMP, OP_JAL, OP_CMP, OP_BEQ, OP_BNE, OP_BLT, OP_BGT, OP_SYSCALL, OP_ATOM,
+    OP_ADD, OP_SUB, OP_ADDI, OP_SUBI, OP_SLL, OP_SRL, OP_SRA, OP_NAND, OP_OR, OP_LOAD, OP_STORE, OP_MOVUI,
+    OP_MOVLI, OP_INVALID, OP_LI16, OP_CMP_BEQ, OP_CMP_BNE, OP_CMP_BLT, OP_CMP_BGT, OP_ABS_LOAD, OP_ABS_STORE,
+    NUM_OPCODES
+} Opcode;
+
+
+typedef struct DecodedInstr DecodedInstr;
+typedef void (*InstrHandler)(const DecodedInstr* instr, Machine* machine, uint32_t* registers, Process* process);
 
-#endif
 
+/**
+ * @brief An instruction that has been decoded once so that it can be executed without being decoded 
+ * again, with the handler for its opcode, its operand registers, and its immediate resolved into the 
+ * bits it sets.
+ */
+struct DecodedInstr {
+    InstrHandler handler; // NULL if the instruction has not been decoded
+    const void* target; // label of the operation in the threaded interpreter, if it is enabled
+    uint8_t opcode;
+    uint8_t reg_1; // 2nd nibble, the destination of most instructions
+    uint8_t reg_2; // 3rd nibble
+    uint8_t reg_3; // 4th nibble
+    uint8_t reg_4; // 3rd nibble of the branch of a fused compare-and-branch
+    uint8_t reg_5; // 4th nibble of the branch of a fused compare-and-branch
+    uint8_t halts; // HALT_EXIT for 0x0000 and 0xFFFF, HALT_FAULT for invalid instructions and syscalls, or 0
+    uint8_t length; // number of instructions executed, more than 1 for superinstructions
+    uint8_t chains; // 1 if the instruction after it can be run without fetching it, as it is in the same block
+    int32_t immediate;
+};
+
+
+extern const void** threaded_targets;
+
+void decode_command(uint16_t command, DecodedInstr* instr);
+void set_instr_operation(DecodedInstr* instr, Opcode opcode);
+void execute_command(short command, Machine* machine, Process* process);
+
+#endif
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "decode_cache.h"
+#include "translator.h"
+
+
+/*
+Fetched in place of the instruction at a PC the process does not have the page of, ending the process as
+an invalid instruction would rather than running whatever is at NO_PHYSICAL_ADDR.
+*/
+DecodedInstr unmapped_instr = { .opcode = OP_INVALID, .halts = HALT_FAULT, .length = 1 };
+
+
+/*
+Gives a CPU an empty decode cache, or empties the one it has, keeping the memory of its pages.
+*/
+void init_decode_cache(CPU* cpu) {
+    if (cpu->decode_cache == NULL) {
+        cpu->decode_cache = calloc(1, sizeof(DecodeCache));
+        if (cpu->decode_cache == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR DECODE CACHE!\n");
+            exit(-1);
+        }
+    }
+
+    flush_decode_cache(cpu);
+    cpu->decode_cache->hits = 0;
+    cpu->decode_cache->decodes = 0;
+    cpu->decode_cache->invalidations = 0;
+}
+
+
+/*
+Frees the decode cache of a CPU, along with the decoded instructions of each of its pages.
+*/
+void free_decode_cache(CPU* cpu) {
+    for (int i = 0; i < DECODE_CACHE_PAGES; i++) {
+        free(cpu->decode_cache->pages[i].instrs);
+    }
+
+    free(cpu->decode_cache);
+    cpu->decode_cache = NULL;
+}
+
+
+/*
+Drops every decoded page in the decode cache of a CPU, keeping its counts.
+*/
+void flush_decode_cache(CPU* cpu) {
+    for (int i = 0; i < DECODE_CACHE_PAGES; i++) {
+        cpu->decode_cache->pages[i].frame = NO_DECODED_FRAME;
+    }
+}
+
+
+/**
+ * @brief Decodes the instruction at a physical address into the cache, first taking over the cache page
+ * for its frame if another frame is held there. With block translation, the whole basic block starting
+ * at the instruction is decoded.
+ * 
+ * @param machine The machine the instruction is decoded from
+ * @param cpu The CPU whose decode cache the instruction is put in
+ * @param physical_addr The physical address of the instruction
+ * @return Pointer to the decoded instruction
+ */
+DecodedInstr* decode_into_cache(Machine* machine, CPU* cpu, uint32_t physical_addr) {
+    uint32_t frame = physical_addr >> PAGE_OFFSET_BITS;
+    DecodedPage* page = &cpu->decode_cache->pages[frame % DECODE_CACHE_PAGES];
+    if (page->frame != frame) {
+        if (page->instrs == NULL) {
+            page->instrs = malloc(sizeof(DecodedInstr) * PAGE_SIZE);
+            if (page->instrs == NULL) {
+                printf("ERROR: COULD NOT ALLOCATE MEMORY FOR DECODE CACHE!\n");
+                exit(-1);
+            }
+        }
+
+        memset(page->instrs, 0, sizeof(DecodedInstr) * PAGE_SIZE);
+        page->frame = frame;
+    }
+
+    DecodedInstr* instr = &page->instrs[physical_addr & (PAGE_SIZE - 1)];
+    if (machine->block_translation_enabled)
+        translate_block(machine, cpu, page->instrs, frame << PAGE_OFFSET_BITS, physical_addr & (PAGE_SIZE - 1));
+    else
+        decode_command(get_from_ram(machine->ram, physical_addr), instr);
+
+    cpu->decode_cache->decodes++;
+
+    return instr;
+}
+
+
+/*
+Prints how often fetched instructions were already decoded, over the decode caches of all the CPUs.
+*/
+void print_decode_cache_stats(Machine* machine) {
+    unsigned long hits = 0, decodes = 0, invalidations = 0;
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        hits += machine->cpus[i].decode_cache->hits;
+        decodes += machine->cpus[i].decode_cache->decodes;
+        invalidations += machine->cpus[i].decode_cache->invalidations;
+    }
+
+    unsigned long fetches = hits + decodes;
+    printf("Decode cache pages: %d\nHits: %lu\nDecodes: %lu\nHit rate: %.3f\nInvalidations: %lu\n",
+        DECODE_CACHE_PAGES, hits, decodes, fetches > 0 ? (double)hits / fetches : 0, invalidations);
+}
@@ -0,0 +1,158 @@
+#ifndef DECODE_CACHE
+#define DECODE_CACHE
+
+#include <stdint.h>
+#include "internal_memory.h"
+#include "machine.h"
+#include "control_unit.h"
+#include "jit.h"
+#include "os/microkernel.h"
+
+#define DECODE_CACHE_PAGES 64 // number of frames whose decoded instructions are kept at once
+#define NO_DECODED_FRAME 0xFFFFFFFF // no frame number can match this
+
+
+/*
+The decoded instructions of one frame, each decoded the first time it is fetched.
+*/
+typedef struct DecodedPage {
+    uint32_t frame; // the frame the instructions were decoded from, or NO_DECODED_FRAME
+    DecodedInstr* instrs; // PAGE_SIZE long, allocated the first time the page is used
+} DecodedPage;
+
+
+/**
+ * @brief A direct-mapped cache of decoded instructions for one CPU, keyed by physical frame so that 
+ * processes sharing a code frame share its decoded instructions too. Each frame can only be cached in the 
+ * page given by the low bits of its number. A page is invalidated whenever its frame is written to or 
+ * given to a new page by the process running on the CPU, and the whole cache is flushed when the CPU 
+ * runs a process which last ran on another CPU, whose writes it has not seen.
+ */
+typedef struct DecodeCache {
+    DecodedPage pages[DECODE_CACHE_PAGES];
+    unsigned long hits;
+    unsigned long decodes; // fetches of instructions that had to be decoded
+    unsigned long invalidations;
+} DecodeCache;
+
+
+/*
+The frame of the logical page instructions were last fetched from, and the TLB generation the PC was 
+translated in, so that fetches from the same page need not translate the PC again.
+*/
+typedef struct FetchWindow {
+    uint32_t logical_page; // TLB_INVALID_PAGE if there is no window
+    uint32_t frame;
+    unsigned long generation;
+} FetchWindow;
+
+
+extern DecodedInstr unmapped_instr;
+
+void init_decode_cache(CPU* cpu);
+void free_decode_cache(CPU* cpu);
+void flush_decode_cache(CPU* cpu);
+DecodedInstr* decode_into_cache(Machine* machine, CPU* cpu, uint32_t physical_addr);
+void print_decode_cache_stats(Machine* machine);
+
+
+/*
+Gets the decoded instruction at a physical address from the decode cache of a CPU, decoding it if it is
+not cached.
+*/
+static inline DecodedInstr* fetch_decoded(Machine* machine, CPU* cpu, uint32_t physical_addr) {
+    DecodeCache* cache = cpu->decode_cache;
+    uint32_t frame = physical_addr >> PAGE_OFFSET_BITS;
+    DecodedPage* page = &cache->pages[frame % DECODE_CACHE_PAGES];
+    if (page->frame == frame) {
+        DecodedInstr* instr = &page->instrs[physical_addr & (PAGE_SIZE - 1)];
+        if (instr->handler != NULL) {
+            cache->hits++;
+            return instr;
+        }
+    }
+
+    return decode_into_cache(machine, cpu, physical_addr);
+}
+
+
+/*
+Gets the decoded instruction at an offset in the frame of a fetch window, decoding it if it is not 
+cached.
+*/
+static inline DecodedInstr* fetch_decoded_in_window(Machine* machine, CPU* cpu, FetchWindow* window, uint32_t offset) {
+    DecodeCache* cache = cpu->decode_cache;
+    DecodedPage* page = &cache->pages[window->frame % DECODE_CACHE_PAGES];
+    if (page->frame == window->frame && page->instrs[offset].handler != NULL) {
+        cache->hits++;
+        return &page->instrs[offset];
+    }
+
+    return decode_into_cache(machine, cpu, (window->frame << PAGE_OFFSET_BITS) | offset);
+}
+
+
+/*
+Drops the decoded instructions of a frame from the decode cache of the CPU writing to it, if they are 
+cached, and any native code translated from it, as its contents have changed. The CPU is NULL when the
+frame belongs to a process which has not run yet.
+*/
+static inline void invalidate_decoded_frame(Machine* machine, CPU* cpu, uint32_t frame) {
+    DecodedPage* page = cpu == NULL ? NULL : &cpu->decode_cache->pages[frame % DECODE_CACHE_PAGES];
+    if (page != NULL && page->frame == frame) {
+        page->frame = NO_DECODED_FRAME;
+        cpu->decode_cache->invalidations++;
+    }
+
+    if (is_jit_code_frame(machine, frame))
+        invalidate_jit_frame(machine, frame);
+}
+
+
+/*
+Translates the PC to a physical address through a fetch window, as fetch_instruction does.
+*/
+static inline uint32_t translate_pc(Process* process, uint32_t pc, FetchWindow* window, Machine* machine) {
+    TLB* tlb = process->cpu->tlb;
+    if (pc >> PAGE_OFFSET_BITS == window->logical_page && window->generation == tlb->generation)
+        return (window->frame << PAGE_OFFSET_BITS) | (pc & (PAGE_SIZE - 1));
+
+    uint32_t address = translate_address(process, pc, machine);
+    if (address != NO_PHYSICAL_ADDR) {
+        window->logical_page = pc >> PAGE_OFFSET_BITS;
+        window->frame = address >> PAGE_OFFSET_BITS;
+        window->generation = tlb->generation;
+    }
+
+    return address;
+}
+
+
+/**
+ * @brief Fetches the decoded instruction at the PC from the decode cache of the CPU. While the PC stays 
+ * in the page of the window, and no translation has been invalidated since the window was made, the 
+ * instruction is found in the frame of the window without translating the PC.
+ * 
+ * @param process The running process
+ * @param cpu The CPU the process is running on
+ * @param pc The logical address of the instruction
+ * @param window The page instructions were last fetched from, updated when the PC leaves it
+ * @param machine The machine the process runs on
+ * @return Pointer to the decoded instruction, or to unmapped_instr if the process does not have the page 
+ * of the PC
+ */
+static inline DecodedInstr* fetch_instruction(Process* process, CPU* cpu, uint32_t pc, FetchWindow* window, Machine* machine) {
+    if (pc >> PAGE_OFFSET_BITS == window->logical_page && window->generation == cpu->tlb->generation)
+        return fetch_decoded_in_window(machine, cpu, window, pc & (PAGE_SIZE - 1));
+
+    uint32_t address = translate_address(process, pc, machine);
+    if (address == NO_PHYSICAL_ADDR)
+        return &unmapped_instr;
+
+    window->logical_page = pc >> PAGE_OFFSET_BITS;
+    window->frame = address >> PAGE_OFFSET_BITS;
+    window->generation = cpu->tlb->generation;
+    return fetch_decoded(machine, cpu, address);
+}
+
+#endif
@@ -1,164 +1,199 @@
 /*
-Implementing RAM as a hashmap.
+Implementing RAM behind a choice of backends.
 
 It would not be at all memory efficient to create an array 4GB in size to hold the entirety of the 
-RAM for the system. Therefore, each address in RAM which has data will be a key in a hash table with 
-a simple hashing algorithm. 
+RAM for the system. Instead, RAM is held in one of several sparse data structures, chosen when RAM is 
+initialised so that very sparse and very dense guest images can each use the fastest layout:
+  - a chained hashmap, where each bucket is a linked list of address/value pairs
+  - an open-addressing hashmap using linear probing, which grows when it gets too full
+  - a store of 4K-word frames indexed by a two-level directory, allocated when first written
 
-The hashmap contains 1024 proverbial "buckets" which each are a linked list which may be empty. 
-
-When adding a value to RAM, the item is appended to the linked list corresponding to the result of the 
-hash function when applied to its address. When removing a value, the item is removed from the 
-corresponding linked list. If the address is not in the hashmap, it will return 0.
+Whichever backend is used, reading from an address which has never been written to returns 0.
 */
 
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "internal_memory.h"
+#include "ram/ram_backends.h"
 
 #define FALSE 0
 #define TRUE  1
 
 
-static long ram_hash_capacity = -1;
-static short periodic_interrupt_enabled = TRUE;
-static short ram_is_initialised = FALSE;
+static const struct {
+    const char* name;
+    RAMBackendType type;
+    const RAMBackend* backend;
+} ram_backends[] = {
+    { "chained", RAM_CHAINED_MAP,     &chained_map_backend },
+    { "open",    RAM_OPEN_ADDRESSING, &open_addressing_backend },
+    { "frames",  RAM_FRAME_STORE,     &frame_store_backend },
+};
+
+static const int num_ram_backends = sizeof(ram_backends) / sizeof(ram_backends[0]);
 
 
-RAM* init_RAM(long hash_capacity) {
-    // Don't let RAM be initialised if hash capacity is less than 1 or ram is already initialised
-    if (hash_capacity <= 0 || ram_is_initialised == TRUE)
+/**
+ * @brief Creates a new RAM using the given backend.
+ * 
+ * @param type The data structure to hold RAM in
+ * @param capacity The initial number of buckets or slots for the hashmap backends, ignored by the frame 
+ * store
+ * @return Pointer to the new RAM
+ */
+RAM* init_RAM(RAMBackendType type, long capacity) {
+    // Don't let RAM be initialised with an unknown backend or a capacity less than 1
+    if (capacity <= 0 || type < 0 || type >= num_ram_backends)
         exit(-2);
-    
-    ram_hash_capacity = hash_capacity;
-    ram_is_initialised = TRUE;
-        
-    // pointer to the start of an array of pointers to linked lists (i.e. the buckets)
-    RAMKeyValuePair** RAM_initial_state = malloc(sizeof(RAMKeyValuePair) * hash_capacity);
-    for (unsigned long i = 0; i < hash_capacity; i++) { // initialise all buckets to null
-        RAM_initial_state[i] = NULL; 
-    } 
 
     RAM* ram = malloc(sizeof(RAM));
-    ram->buckets = RAM_initial_state;
+    if (ram == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM!\n");
+        exit(-2);
+    }
+
+    ram->type = type;
+    ram->backend = ram_backends[type].backend;
+    ram->store = ram->backend->create(capacity);
 
     return ram;
 }
 
 
-long hash_function(int input) {
-    return abs(input) % ram_hash_capacity;
+/*
+Frees the RAM and everything stored in it.
+*/
+void free_RAM(RAM* ram) {
+    ram->backend->destroy(ram->store);
+    free(ram);
 }
 
 
 /**
- * @brief Hashes the key (RAM address) passed and adds it to RAM, represented as a linked-list hashmap
+ * @brief Gets the backend with the given name, as used on the command line.
+ * 
+ * @param name The name of the backend: "chained", "open", or "frames"
+ * @param type Pointer to put the backend type into
+ * @return 0 if the name was recognised, -1 if not
+ */
+int get_ram_backend_type(const char* name, RAMBackendType* type) {
+    for (int i = 0; i < num_ram_backends; i++) {
+        if (strcmp(ram_backends[i].name, name) == 0) {
+            *type = ram_backends[i].type;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Adds the value to RAM at the given address, overwriting anything already there
  * 
  * @param ram Pointer to the system RAM
  * @param key Address to add the data to
  * @param value The data to add to RAM
  */
 void add_to_ram(RAM* ram, unsigned int key, uint16_t value) {
-    // get hash and create new element in the linked list
-    long hash = hash_function(key);
-    RAMKeyValuePair* pair = malloc(sizeof(RAMKeyValuePair));
-    pair->key = key;
-    pair->value = value;
-    pair->next = NULL;
-
-    // if the start of the new linked list, add immediately
-    if (ram->buckets[hash] == NULL)
-        ram->buckets[hash] = pair;
-    
-    // otherwise go through the linked list at that hash until you get to the end and add it there
-    else {
-        RAMKeyValuePair* current_kvp = ram->buckets[hash];
-        while (current_kvp->next != NULL) {
-            if (current_kvp->key == key) {
-                current_kvp->value = value;
-                return;
-            }
-
-            current_kvp = current_kvp->next;
-        }
-
-        // for if the end of the linked list has the same key as the new data
-        if (current_kvp->key == key) {
-            current_kvp->value = value;
-            return;
-        }
-
-        current_kvp->next = pair;
-    }
+    ram->backend->write(ram->store, key, value);
 }
 
 
 /*
-Takes a pointer to the RAM and finds the correct bucket for that key. Goes through each item in
-the corresponding linked list and returns the value of the first RAMKeyValuePair it finds with
-the correct key. 
+Takes a pointer to the RAM and returns the value at the address given by the key, or 0 if nothing has 
+been written there.
 */
 short get_from_ram(RAM* ram, unsigned int key) {
-    long hash = hash_function(key);
-    if (ram->buckets[hash] != NULL && ram->buckets[hash]->key == key)
-        return ram->buckets[hash]->value; 
-
-    else if (ram->buckets[hash] != NULL) {
-        RAMKeyValuePair* current_kvp = ram->buckets[hash];
-        if (current_kvp->key == key) // problem here or here
-            return current_kvp->value; // problem here or here
-
-        while (current_kvp->next != NULL) {
-            current_kvp = current_kvp->next;
-            if (current_kvp->key == key)
-                return current_kvp->value;
-        }
+    return ram->backend->read(ram->store, key);
+}
+
+
+/**
+ * @brief Copies a run of consecutive words out of RAM into the buffer, using the backend's block copy 
+ * if it has one.
+ * 
+ * @param ram Pointer to the system RAM
+ * @param key Address of the first word to read
+ * @param buffer Buffer to read the words into, at least len words long
+ * @param len The number of words to read
+ */
+void ram_read_block(RAM* ram, uint32_t key, uint16_t* buffer, uint32_t len) {
+    if (ram->backend->read_block != NULL) {
+        ram->backend->read_block(ram->store, key, buffer, len);
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        buffer[i] = ram->backend->read(ram->store, key + i);
     }
-    
-    printf("Could not get key %u from RAM\n", key);
-    return 0;
 }
 
 
-/*
-Iterates through each bucket in RAM and prints the contents from top to bottom.
-*/
-void print_RAM(RAM* ram) {
-    RAMKeyValuePair* current_bucket;
-    for (long i = 0; i < ram_hash_capacity; i++) {
-        if (ram->buckets[i] == NULL)
-            continue;
-        
-        current_bucket = ram->buckets[i];
-        
-        printf("Bucket %03X:\n", i);
-        do {
-            printf("    0x%08X:\t0x%04hX\n", current_bucket->key, current_bucket->value);
-            current_bucket = current_bucket->next;
-        } while (current_bucket != NULL);
-
-        printf("\n");
+/**
+ * @brief Copies a run of words from the buffer into consecutive addresses in RAM, using the backend's 
+ * block copy if it has one.
+ * 
+ * @param ram Pointer to the system RAM
+ * @param key Address to write the first word to
+ * @param buffer The words to write
+ * @param len The number of words to write
+ */
+void ram_write_block(RAM* ram, uint32_t key, const uint16_t* buffer, uint32_t len) {
+    if (ram->backend->write_block != NULL) {
+        ram->backend->write_block(ram->store, key, buffer, len);
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        ram->backend->write(ram->store, key + i, buffer[i]);
     }
 }
 
 
-void toggle_periodic_interrupts() {
-    periodic_interrupt_enabled = !periodic_interrupt_enabled;
+/**
+ * @brief Removes a run of consecutive words from RAM, giving the host memory holding them back to the 
+ * backend. The words read as 0 afterwards.
+ * 
+ * @param ram Pointer to the system RAM
+ * @param key Address of the first word to remove
+ * @param len The number of words to remove
+ */
+void ram_release_block(RAM* ram, uint32_t key, uint32_t len) {
+    ram->backend->release_block(ram->store, key, len);
 }
 
 
-short get_periodic_interrupts_enabled() {
-    return periodic_interrupt_enabled;
+/*
+Fills the stats struct with the load factor and probe lengths of the RAM backend.
+*/
+void get_RAM_stats(RAM* ram, RAMStats* stats) {
+    memset(stats, 0, sizeof(RAMStats));
+    ram->backend->get_stats(ram->store, stats);
 }
 
 
 /*
-Resets static variable `ram_is_initialised` to 0 (aka. FALSE).
+Prints the load factor and probe lengths of the RAM backend.
+*/
+void print_RAM_stats(RAM* ram) {
+    RAMStats stats;
+    get_RAM_stats(ram, &stats);
+
+    printf("RAM backend: %s\n", ram->backend->name);
+    printf("Entries: %lu\nCapacity: %lu\nLoad factor: %.3f\n", 
+        stats.entries, stats.capacity, stats.load_factor);
+    printf("Mean probe length: %.3f\nMax probe length: %lu\nHost bytes: %lu\n", 
+        stats.mean_probe_length, stats.max_probe_length, stats.host_bytes);
+}
 
-WARNING: FOR TESTING PURPOSES ONLY!
+
+/*
+Prints every word held in RAM.
 */
-void reset_RAM() {
-    ram_is_initialised = FALSE;
+void print_RAM(RAM* ram) {
+    ram->backend->print(ram->store);
 }
@@ -3,34 +3,71 @@
 
 #include <stdint.h>
 
+#define RAM_FRAME_BITS 12
+#define RAM_FRAME_SIZE (1 << RAM_FRAME_BITS) // 4K words per frame
+
+
+/*
+The data structures which can be used to store the contents of RAM, chosen when it is initialised.
+*/
+typedef enum RAMBackendType {
+    RAM_CHAINED_MAP,
+    RAM_OPEN_ADDRESSING,
+    RAM_FRAME_STORE
+} RAMBackendType;
+
 
 /*
-Represents a node in a linked list in the RAM hashmap data structure.
+Occupancy figures reported by a RAM backend, used to pick the best backend for a workload.
 */
-typedef struct RAMKeyValuePair {
-    int key;
-    short value;
-    struct RAMKeyValuePair* next;
-} RAMKeyValuePair;
+typedef struct RAMStats {
+    unsigned long entries;       // number of words held by the backend
+    unsigned long capacity;      // number of words the backend can hold before growing
+    double load_factor;          // entries / capacity
+    double mean_probe_length;    // mean number of slots or nodes visited to find a stored word
+    unsigned long max_probe_length;
+    unsigned long host_bytes;    // host memory used by the backend
+} RAMStats;
 
 
 /*
-A type representing the hashmap which represents RAM.
+Table of operations implemented by each RAM backend. The `store` passed to each is the pointer 
+returned by `create`. Backends without block operations have them done one word at a time.
+*/
+typedef struct RAMBackend {
+    const char* name;
+    void* (*create)(long capacity);
+    void (*destroy)(void* store);
+    void (*write)(void* store, uint32_t key, uint16_t value);
+    uint16_t (*read)(void* store, uint32_t key);
+    void (*read_block)(void* store, uint32_t key, uint16_t* buffer, uint32_t len);         // optional
+    void (*write_block)(void* store, uint32_t key, const uint16_t* buffer, uint32_t len);  // optional
+    void (*release_block)(void* store, uint32_t key, uint32_t len);
+    void (*get_stats)(void* store, RAMStats* stats);
+    void (*print)(void* store);
+} RAMBackend;
 
-Contains proverbial "buckets" which may contain 0, 1, or more items corresponding to values at
-addresses in memory represented as a linked list.
+
+/*
+A type representing the system RAM: the backend in use and its private state.
 */
 typedef struct RAM {
-    RAMKeyValuePair** buckets;
+    const RAMBackend* backend;
+    RAMBackendType type;
+    void* store;
 } RAM;
 
 
-RAM* init_RAM(long hash_capacity);
+RAM* init_RAM(RAMBackendType type, long capacity);
+void free_RAM(RAM* ram);
+int get_ram_backend_type(const char* name, RAMBackendType* type);
 void add_to_ram(RAM* ram, unsigned int key, uint16_t value);
 short get_from_ram(RAM* ram, unsigned int key);
-void reset_RAM();
+void ram_read_block(RAM* ram, uint32_t key, uint16_t* buffer, uint32_t len);
+void ram_write_block(RAM* ram, uint32_t key, const uint16_t* buffer, uint32_t len);
+void ram_release_block(RAM* ram, uint32_t key, uint32_t len);
+void get_RAM_stats(RAM* ram, RAMStats* stats);
+void print_RAM_stats(RAM* ram);
 void print_RAM(RAM* ram);
-void toggle_periodic_interrupts();
-short get_periodic_interrupts_enabled();
 
 #endif
@@ -0,0 +1,839 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "jit.h"
+#include "ALU.h"
+#include "control_unit.h"
+#include "decode_cache.h"
+#include "translator.h"
+
+#ifdef JIT_SUPPORTED
+#include <sys/mman.h>
+#endif
+
+
+#ifdef JIT_SUPPORTED
+
+#define JIT_CODE_SIZE (8 * 1024 * 1024) // bytes of native code kept before it is all thrown away
+#define JIT_MAX_BLOCK_LEN 64 // the most instructions translated into one block
+#define JIT_MAX_BLOCK_BYTES 8192 // the most native code a block can take
+#define JIT_TABLE_SIZE 16384 // number of blocks that can be found by their address at once
+#define JIT_MAX_CHAIN_SITES 65536
+#define JIT_NO_SITE 0xFFFFFFFF // the last block exited without reaching a chain site
+#define JIT_BAILED 0xFFFFFFFE // the last block did not fit in what was left of the burst
+
+// host registers, as numbered in ModRM bytes
+#define EAX 0
+#define ECX 1
+#define EDX 2
+#define ESI 6
+
+#define CTX_REG(index) ((index) * 4)
+#define CTX_FIELD(field) ((int)offsetof(JITContext, field))
+
+
+/*
+The state of a process while it is run by native code, which is addressed through rbx. Every field is
+within 128 bytes of the start so that it can be reached with an 8-bit displacement.
+*/
+typedef struct JITContext {
+    uint32_t regs[NUM_REGISTERS]; // laid out like the register file
+    uint32_t executed;
+    uint32_t burst_len;
+    uint32_t exit_site; // chain site the last block exited through
+    int16_t operand_a; // the operands of the last addition, which the flags are worked out from
+    int16_t operand_b;
+    uint8_t interrupts; // whether the burst may end, copied from the periodic interrupt flag
+    Machine* machine;
+    Process* process;
+} JITContext;
+
+
+/*
+A translated block, found by the physical address of its first instruction.
+*/
+typedef struct JITBlock {
+    uint32_t physical_addr;
+    const uint8_t* code; // NULL if the entry is empty
+} JITBlock;
+
+
+/*
+An exit of a block that can be patched to jump straight to the block for the PC it leaves with, as long
+as the PC is the same as when it was patched.
+*/
+typedef struct JITChainSite {
+    uint8_t* pc; // the immediate the PC is compared with
+    uint8_t* jump; // the displacement of the jump to the next block, 0 to exit instead
+} JITChainSite;
+
+
+/*
+Counts of the work done by the JIT, for --decode-stats.
+*/
+typedef struct JITStats {
+    unsigned long blocks;
+    unsigned long chains;
+    unsigned long flushes;
+    unsigned long invalidations;
+    unsigned long interpreted;
+    unsigned long instrs;
+} JITStats;
+
+
+/*
+The native code of one machine, along with the tables to find and chain its blocks.
+*/
+struct JITState {
+    Machine* machine; // the machine the code is translated from
+    uint8_t* code; // executable buffer, starting with the entry and exit code
+    uint8_t* free_code; // where the next block is written
+    uint8_t* first_block;
+    uint8_t* exit_code;
+    void (*enter)(JITContext* ctx, const uint8_t* block);
+    JITBlock blocks[JIT_TABLE_SIZE];
+    JITChainSite sites[JIT_MAX_CHAIN_SITES];
+    uint32_t num_sites;
+    uint32_t patched[JIT_MAX_CHAIN_SITES]; // sites that jump to another block
+    uint32_t num_patched;
+    unsigned long generation; // TLB generation the patched sites were made in
+    size_t frames_len; // length of the frame bitmap in bytes
+    JITStats stats;
+};
+
+
+// the short jumps past the taken path of BEQ, BNE, BLT and BGT: jne, je, js and jns
+static const uint8_t branch_not_taken[4] = { 0x75, 0x74, 0x78, 0x79 };
+
+
+static void emit_byte(JITState* jit, uint8_t byte) {
+    *jit->free_code++ = byte;
+}
+
+
+static void emit_u32(JITState* jit, uint32_t value) {
+    memcpy(jit->free_code, &value, 4);
+    jit->free_code += 4;
+}
+
+
+static void emit_u64(JITState* jit, uint64_t value) {
+    memcpy(jit->free_code, &value, 8);
+    jit->free_code += 8;
+}
+
+
+// ModRM byte and displacement for [rbx + disp8]
+static void emit_ctx_addr(JITState* jit, int reg, int disp) {
+    emit_byte(jit, 0x43 | (reg << 3));
+    emit_byte(jit, disp);
+}
+
+
+// ModRM byte for a register to register operation
+static void emit_reg_reg(JITState* jit, int reg, int rm) {
+    emit_byte(jit, 0xC0 | (reg << 3) | rm);
+}
+
+
+/*
+Emits a short conditional or unconditional jump to code that has not been written yet, returning where
+its displacement goes.
+*/
+static uint8_t* emit_jump_forward(JITState* jit, uint8_t opcode) {
+    emit_byte(jit, opcode);
+    emit_byte(jit, 0);
+    return jit->free_code - 1;
+}
+
+
+// points a jump from emit_jump_forward at the next byte to be written
+static void land_jump(JITState* jit, uint8_t* displacement) {
+    *displacement = jit->free_code - (displacement + 1);
+}
+
+
+static void emit_jump_to(JITState* jit, const uint8_t* target) {
+    emit_byte(jit, 0xE9);
+    emit_u32(jit, target - (jit->free_code + 4));
+}
+
+
+/*
+Loads the whole value of a register into a host register. The PC in the context is the address of the
+first instruction of the block, so the offset of the instruction is added to it.
+*/
+static void emit_load_reg(JITState* jit, int host, int reg, uint32_t pc_offset) {
+    emit_byte(jit, 0x8B);
+    emit_ctx_addr(jit, host, CTX_REG(reg));
+    if (reg == 15 && pc_offset != 0) {
+        emit_byte(jit, 0x81);
+        emit_reg_reg(jit, 0, host);
+        emit_u32(jit, pc_offset);
+    }
+}
+
+
+// loads the lower 16 bits of a register, sign extended as the ALU takes its operands
+static void emit_load_operand(JITState* jit, int host, int reg, uint32_t pc_offset) {
+    if (reg == 15 && pc_offset != 0) {
+        emit_load_reg(jit, host, reg, pc_offset);
+        emit_byte(jit, 0x0F); emit_byte(jit, 0xBF); emit_reg_reg(jit, host, host);
+    } else {
+        emit_byte(jit, 0x0F); emit_byte(jit, 0xBF); emit_ctx_addr(jit, host, CTX_REG(reg));
+    }
+}
+
+
+// negates the 16-bit operand in a host register, as subtraction does
+static void emit_negate_operand(JITState* jit, int host) {
+    emit_byte(jit, 0xF7); emit_reg_reg(jit, 3, host);
+    emit_byte(jit, 0x0F); emit_byte(jit, 0xBF); emit_reg_reg(jit, host, host);
+}
+
+
+// writes eax to a register, truncated to 16 bits for the 16-bit registers, ignoring writes to $zero
+static void emit_set_reg(JITState* jit, int reg) {
+    if (reg == 0)
+        return;
+
+    if (reg < 12) {
+        emit_byte(jit, 0x0F); emit_byte(jit, 0xB7); emit_reg_reg(jit, EAX, EAX);
+    }
+
+    emit_byte(jit, 0x89);
+    emit_ctx_addr(jit, EAX, CTX_REG(reg));
+}
+
+
+/*
+Adds ecx to eax in the same way as addition, writing the lower 16 bits of the sum to the output register
+and keeping the operands for the flags.
+*/
+static void emit_addition(JITState* jit, int output_reg) {
+    emit_byte(jit, 0x66); emit_byte(jit, 0x89); emit_ctx_addr(jit, EAX, CTX_FIELD(operand_a));
+    emit_byte(jit, 0x66); emit_byte(jit, 0x89); emit_ctx_addr(jit, ECX, CTX_FIELD(operand_b));
+    emit_byte(jit, 0x01); emit_reg_reg(jit, ECX, EAX); // add eax, ecx
+
+    if (output_reg >= 12) {
+        emit_byte(jit, 0x66); emit_byte(jit, 0x89); emit_ctx_addr(jit, EAX, CTX_REG(output_reg));
+    } else {
+        emit_set_reg(jit, output_reg);
+    }
+}
+
+
+/*
+Works out the carry flag from the operands of the last addition into ecx. The carry is only ever set when
+both operands are negative and the sum is not 0.
+*/
+static void emit_carry_flag(JITState* jit) {
+    emit_byte(jit, 0x0F); emit_byte(jit, 0xBF); emit_ctx_addr(jit, EAX, CTX_FIELD(operand_a)); // movsx eax
+    emit_byte(jit, 0x0F); emit_byte(jit, 0xBF); emit_ctx_addr(jit, ECX, CTX_FIELD(operand_b)); // movsx ecx
+    emit_byte(jit, 0x89); emit_reg_reg(jit, EAX, EDX); // mov edx, eax
+    emit_byte(jit, 0x21); emit_reg_reg(jit, ECX, EDX); // and edx, ecx
+    emit_byte(jit, 0xC1); emit_reg_reg(jit, 5, EDX); emit_byte(jit, 31); // shr edx, 31
+    emit_byte(jit, 0x01); emit_reg_reg(jit, ECX, EAX); // add eax, ecx
+    emit_byte(jit, 0x66); emit_byte(jit, 0x85); emit_reg_reg(jit, EAX, EAX); // test ax, ax
+    emit_byte(jit, 0x0F); emit_byte(jit, 0x95); emit_reg_reg(jit, 0, ECX); // setne cl
+    emit_byte(jit, 0x0F); emit_byte(jit, 0xB6); emit_reg_reg(jit, ECX, ECX); // movzx ecx, cl
+    emit_byte(jit, 0x21); emit_reg_reg(jit, EDX, ECX); // and ecx, edx
+}
+
+
+// puts the logical address of a LOAD or STORE in esi
+static void emit_memory_address(JITState* jit, const DecodedInstr* instr, uint32_t pc_offset) {
+    emit_load_reg(jit, EAX, 11, pc_offset);
+    emit_byte(jit, 0xC1); emit_reg_reg(jit, 4, EAX); emit_byte(jit, 16); // shl eax, 16
+    emit_load_reg(jit, ECX, instr->reg_2, pc_offset);
+    emit_byte(jit, 0x01); emit_reg_reg(jit, ECX, EAX);
+    emit_load_reg(jit, ECX, instr->reg_3, pc_offset);
+    emit_byte(jit, 0x01); emit_reg_reg(jit, ECX, EAX);
+    emit_byte(jit, 0x89); emit_reg_reg(jit, EAX, ESI);
+}
+
+
+// calls a helper with the context as its first argument
+static void emit_call(JITState* jit, const void* helper) {
+    emit_byte(jit, 0x48); emit_byte(jit, 0x89); emit_reg_reg(jit, 3, 7); // mov rdi, rbx
+    emit_byte(jit, 0x48); emit_byte(jit, 0xB8); emit_u64(jit, (uint64_t)(uintptr_t)helper); // mov rax, helper
+    emit_byte(jit, 0xFF); emit_reg_reg(jit, 2, EAX); // call rax
+}
+
+
+// puts the PC a JUMP, JAL or taken branch leaves with in eax, which is 1 after BRANCH_TARGET
+static void emit_branch_target(JITState* jit, const DecodedInstr* instr, uint32_t pc_offset) {
+    emit_load_reg(jit, EAX, instr->reg_3, pc_offset);
+    if (instr->reg_3 >= 12) {
+        emit_byte(jit, 0x83); emit_reg_reg(jit, 0, EAX); emit_byte(jit, 1);
+    }
+}
+
+
+/*
+Emits an exit from a block, with the PC it leaves with already in the context. If the burst has not
+ended, it jumps straight to the next block once the site has been patched for the PC, and otherwise
+returns to run_jit_burst.
+*/
+static void emit_exit(JITState* jit) {
+    uint32_t site = jit->num_sites++;
+
+    emit_byte(jit, 0x8B); emit_ctx_addr(jit, EAX, CTX_FIELD(executed));
+    emit_byte(jit, 0x3B); emit_ctx_addr(jit, EAX, CTX_FIELD(burst_len));
+    uint8_t* in_burst = emit_jump_forward(jit, 0x76); // jbe
+    emit_byte(jit, 0x80); emit_ctx_addr(jit, 7, CTX_FIELD(interrupts)); emit_byte(jit, 0);
+    uint8_t* burst_ended = emit_jump_forward(jit, 0x75); // jne
+
+    land_jump(jit, in_burst);
+    emit_byte(jit, 0x81); emit_ctx_addr(jit, 7, CTX_REG(15));
+    jit->sites[site].pc = jit->free_code;
+    emit_u32(jit, 0);
+    uint8_t* other_pc = emit_jump_forward(jit, 0x75);
+    emit_byte(jit, 0xE9);
+    jit->sites[site].jump = jit->free_code;
+    emit_u32(jit, 0);
+
+    land_jump(jit, burst_ended);
+    land_jump(jit, other_pc);
+    emit_byte(jit, 0xC7); emit_ctx_addr(jit, 0, CTX_FIELD(exit_site)); emit_u32(jit, site);
+    emit_jump_to(jit, jit->exit_code);
+}
+
+
+// emits an exit after the PC has been moved on by the given number of instructions
+static void emit_exit_after(JITState* jit, uint32_t num_instrs) {
+    emit_byte(jit, 0x81); emit_ctx_addr(jit, 0, CTX_REG(15)); emit_u32(jit, num_instrs);
+    emit_exit(jit);
+}
+
+
+/*
+Emits the start of a block, which returns to run_jit_burst without running the block if the burst would
+end before the last instruction of the block, and otherwise counts the instructions of the block.
+*/
+static void emit_block_entry(JITState* jit, uint32_t len) {
+    emit_byte(jit, 0x8B); emit_ctx_addr(jit, EAX, CTX_FIELD(executed));
+    emit_byte(jit, 0x05); emit_u32(jit, len - 1); // add eax, len - 1
+    emit_byte(jit, 0x3B); emit_ctx_addr(jit, EAX, CTX_FIELD(burst_len));
+    uint8_t* fits = emit_jump_forward(jit, 0x76);
+    emit_byte(jit, 0x80); emit_ctx_addr(jit, 7, CTX_FIELD(interrupts)); emit_byte(jit, 0);
+    uint8_t* cannot_end = emit_jump_forward(jit, 0x74);
+    emit_byte(jit, 0xC7); emit_ctx_addr(jit, 0, CTX_FIELD(exit_site)); emit_u32(jit, JIT_BAILED);
+    emit_jump_to(jit, jit->exit_code);
+
+    land_jump(jit, fits);
+    land_jump(jit, cannot_end);
+    emit_byte(jit, 0x83); emit_reg_reg(jit, 0, EAX); emit_byte(jit, 1);
+    emit_byte(jit, 0x89); emit_ctx_addr(jit, EAX, CTX_FIELD(executed));
+}
+
+
+/*
+LOAD and STORE go through the MMU of the process like the handlers in the control unit. Either can
+change the translations of the process, so the chains are checked afterwards.
+*/
+static void check_jit_chains(JITState* jit);
+
+static int jit_load(JITContext* ctx, uint32_t logical_addr) {
+    uint32_t address = translate_address(ctx->process, logical_addr, ctx->machine);
+    int value = address == NO_PHYSICAL_ADDR ? 0 : get_from_ram(ctx->machine->ram, address);
+    check_jit_chains(ctx->machine->jit);
+    return value;
+}
+
+
+static void jit_store(JITContext* ctx, uint32_t logical_addr, uint32_t value) {
+    uint32_t address = translate_write_address(ctx->process, logical_addr, ctx->machine);
+    if (address != NO_PHYSICAL_ADDR) {
+        add_to_ram(ctx->machine->ram, address, value);
+        invalidate_decoded_frame(ctx->machine, ctx->process->cpu, address >> PAGE_OFFSET_BITS);
+    }
+
+    check_jit_chains(ctx->machine->jit);
+}
+
+
+/*
+Emits the native code for an instruction at an offset in its block. Instructions that end the block
+emit its exits as well.
+*/
+static void emit_instr(JITState* jit, const DecodedInstr* instr, uint32_t pc_offset) {
+    uint8_t* not_taken;
+    switch (instr->opcode) {
+        case OP_NOP:
+            break;
+
+        case OP_ADDC:
+        case OP_SUBC:
+            emit_carry_flag(jit);
+            emit_load_operand(jit, EAX, instr->reg_2, pc_offset);
+            if (instr->opcode == OP_SUBC)
+                emit_negate_operand(jit, ECX);
+            emit_addition(jit, instr->reg_3);
+            break;
+
+        case OP_JUMP:
+        case OP_JAL:
+            emit_branch_target(jit, instr, pc_offset);
+            if (instr->opcode == OP_JAL) {
+                emit_load_reg(jit, ECX, 15, pc_offset);
+                emit_byte(jit, 0x89); emit_ctx_addr(jit, ECX, CTX_REG(14));
+            }
+
+            emit_byte(jit, 0x89); emit_ctx_addr(jit, EAX, CTX_REG(15));
+            emit_exit(jit);
+            break;
+
+        case OP_CMP:
+            emit_load_operand(jit, EAX, instr->reg_3, pc_offset);
+            emit_load_operand(jit, ECX, instr->reg_2, pc_offset);
+            emit_negate_operand(jit, ECX);
+            emit_addition(jit, 0); // output to $zero
+            break;
+
+        case OP_BEQ:
+        case OP_BNE:
+        case OP_BLT:
+        case OP_BGT:
+            // the last addition is done again in 16 bits to set the host's zero and sign flags from it
+            emit_byte(jit, 0x66); emit_byte(jit, 0x8B); emit_ctx_addr(jit, EAX, CTX_FIELD(operand_a)); // mov ax
+            emit_byte(jit, 0x66); emit_byte(jit, 0x03); emit_ctx_addr(jit, EAX, CTX_FIELD(operand_b)); // add ax
+
+            // BEQ and BNE test the zero flag, BLT is taken if the negative flag is clear and BGT if it is set
+            not_taken = emit_jump_forward(jit, branch_not_taken[instr->opcode - OP_BEQ]);
+
+            emit_branch_target(jit, instr, pc_offset);
+            emit_byte(jit, 0x89); emit_ctx_addr(jit, EAX, CTX_REG(15));
+            emit_exit(jit);
+
+            land_jump(jit, not_taken);
+            emit_exit_after(jit, pc_offset + 1);
+            break;
+
+        case OP_ADD:
+        case OP_SUB:
+            emit_load_operand(jit, EAX, instr->reg_2, pc_offset);
+            emit_load_operand(jit, ECX, instr->reg_3, pc_offset);
+            if (instr->opcode == OP_SUB)
+                emit_negate_operand(jit, ECX);
+            emit_addition(jit, instr->reg_1);
+            break;
+
+        case OP_ADDI:
+        case OP_SUBI:
+            emit_load_operand(jit, EAX, instr->reg_2, pc_offset);
+            emit_byte(jit, 0xB8 + ECX);
+            emit_u32(jit, instr->opcode == OP_SUBI ? -instr->immediate : instr->immediate);
+            emit_addition(jit, instr->reg_1);
+            break;
+
+        case OP_SLL:
+        case OP_SRL:
+        case OP_SRA:
+            emit_load_operand(jit, EAX, instr->reg_2, pc_offset);
+            if (instr->opcode == OP_SRL) {
+                emit_byte(jit, 0x0F); emit_byte(jit, 0xB7); emit_reg_reg(jit, EAX, EAX);
+            }
+
+            emit_load_operand(jit, ECX, instr->reg_3, pc_offset);
+            emit_byte(jit, 0xD3);
+            emit_reg_reg(jit, instr->opcode == OP_SLL ? 4 : instr->opcode == OP_SRL ? 5 : 7, EAX);
+            emit_set_reg(jit, instr->reg_1);
+            break;
+
+        case OP_NAND:
+        case OP_OR:
+            emit_load_operand(jit, EAX, instr->reg_2, pc_offset);
+            emit_load_operand(jit, ECX, instr->reg_3, pc_offset);
+            if (instr->opcode == OP_NAND) {
+                emit_byte(jit, 0x21); emit_reg_reg(jit, ECX, EAX);
+                emit_byte(jit, 0xF7); emit_reg_reg(jit, 2, EAX);
+            } else {
+                emit_byte(jit, 0x09); emit_reg_reg(jit, ECX, EAX);
+            }
+
+            emit_set_reg(jit, instr->reg_1);
+            break;
+
+        case OP_LOAD:
+            emit_memory_address(jit, instr, pc_offset);
+            emit_call(jit, jit_load);
+            emit_set_reg(jit, instr->reg_1);
+            break;
+
+        case OP_STORE:
+            emit_memory_address(jit, instr, pc_offset);
+            emit_load_reg(jit, EDX, instr->reg_1, pc_offset);
+            emit_byte(jit, 0x0F); emit_byte(jit, 0xB7); emit_reg_reg(jit, EDX, EDX);
+            emit_call(jit, jit_store);
+            break;
+
+        case OP_MOVUI:
+        case OP_MOVLI:
+            emit_load_reg(jit, EAX, instr->reg_1, pc_offset);
+            emit_byte(jit, 0x25); emit_u32(jit, instr->opcode == OP_MOVUI ? 0xFFFF00FF : 0xFFFFFF00);
+            emit_byte(jit, 0x0D); emit_u32(jit, instr->immediate);
+            emit_set_reg(jit, instr->reg_1);
+            break;
+
+        default:
+            printf("ERROR: OPCODE %d CANNOT BE TRANSLATED!\n", instr->opcode);
+            exit(-1);
+    }
+}
+
+
+/*
+Checks whether an instruction can be run as native code. Syscalls, ATOM and invalid instructions are
+left to the interpreter, and halts to run_jit_burst.
+*/
+static int can_translate(const DecodedInstr* instr) {
+    return !instr->halts && instr->opcode != OP_SYSCALL && instr->opcode != OP_ATOM && instr->opcode != OP_INVALID;
+}
+
+
+/*
+Checks whether an instruction is the last of a block. Stores end blocks as they may overwrite the code
+after them.
+*/
+static int ends_jit_block(const DecodedInstr* instr) {
+    switch (instr->opcode) {
+        case OP_JUMP: case OP_JAL: case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGT: case OP_STORE:
+            return 1;
+
+        default:
+            return writes_pc(instr);
+    }
+}
+
+
+/*
+Throws away all the native code, once the buffer or the chain sites are used up.
+*/
+static void flush_jit(JITState* jit) {
+    jit->free_code = jit->first_block;
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+    memset(jit->machine->jit_code_frames, 0, jit->frames_len);
+    jit->num_sites = 0;
+    jit->num_patched = 0;
+    jit->stats.flushes++;
+}
+
+
+/**
+ * @brief Translates the basic block starting at a physical address into native code, which runs up to
+ * and including the first jump, branch, store or write to the PC, and stops before any instruction that
+ * has to be interpreted, or at the end of the page.
+ *
+ * @param jit The native code of the machine
+ * @param physical_addr The physical address of the first instruction
+ * @return The native code of the block, or NULL if the first instruction has to be interpreted
+ */
+static const uint8_t* translate_jit_block(JITState* jit, uint32_t physical_addr) {
+    DecodedInstr instrs[JIT_MAX_BLOCK_LEN];
+    uint32_t page_left = PAGE_SIZE - (physical_addr & (PAGE_SIZE - 1));
+    uint32_t len = 0;
+    while (len < JIT_MAX_BLOCK_LEN && len < page_left) {
+        decode_command(get_from_ram(jit->machine->ram, physical_addr + len), &instrs[len]);
+        if (!can_translate(&instrs[len]))
+            break;
+        if (ends_jit_block(&instrs[len++]))
+            break;
+    }
+
+    if (len == 0)
+        return NULL;
+
+    if (jit->free_code + JIT_MAX_BLOCK_BYTES > jit->code + JIT_CODE_SIZE || jit->num_sites + 2 > JIT_MAX_CHAIN_SITES)
+        flush_jit(jit);
+
+    const uint8_t* block = jit->free_code;
+    emit_block_entry(jit, len);
+    for (uint32_t i = 0; i < len; i++) {
+        emit_instr(jit, &instrs[i], i);
+    }
+
+    // jumps and branches emit their own exits
+    const DecodedInstr* last = &instrs[len - 1];
+    if (last->opcode < OP_JUMP || last->opcode > OP_BGT || last->opcode == OP_CMP)
+        emit_exit_after(jit, writes_pc(last) ? 1 : len);
+
+    uint32_t frame = physical_addr >> PAGE_OFFSET_BITS;
+    jit->machine->jit_code_frames[frame >> 3] |= 1 << (frame & 7);
+    jit->stats.blocks++;
+
+    return block;
+}
+
+
+/*
+Unpatches every chain site, so that all blocks exit to run_jit_burst.
+*/
+static void unchain_jit_blocks(JITState* jit) {
+    for (uint32_t i = 0; i < jit->num_patched; i++) {
+        memset(jit->sites[jit->patched[i]].jump, 0, 4);
+    }
+
+    jit->num_patched = 0;
+}
+
+
+/*
+Chains skip translating the PC, so they are only kept while the TLB generation they were made in lasts.
+The JIT only runs with one CPU, so the TLB is always that of the first.
+*/
+static void check_jit_chains(JITState* jit) {
+    if (jit->generation != jit->machine->cpus[0].tlb->generation) {
+        unchain_jit_blocks(jit);
+        jit->generation = jit->machine->cpus[0].tlb->generation;
+    }
+}
+
+
+/*
+Patches a chain site to jump straight to a block whenever it is left with the given PC.
+*/
+static void chain_jit_site(JITState* jit, uint32_t site, uint32_t pc, const uint8_t* block) {
+    if (jit->num_patched == JIT_MAX_CHAIN_SITES)
+        unchain_jit_blocks(jit);
+
+    memcpy(jit->sites[site].pc, &pc, 4);
+    int32_t displacement = block - (jit->sites[site].jump + 4);
+    memcpy(jit->sites[site].jump, &displacement, 4);
+    jit->patched[jit->num_patched++] = site;
+    jit->stats.chains++;
+}
+
+
+/*
+Gets the native code of the block at a physical address, translating it if it has not been.
+*/
+static const uint8_t* get_jit_block(JITState* jit, uint32_t physical_addr) {
+    JITBlock* entry = &jit->blocks[(physical_addr ^ (physical_addr >> 14)) & (JIT_TABLE_SIZE - 1)];
+    if (entry->code != NULL && entry->physical_addr == physical_addr)
+        return entry->code;
+
+    const uint8_t* block = translate_jit_block(jit, physical_addr);
+    if (block != NULL) {
+        entry->physical_addr = physical_addr;
+        entry->code = block;
+    }
+
+    return block;
+}
+
+
+static void load_jit_registers(JITContext* ctx, CPU* cpu) {
+    memcpy(ctx->regs, cpu->registers, NUM_REGISTERS * sizeof(uint32_t));
+
+    ctx->operand_a = cpu->last_op.operand_a;
+    ctx->operand_b = cpu->last_op.operand_b;
+}
+
+
+static void store_jit_registers(JITContext* ctx, CPU* cpu) {
+    memcpy(cpu->registers, ctx->regs, NUM_REGISTERS * sizeof(uint32_t));
+
+    cpu->last_op.operand_a = ctx->operand_a;
+    cpu->last_op.operand_b = ctx->operand_b;
+}
+
+
+/*
+Runs the instruction at the PC with its handler in the control unit, on the registers and flags
+themselves. Returns how it halts the process, or 0 if it does not.
+*/
+static int interpret_jit_instr(JITContext* ctx, FetchWindow* window) {
+    Machine* machine = ctx->machine;
+    CPU* cpu = ctx->process->cpu;
+    DecodedInstr* instr = fetch_instruction(ctx->process, cpu, ctx->regs[15], window, machine);
+    if (instr->halts)
+        return instr->halts;
+
+    store_jit_registers(ctx, cpu);
+    instr->handler(instr, machine, cpu->registers, ctx->process);
+    load_jit_registers(ctx, cpu);
+
+    ctx->regs[15]++;
+    ctx->executed += instr->length;
+    ctx->interrupts = cpu->periodic_interrupts_enabled;
+    machine->jit->stats.interpreted += instr->length;
+    return 0;
+}
+
+#endif
+
+
+/**
+ * @brief Sets up the JIT of a machine, which translates basic blocks into x86-64 code in an executable
+ * buffer. The entry code saves rbx, which holds the context for as long as native code runs, and the
+ * exit code restores it, so each block only needs to jump to the exit code to return to run_jit_burst.
+ *
+ * @param machine The machine, whose MMU and TLB must be initialised
+ * @return 0 if the JIT is ready, -1 if it is not supported on this host or the buffer could not be made
+ */
+int init_jit(Machine* machine) {
+#ifdef JIT_SUPPORTED
+    void* code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+        return -1;
+
+    JITState* jit = calloc(1, sizeof(JITState));
+    size_t frames_len = machine->num_physical_frames / 8 + 1;
+    uint8_t* code_frames = calloc(frames_len, 1);
+    if (jit == NULL || code_frames == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR JIT!\n");
+        exit(-1);
+    }
+
+    jit->machine = machine;
+    jit->frames_len = frames_len;
+    machine->jit = jit;
+    machine->jit_code_frames = code_frames;
+
+    jit->code = code;
+    jit->free_code = code;
+    jit->enter = (void (*)(JITContext*, const uint8_t*))jit->free_code;
+    emit_byte(jit, 0x53); // push rbx
+    emit_byte(jit, 0x48); emit_byte(jit, 0x89); emit_reg_reg(jit, 7, 3); // mov rbx, rdi
+    emit_byte(jit, 0xFF); emit_reg_reg(jit, 4, ESI); // jmp rsi
+
+    jit->exit_code = jit->free_code;
+    emit_byte(jit, 0x5B); // pop rbx
+    emit_byte(jit, 0xC3); // ret
+
+    jit->first_block = jit->free_code;
+    jit->generation = machine->cpus[0].tlb->generation;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+
+/*
+Unmaps the code buffer of the JIT of a machine and frees it, if the machine has one.
+*/
+void free_jit(Machine* machine) {
+#ifdef JIT_SUPPORTED
+    if (machine->jit == NULL)
+        return;
+
+    munmap(machine->jit->code, JIT_CODE_SIZE);
+    free(machine->jit);
+    free(machine->jit_code_frames);
+    machine->jit = NULL;
+    machine->jit_code_frames = NULL;
+#endif
+}
+
+
+/**
+ * @brief Drops the blocks translated from a frame whose contents have changed. Chains into them are
+ * undone by unpatching every chain, and the blocks are removed from the table so they are translated
+ * again when next run. Their code stays in the buffer until it is flushed.
+ *
+ * @param machine The machine the frame belongs to
+ * @param frame The frame that has changed
+ */
+void invalidate_jit_frame(Machine* machine, uint32_t frame) {
+#ifdef JIT_SUPPORTED
+    JITState* jit = machine->jit;
+    unchain_jit_blocks(jit);
+    for (int i = 0; i < JIT_TABLE_SIZE; i++) {
+        if (jit->blocks[i].code != NULL && jit->blocks[i].physical_addr >> PAGE_OFFSET_BITS == frame)
+            jit->blocks[i].code = NULL;
+    }
+
+    machine->jit_code_frames[frame >> 3] &= ~(1 << (frame & 7));
+    jit->stats.invalidations++;
+#endif
+}
+
+
+/**
+ * @brief Runs a process for a burst with the JIT. Each block is translated the first time it is reached
+ * and then run as native code, which jumps straight to the next block once the exit it left through has
+ * been chained to it. Instructions that cannot be translated, and the instructions at the end of a burst
+ * that do not make up a whole block, are run by the interpreter, which is the reference for the JIT.
+ *
+ * @param machine The machine the process belongs to
+ * @param process The process being executed, whose CPU holds its registers
+ * @param burst_len The number of instructions to execute
+ * @param instrs_executed Set to the number of instructions executed
+ * @return How the process halted, HALT_EXIT or HALT_FAULT, or 0 if the burst ended
+ */
+int run_jit_burst(Machine* machine, Process* process, uint32_t burst_len, uint32_t* instrs_executed) {
+#ifdef JIT_SUPPORTED
+    JITState* jit = machine->jit;
+    JITContext ctx;
+    load_jit_registers(&ctx, process->cpu);
+    ctx.executed = 0;
+    ctx.burst_len = burst_len;
+    ctx.exit_site = JIT_NO_SITE;
+    ctx.interrupts = process->cpu->periodic_interrupts_enabled;
+    ctx.machine = machine;
+    ctx.process = process;
+
+    FetchWindow window = { TLB_INVALID_PAGE, 0, 0 };
+    int halted = 0;
+    while (!halted) {
+        unsigned long flushes = jit->stats.flushes;
+        uint32_t address = translate_pc(process, ctx.regs[15], &window, machine);
+        const uint8_t* block = address == NO_PHYSICAL_ADDR ? NULL : get_jit_block(jit, address);
+        check_jit_chains(jit);
+
+        // the site the last block left through is gone if the code was flushed
+        if (flushes != jit->stats.flushes)
+            ctx.exit_site = JIT_NO_SITE;
+
+        if (block != NULL) {
+            if (ctx.exit_site != JIT_NO_SITE && ctx.exit_site != JIT_BAILED)
+                chain_jit_site(jit, ctx.exit_site, ctx.regs[15], block);
+
+            ctx.exit_site = JIT_NO_SITE;
+            jit->enter(&ctx, block);
+            if (ctx.exit_site != JIT_BAILED) {
+                if (ctx.executed > burst_len && ctx.interrupts == 1)
+                    break;
+                continue;
+            }
+        }
+
+        // a block that did not fit leaves the rest of the burst to the interpreter
+        short bailed = ctx.exit_site == JIT_BAILED;
+        ctx.exit_site = JIT_NO_SITE;
+        do {
+            halted = interpret_jit_instr(&ctx, &window);
+        } while (!halted && bailed && ctx.interrupts == 1 && ctx.executed <= burst_len);
+
+        if (ctx.executed > burst_len && ctx.interrupts == 1)
+            break;
+    }
+
+    store_jit_registers(&ctx, process->cpu);
+    *instrs_executed = ctx.executed;
+    jit->stats.instrs += ctx.executed;
+    return halted;
+#else
+    printf("ERROR: THE JIT IS NOT SUPPORTED ON THIS HOST!\n");
+    exit(-1);
+#endif
+}
+
+
+/*
+Prints how many blocks were translated and chained, and how many instructions were run as native code.
+*/
+void print_jit_stats(Machine* machine) {
+#ifdef JIT_SUPPORTED
+    JITStats* stats = &machine->jit->stats;
+    unsigned long native = stats->instrs - stats->interpreted;
+    printf("JIT blocks translated: %lu\nChains: %lu\nFlushes: %lu\nFrame invalidations: %lu\n",
+        stats->blocks, stats->chains, stats->flushes, stats->invalidations);
+    printf("Native instructions: %lu of %lu\nNative rate: %.3f\n", native, stats->instrs,
+        stats->instrs > 0 ? (double)native / stats->instrs : 0);
+#endif
+}
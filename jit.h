@@ -0,0 +1,32 @@
+#ifndef JIT_COMPILER
+#define JIT_COMPILER
+
+#include <stdio.h>
+#include <stdint.h>
+#include "internal_memory.h"
+#include "registers.h"
+#include "machine.h"
+#include "os/microkernel.h"
+
+// native code is generated for the System V x86-64 calling convention
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_SUPPORTED
+#endif
+
+
+int init_jit(Machine* machine);
+void free_jit(Machine* machine);
+void invalidate_jit_frame(Machine* machine, uint32_t frame);
+int run_jit_burst(Machine* machine, Process* process, uint32_t burst_len, uint32_t* instrs_executed);
+void print_jit_stats(Machine* machine);
+
+
+/*
+Checks whether any native code has been translated from a frame of a machine, so that writes to it must 
+invalidate the translations.
+*/
+static inline int is_jit_code_frame(Machine* machine, uint32_t frame) {
+    return machine->jit_code_frames != NULL && (machine->jit_code_frames[frame >> 3] >> (frame & 7)) & 1;
+}
+
+#endif
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "launcher.h"
+#include "os/executable.h"
+
+#define MANIFEST_LINE_LEN 1024
+
+
+/*
+Creates an empty batch.
+*/
+Batch* new_batch() {
+    Batch* batch = malloc(sizeof(Batch));
+    if (batch == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR BATCH!\n");
+        exit(-1);
+    }
+
+    batch->jobs = NULL;
+    batch->num_jobs = 0;
+    batch->capacity = 0;
+
+    return batch;
+}
+
+
+/*
+Frees the batch, along with the copies of the programs, arguments and output paths of its jobs.
+*/
+void free_batch(Batch* batch) {
+    for (int i = 0; i < batch->num_jobs; i++) {
+        for (int j = 0; j < batch->jobs[i].argc; j++) {
+            free(batch->jobs[i].argv[j]);
+        }
+
+        free(batch->jobs[i].argv);
+        free(batch->jobs[i].program);
+        free(batch->jobs[i].output_path);
+    }
+
+    free(batch->jobs);
+    free(batch);
+}
+
+
+/**
+ * @brief Adds a program to the end of the batch. The program, arguments and output path are copied.
+ *
+ * @param batch The batch to add to
+ * @param program The path of the program image
+ * @param argc The number of arguments
+ * @param argv The arguments given to the process
+ * @param output_path The file to capture the process's output in, or NULL to print it to stdout
+ */
+void add_batch_job(Batch* batch, const char* program, int argc, char** argv, const char* output_path) {
+    if (batch->num_jobs == batch->capacity) {
+        batch->capacity = batch->capacity == 0 ? 16 : batch->capacity * 2;
+        batch->jobs = realloc(batch->jobs, sizeof(BatchJob) * batch->capacity);
+        if (batch->jobs == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR BATCH!\n");
+            exit(-1);
+        }
+    }
+
+    BatchJob* job = &batch->jobs[batch->num_jobs++];
+    job->program = strdup(program);
+    job->argc = argc;
+    job->argv = malloc(sizeof(char*) * (argc > 0 ? argc : 1));
+    for (int i = 0; i < argc; i++) {
+        job->argv[i] = strdup(argv[i]);
+    }
+
+    job->output_path = output_path == NULL ? NULL : strdup(output_path);
+    job->report.exit_status = JOB_NOT_LOADED;
+    job->report.instructions_retired = 0;
+    job->report.wall_time = 0;
+}
+
+
+/**
+ * @brief Adds a job to the batch for every line of a manifest file. Each line is the path of a program
+ * followed by its arguments, separated by whitespace, and optionally `> <file>` to capture the output of
+ * the process in a file. Blank lines and lines starting with # are skipped.
+ *
+ * @param batch The batch to add to
+ * @param path The path of the manifest
+ * @return 0 if the manifest was read, -1 if it could not be opened or has a line with no output file
+ * after the >
+ */
+int read_manifest(Batch* batch, const char* path) {
+    FILE* manifest = fopen(path, "r");
+    if (manifest == NULL)
+        return -1;
+
+    char line[MANIFEST_LINE_LEN];
+    char* tokens[MANIFEST_LINE_LEN / 2];
+    while (fgets(line, MANIFEST_LINE_LEN, manifest) != NULL) {
+        int num_tokens = 0;
+        char* output_path = NULL;
+        short expect_output = 0;
+        for (char* token = strtok(line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+            if (expect_output) {
+                output_path = token;
+                expect_output = 0;
+            } else if (token[0] == '>') {
+                output_path = token[1] != '\0' ? token + 1 : NULL;
+                expect_output = token[1] == '\0';
+            } else {
+                tokens[num_tokens++] = token;
+            }
+        }
+
+        if (num_tokens == 0 || tokens[0][0] == '#')
+            continue;
+
+        if (expect_output) {
+            fclose(manifest);
+            return -1;
+        }
+
+        add_batch_job(batch, tokens[0], num_tokens - 1, tokens + 1, output_path);
+    }
+
+    fclose(manifest);
+    return 0;
+}
+
+
+/**
+ * @brief Creates a process running a program, which is read from the harddrive image if its path starts 
+ * with DISK_PROGRAM_PREFIX, or mapped from the host's filesystem otherwise.
+ *
+ * @param id The id of the new process
+ * @param program The path of the program image
+ * @param argc The number of arguments
+ * @param argv The arguments given to the process
+ * @param machine The machine to run the process on
+ * @return The new process, or NULL if the program could not be loaded
+ */
+Process* load_program(uint8_t id, char* program, int argc, char** argv, Machine* machine) {
+    const size_t prefix_len = strlen(DISK_PROGRAM_PREFIX);
+    if (strncmp(program, DISK_PROGRAM_PREFIX, prefix_len) == 0) {
+        Process* process = new_process_from_disk(id, program + prefix_len, argc, argv, machine);
+        if (process == NULL)
+            printf("Could not open program %s\n", program);
+
+        return process;
+    }
+
+    Executable* executable = map_executable(program);
+    if (executable == NULL) {
+        printf("Could not open program %s\n", program);
+        return NULL;
+    }
+
+    Process* process = new_process_with_args(id, executable->words, executable->len, argc, argv, machine);
+    unmap_executable(executable);
+    return process;
+}
+
+
+/**
+ * @brief Runs every job in the batch under the round-robin scheduler, as many at a time as the kernel
+ * has process ids for, and fills in the report of each job as its process ends.
+ *
+ * @param batch The batch to run
+ * @param machine The machine to run the batch on
+ */
+void run_batch(Batch* batch, Machine* machine) {
+    FILE* outputs[BATCH_GROUP_SIZE];
+    for (int group_start = 0; group_start < batch->num_jobs; group_start += BATCH_GROUP_SIZE) {
+        int group_len = batch->num_jobs - group_start;
+        if (group_len > BATCH_GROUP_SIZE)
+            group_len = BATCH_GROUP_SIZE;
+
+        for (int i = 0; i < group_len; i++) {
+            BatchJob* job = &batch->jobs[group_start + i];
+            outputs[i] = NULL;
+
+            if (job->output_path != NULL) {
+                outputs[i] = fopen(job->output_path, "w");
+                if (outputs[i] == NULL) {
+                    printf("Could not open output file %s\n", job->output_path);
+                    continue;
+                }
+            }
+
+            Process* process = load_program(i, job->program, job->argc, job->argv, machine);
+            if (process == NULL)
+                continue;
+
+            process->output = outputs[i];
+            process->report = &job->report;
+        }
+
+        execute_scheduled_processes(machine);
+
+        for (int i = 0; i < group_len; i++) {
+            if (outputs[i] != NULL)
+                fclose(outputs[i]);
+        }
+    }
+}
+
+
+/*
+Prints how each job in the batch ended, with totals.
+*/
+void print_batch_summary(Batch* batch) {
+    unsigned long total_instructions = 0;
+    double total_time = 0;
+    int num_failed = 0;
+
+    printf("Job\tStatus\tInstructions\tWall Time (s)\tProgram\n");
+    for (int i = 0; i < batch->num_jobs; i++) {
+        ProcessReport* report = &batch->jobs[i].report;
+        printf("%d\t%d\t%lu\t\t%.6f\t%s\n", i, report->exit_status, report->instructions_retired,
+            report->wall_time, batch->jobs[i].program);
+
+        total_instructions += report->instructions_retired;
+        total_time += report->wall_time;
+        if (report->exit_status != 0)
+            num_failed++;
+    }
+
+    printf("%d jobs, %d failed, %lu instructions retired, %.6fs summed wall time\n",
+        batch->num_jobs, num_failed, total_instructions, total_time);
+}
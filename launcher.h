@@ -0,0 +1,44 @@
+#ifndef LAUNCHER
+#define LAUNCHER
+
+#include <stdio.h>
+#include "internal_memory.h"
+#include "registers.h"
+#include "os/microkernel.h"
+
+#define BATCH_GROUP_SIZE 255 // the most processes the kernel can run at once
+#define JOB_NOT_LOADED -2 // exit status of a job whose program could not be loaded
+#define DISK_PROGRAM_PREFIX "disk:" // marks a program path as being on the harddrive image
+
+
+/**
+ * @brief A program to run as part of a batch, with its arguments and where to capture its output.
+ */
+typedef struct BatchJob {
+    char* program;
+    int argc;
+    char** argv;
+    char* output_path; // file the process prints to, or NULL to print to stdout
+    ProcessReport report;
+} BatchJob;
+
+
+/**
+ * @brief A list of programs to run in one go under the scheduler.
+ */
+typedef struct Batch {
+    BatchJob* jobs;
+    int num_jobs;
+    int capacity;
+} Batch;
+
+
+Batch* new_batch();
+void free_batch(Batch* batch);
+void add_batch_job(Batch* batch, const char* program, int argc, char** argv, const char* output_path);
+int read_manifest(Batch* batch, const char* path);
+Process* load_program(uint8_t id, char* program, int argc, char** argv, Machine* machine);
+void run_batch(Batch* batch, Machine* machine);
+void print_batch_summary(Batch* batch);
+
+#endif
@@ -0,0 +1,95 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "machine.h"
+#include "registers.h"
+#include "translator.h"
+#include "jit.h"
+#include "os/microkernel.h"
+#include "os/filesystem/fat_functions.h"
+
+
+/**
+ * @brief Creates a machine with the given RAM and number of CPUs, each with its own zeroed register file,
+ * and nothing else set up yet. The kernel is set up on it by init_MMU, init_TLB and init_processes, and
+ * the harddrive by init_harddrive. The machine owns its RAM, which free_machine frees along with it.
+ *
+ * @param ram The RAM of the machine
+ * @param num_cpus The number of CPUs, from 1 to MAX_CPUS
+ * @return The new machine
+ */
+Machine* new_machine(RAM* ram, uint8_t num_cpus) {
+    Machine* machine = calloc(1, sizeof(Machine));
+    CPU* cpus = calloc(num_cpus, sizeof(CPU));
+    FileSystem* fs = calloc(1, sizeof(FileSystem));
+    if (machine == NULL || cpus == NULL || fs == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR MACHINE!\n");
+        exit(-1);
+    }
+
+    for (uint8_t i = 0; i < num_cpus; i++) {
+        cpus[i].id = i;
+        cpus[i].registers = init_registers();
+        cpus[i].periodic_interrupts_enabled = 1;
+        cpus[i].fusion_stats = calloc(1, sizeof(FusionStats));
+        if (cpus[i].fusion_stats == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR MACHINE!\n");
+            exit(-1);
+        }
+    }
+
+    machine->ram = ram;
+    machine->cpus = cpus;
+    machine->num_cpus = num_cpus;
+    pthread_mutex_init(&machine->kernel_lock, NULL);
+    pthread_mutex_init(&machine->atomic_lock, NULL);
+    machine->fs = fs;
+
+    return machine;
+}
+
+
+/**
+ * @brief Frees a machine and everything it owns: any processes still in it, the kernel's tables, the 
+ * caches of each CPU, the JIT, the open files of the harddrive, and its RAM.
+ *
+ * @param machine The machine to free, which must not be running
+ */
+void free_machine(Machine* machine) {
+    free_kernel(machine);
+    free_jit(machine);
+
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        free(machine->cpus[i].registers);
+        free(machine->cpus[i].fusion_stats);
+    }
+
+    close_harddrive(machine->fs);
+    if (machine->hd_img != NULL)
+        fclose(machine->hd_img);
+
+    free_RAM(machine->ram);
+    pthread_mutex_destroy(&machine->kernel_lock);
+    pthread_mutex_destroy(&machine->atomic_lock);
+    free(machine->fs);
+    free(machine->cpus);
+    free(machine);
+}
+
+
+/**
+ * @brief Enters or leaves an atomic section on a CPU, as the ATOM instruction does. A CPU is not
+ * preempted while it is in an atomic section, and with more than one CPU only one of them can be in an
+ * atomic section at a time, so a CPU entering one waits until no other CPU is in one.
+ *
+ * @param machine The machine the CPU belongs to
+ * @param cpu The CPU executing ATOM
+ */
+void toggle_atomic_section(Machine* machine, CPU* cpu) {
+    if (machine->num_cpus > 1 && cpu->periodic_interrupts_enabled)
+        pthread_mutex_lock(&machine->atomic_lock);
+    else if (machine->num_cpus > 1)
+        pthread_mutex_unlock(&machine->atomic_lock);
+
+    cpu->periodic_interrupts_enabled = !cpu->periodic_interrupts_enabled;
+}
@@ -0,0 +1,102 @@
+#ifndef MACHINE
+#define MACHINE
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "internal_memory.h"
+#include "ALU.h"
+
+#define MAX_CPUS 64
+
+
+typedef struct Machine Machine;
+typedef struct MMUEntry MMUEntry;
+typedef struct Process Process;
+typedef struct TLB TLB;
+typedef struct FrameAllocator FrameAllocator;
+typedef struct SwapDevice SwapDevice;
+typedef struct DecodeCache DecodeCache;
+typedef struct FusionStats FusionStats;
+typedef struct FileSystem FileSystem;
+typedef struct JITState JITState;
+typedef struct RunQueue RunQueue;
+
+
+/*
+The state of one processor: its register file, the operands the ALU flags are worked out from, whether 
+periodic interrupts are enabled (ATOM toggles them), and its own caches of translations and decoded 
+instructions. With more than one CPU, each is run by its own host thread.
+*/
+typedef struct CPU {
+    uint8_t id;
+    uint32_t* registers;
+    struct ALU_last_op last_op;
+    short periodic_interrupts_enabled;
+    TLB* tlb;
+    DecodeCache* decode_cache;
+    FusionStats* fusion_stats;
+    Process* process; // the process running on the CPU, or NULL between bursts
+    RunQueue* run_queue; // the processes waiting to run on the CPU, NULL with only one CPU
+} CPU;
+
+
+/**
+ * @brief Everything one emulated machine is made of: its memory, its CPUs, the kernel's tables, the
+ * caches of translated code, and the open files of the harddrive. Nothing that changes while the machine 
+ * runs is kept anywhere else, so any number of machines can be run in one host process.
+ * 
+ * With more than one CPU, the kernel lock is held by whichever CPU is in the kernel, so everything but 
+ * the CPUs themselves and the words of RAM is only changed under it.
+ */
+struct Machine {
+    RAM* ram;
+    CPU* cpus;
+    uint8_t num_cpus;
+    pthread_mutex_t kernel_lock;
+    pthread_mutex_t atomic_lock; // held by the CPU in an atomic section
+    FILE* hd_img; // image of the harddrive
+
+    // the kernel
+    MMUEntry* MMU;
+    uint32_t num_physical_frames;
+    uint32_t MMU_size; // the number of frames with entries in the MMU so far
+    FrameAllocator* frame_allocator;
+    SwapDevice* swap_device; // NULL if swap is disabled
+    uint32_t clock_hand;
+    int32_t* shared_pages; // chains of shared frames through MMUEntry.next_shared, SHARED_PAGE_BUCKETS long
+    short large_pages_enabled;
+    short threaded_interpreter_enabled;
+    short jit_enabled;
+    Process** processes;
+    uint8_t num_active_processes;
+
+    // translated code
+    short block_translation_enabled;
+    JITState* jit; // NULL if the JIT is not enabled
+    uint8_t* jit_code_frames; // bitmap of the frames native code has been translated from, NULL without the JIT
+
+    FileSystem* fs;
+};
+
+
+Machine* new_machine(RAM* ram, uint8_t num_cpus);
+void free_machine(Machine* machine);
+void toggle_atomic_section(Machine* machine, CPU* cpu);
+
+
+/*
+Takes the kernel lock of a machine, if it has more than one CPU to take it from.
+*/
+static inline void lock_kernel(Machine* machine) {
+    if (machine->num_cpus > 1)
+        pthread_mutex_lock(&machine->kernel_lock);
+}
+
+
+static inline void unlock_kernel(Machine* machine) {
+    if (machine->num_cpus > 1)
+        pthread_mutex_unlock(&machine->kernel_lock);
+}
+
+#endif
@@ -1,65 +1,216 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 #include "registers.h"
 #include "internal_memory.h"
 #include "control_unit.h"
+#include "decode_cache.h"
+#include "translator.h"
+#include "jit.h"
 #include "os/microkernel.h"
 #include "os/interrupt_handler.h"
 #include "os/filesystem/fat_functions.h"
+#include "launcher.h"
+#include "machine.h"
 
 #define TRUE 1
 #define FALSE 0
 
 
-// Reads bytes from the specified file and outputs those bytes as a pointer to an array
-uint16_t* read_commands(char* filename, long* prog_len) {
-    FILE *fileptr;
-    uint16_t *buffer;
-    long filelen;
+/**
+ * @brief Parses a size of physical memory in words, with an optional K, M or G suffix for multiples of 
+ * 1024, and turns it into a number of frames.
+ * 
+ * @param size The size to parse, e.g. "256M"
+ * @return The number of frames, or 0 if the size is invalid or outside 1 frame to 4G words
+ */
+uint32_t parse_memory_size(const char* size) {
+    char* suffix;
+    unsigned long long words = strtoull(size, &suffix, 0);
+    if (*suffix == 'K' || *suffix == 'k')
+        words <<= 10;
+    else if (*suffix == 'M' || *suffix == 'm')
+        words <<= 20;
+    else if (*suffix == 'G' || *suffix == 'g')
+        words <<= 30;
+    else if (*suffix != '\0')
+        return 0;
 
-    fileptr = fopen(filename, "rb");
+    if (words < PAGE_SIZE || words > (unsigned long long)MAX_PHYSICAL_FRAMES * PAGE_SIZE)
+        return 0;
 
-    // determine length of file
-    fseek(fileptr, 0, SEEK_END);
-    filelen = ftell(fileptr) / 2;
-    rewind(fileptr);
+    return words / PAGE_SIZE;
+}
 
-    buffer = malloc(filelen * sizeof(uint16_t));
-    fread(buffer, filelen, sizeof(uint16_t), fileptr);
-    fclose(fileptr);
-    free(fileptr);
 
-    *prog_len = filelen;
-    return buffer;
+void print_usage() {
+    printf("USAGE: emulator [--ram=chained|open|frames] [--ram-capacity=<n>] [--ram-stats] [--memory=<words>[K|M|G]] "
+           "[--tlb-size=<n>] [--tlb-stats] [--decode-stats] [--swap=<file>|--no-swap] [--swap-stats] [--large-pages] [--threaded] [--fuse] [--jit] "
+           "[--cores=<n>] <filename>|disk:<path>... | --manifest=<file>\n");
 }
 
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        printf("Incorrect number of arguments!\nUSAGE: emulator <filename>\n");
+    RAMBackendType ram_type = RAM_FRAME_STORE;
+    long ram_capacity = 1024;
+    short show_ram_stats = FALSE;
+    long tlb_size = DEFAULT_TLB_SIZE;
+    short show_tlb_stats = FALSE;
+    short show_decode_stats = FALSE;
+    char* swap_path = NULL;
+    short use_swap = TRUE;
+    short show_swap_stats = FALSE;
+    short use_large_pages = FALSE;
+    short use_threaded_interpreter = FALSE;
+    short use_block_translation = FALSE;
+    short use_jit = FALSE;
+    long num_cpus = 1;
+    uint32_t num_frames = NUM_PAGES;
+    char* filename = NULL;
+    Batch* batch = new_batch();
+    char* manifest_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--ram=", 6) == 0) {
+            if (get_ram_backend_type(argv[i] + 6, &ram_type) != 0) {
+                printf("Unknown RAM backend: %s\n", argv[i] + 6);
+                print_usage();
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--ram-capacity=", 15) == 0) {
+            ram_capacity = strtol(argv[i] + 15, NULL, 0);
+        } else if (strcmp(argv[i], "--ram-stats") == 0) {
+            show_ram_stats = TRUE;
+        } else if (strncmp(argv[i], "--memory=", 9) == 0) {
+            num_frames = parse_memory_size(argv[i] + 9);
+            if (num_frames == 0) {
+                printf("Physical memory must be between %d words and 4G words: %s\n", PAGE_SIZE, argv[i] + 9);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--tlb-size=", 11) == 0) {
+            tlb_size = strtol(argv[i] + 11, NULL, 0);
+        } else if (strcmp(argv[i], "--tlb-stats") == 0) {
+            show_tlb_stats = TRUE;
+        } else if (strcmp(argv[i], "--decode-stats") == 0) {
+            show_decode_stats = TRUE;
+        } else if (strncmp(argv[i], "--swap=", 7) == 0) {
+            swap_path = argv[i] + 7;
+        } else if (strcmp(argv[i], "--no-swap") == 0) {
+            use_swap = FALSE;
+        } else if (strcmp(argv[i], "--swap-stats") == 0) {
+            show_swap_stats = TRUE;
+        } else if (strcmp(argv[i], "--large-pages") == 0) {
+            use_large_pages = TRUE;
+        } else if (strcmp(argv[i], "--threaded") == 0) {
+            use_threaded_interpreter = TRUE;
+        } else if (strcmp(argv[i], "--fuse") == 0) {
+            use_block_translation = TRUE;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            use_jit = TRUE;
+        } else if (strncmp(argv[i], "--cores=", 8) == 0) {
+            num_cpus = strtol(argv[i] + 8, NULL, 0);
+            if (num_cpus < 1 || num_cpus > MAX_CPUS) {
+                printf("The number of cores must be between 1 and %d: %s\n", MAX_CPUS, argv[i] + 8);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--manifest=", 11) == 0) {
+            manifest_path = argv[i] + 11;
+        } else {
+            filename = argv[i];
+            add_batch_job(batch, filename, 0, NULL, NULL);
+        }
+    }
+
+    if (manifest_path != NULL && read_manifest(batch, manifest_path) != 0) {
+        printf("Could not read manifest %s\n", manifest_path);
+        exit(-1);
+    }
+
+    if (batch->num_jobs == 0) {
+        printf("Incorrect number of arguments!\n");
+        print_usage();
+        exit(-1);
+    }
+
+    // the other backends move words around as they are written, so cannot be shared between host threads
+    if (num_cpus > 1 && ram_type != RAM_FRAME_STORE) {
+        printf("Only the frames RAM backend can be used with more than one core\n");
         exit(-1);
     }
 
-    Register* register_file = init_registers();
-    RAM* ram = init_RAM(1024);
+    if (num_cpus > 1 && use_jit == TRUE) {
+        printf("The JIT can only be used with one core\n");
+        exit(-1);
+    }
 
-    // read program data into RAM
-    long prog_len_a;
-    uint16_t* commands_a = read_commands(argv[1], &prog_len_a);
+    RAM* ram = init_RAM(ram_type, ram_capacity);
+    Machine* machine = new_machine(ram, num_cpus);
     
     Metadata* hd_metadata;
-    FILE* hd_img = init_harddrive(hd_metadata);
+    machine->hd_img = init_harddrive(machine->fs, hd_metadata);
 
-    init_MMU();
-    init_processes();
-    Process* process_a = new_process(0, commands_a, prog_len_a, ram);
+    init_MMU(machine, num_frames);
+    init_TLB(machine, tlb_size);
+    if (use_large_pages == TRUE)
+        enable_large_pages(machine);
 
-    print_processes();
-    execute_scheduled_processes(ram, register_file, hd_img);
-    print_registers(register_file);
-    
-    print_open_files();
+    if (use_threaded_interpreter == TRUE && enable_threaded_interpreter(machine) != 0) {
+        printf("The threaded interpreter is not supported by this build\n");
+        exit(-1);
+    }
+
+    if (use_block_translation == TRUE)
+        enable_block_translation(machine);
+
+    if (use_jit == TRUE && enable_jit(machine) != 0) {
+        printf("The JIT is not supported on this host\n");
+        exit(-1);
+    }
+
+    if (use_swap == TRUE && init_swap(machine, swap_path) != 0) {
+        printf("Could not open swap file %s\n", swap_path);
+        exit(-1);
+    }
+
+    init_processes(machine);
+
+    // several programs run as a batch, with a summary of how each one ended instead of the final state
+    if (batch->num_jobs > 1 || manifest_path != NULL) {
+        run_batch(batch, machine);
+        print_batch_summary(batch);
+    } else {
+        // the program image is copied into the process's pages when it is created
+        Process* process_a = load_program(0, filename, 0, NULL, machine);
+        if (process_a == NULL)
+            exit(-1);
+
+        print_processes(machine);
+        execute_scheduled_processes(machine);
+        print_registers(machine->cpus[0].registers);
+        
+        print_open_files(machine->fs);
+    }
+
+    if (show_ram_stats == TRUE)
+        print_RAM_stats(ram);
+
+    if (show_tlb_stats == TRUE)
+        print_TLB(machine);
+
+    if (show_decode_stats == TRUE) {
+        print_decode_cache_stats(machine);
+        if (use_block_translation == TRUE)
+            print_fusion_stats(machine);
+        if (use_jit == TRUE)
+            print_jit_stats(machine);
+    }
+
+    if (show_swap_stats == TRUE)
+        print_swap(machine);
+
+    free_machine(machine);
+    free_batch(batch);
 
     return 0;
 }
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "executable.h"
+#include "microkernel.h"
+
+
+/**
+ * @brief Maps a program image into host memory, so that it is paged in from the file as it is loaded
+ * rather than read into a buffer up front.
+ *
+ * @param path The path of the program image
+ * @return Pointer to the mapped executable, or NULL if the file could not be opened or mapped
+ */
+Executable* map_executable(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* mapping = NULL;
+    if (file_stat.st_size > 0) {
+        mapping = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    // the mapping stays valid once the file is closed
+    close(fd);
+
+    Executable* executable = malloc(sizeof(Executable));
+    if (executable == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR EXECUTABLE!\n");
+        exit(-1);
+    }
+
+    executable->words = mapping;
+    executable->len = file_stat.st_size / 2;
+    executable->mapping = mapping;
+    executable->mapping_len = file_stat.st_size;
+
+    return executable;
+}
+
+
+/*
+Unmaps the program image and frees the executable.
+*/
+void unmap_executable(Executable* executable) {
+    if (executable->mapping != NULL)
+        munmap(executable->mapping, executable->mapping_len);
+
+    free(executable);
+}
+
+
+/*
+Adds the section being scanned to the list, ending it at the given word.
+*/
+int end_scanned_section(SectionScanner* scanner, long end) {
+    if (scanner->num_sections == MAX_EXECUTABLE_SECTIONS)
+        return -1;
+
+    ExecutableSection* section = &scanner->sections[scanner->num_sections++];
+    section->type = scanner->section;
+    section->offset = scanner->section_start;
+    section->len = end - scanner->section_start;
+
+    return 0;
+}
+
+
+/**
+ * @brief Starts scanning a raw image for its sections. Everything before the first marker is code.
+ *
+ * @param scanner The scanner to start
+ * @param sections Array to put the sections into, MAX_EXECUTABLE_SECTIONS long
+ */
+void start_section_scan(SectionScanner* scanner, ExecutableSection* sections) {
+    scanner->sections = sections;
+    scanner->num_sections = 0;
+    scanner->section = CODE_PAGE;
+    scanner->section_start = 0;
+    scanner->pos = 0;
+    scanner->window[0] = 0;
+    scanner->window[1] = 0;
+}
+
+
+/**
+ * @brief Scans the next words of a raw image for the "data:" and "text:" markers, which may be split 
+ * across calls, so that an image can be scanned in pieces as it is read.
+ *
+ * @param scanner The scanner
+ * @param words The next words of the image
+ * @param len The number of words
+ * @return 0 if the words were scanned, or -1 if there are more than MAX_EXECUTABLE_SECTIONS sections
+ */
+int scan_section_words(SectionScanner* scanner, const uint16_t* words, long len) {
+    for (long i = 0; i < len; i++, scanner->pos++) {
+        uint16_t first = scanner->window[0];
+        uint16_t second = scanner->window[1];
+        scanner->window[0] = second;
+        scanner->window[1] = words[i];
+
+        // markers cannot overlap the end of the previous one
+        long marker_start = scanner->pos - 2;
+        if (marker_start < scanner->section_start || words[i] != 0x003A)
+            continue;
+
+        char next_section;
+        if (first == 0x6164 && second == 0x6174)
+            next_section = DATA_PAGE;
+        else if (first == 0x6574 && second == 0x7478)
+            next_section = TEXT_PAGE;
+        else
+            continue;
+
+        if (end_scanned_section(scanner, marker_start) != 0)
+            return -1;
+
+        // skip the section label bytes
+        scanner->section = next_section;
+        scanner->section_start = scanner->pos + 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Ends the last section at the end of the image.
+ *
+ * @param scanner The scanner
+ * @return The number of sections, or -1 if there are more than MAX_EXECUTABLE_SECTIONS
+ */
+int finish_section_scan(SectionScanner* scanner) {
+    if (end_scanned_section(scanner, scanner->pos) != 0)
+        return -1;
+
+    return scanner->num_sections;
+}
+
+
+/**
+ * @brief Finds the sections of a raw image by scanning for the "data:" and "text:" markers. Everything
+ * before the first marker is code, and every section runs up to the next marker or the end of the image.
+ *
+ * @param words The program image
+ * @param len The length of the image in words
+ * @param sections Array to put the sections into, MAX_EXECUTABLE_SECTIONS long
+ * @return The number of sections, or -1 if there are more than MAX_EXECUTABLE_SECTIONS
+ */
+int scan_raw_sections(const uint16_t* words, long len, ExecutableSection* sections) {
+    SectionScanner scanner;
+    start_section_scan(&scanner, sections);
+    if (scan_section_words(&scanner, words, len) != 0)
+        return -1;
+
+    return finish_section_scan(&scanner);
+}
+
+
+/*
+Checks whether a program image starts with the magic words of a section header.
+*/
+int has_executable_header(const uint16_t* words, long len) {
+    return len >= EXECUTABLE_HEADER_LEN && words[0] == EXECUTABLE_MAGIC_0 && words[1] == EXECUTABLE_MAGIC_1;
+}
+
+
+/**
+ * @brief Reads the section header of a program image, which need not all be in memory as long as the
+ * header is.
+ *
+ * @param words The start of the program image, including the magic words
+ * @param header_len The number of words of the image in memory
+ * @param len The length of the whole image in words
+ * @param sections Array to put the sections into, MAX_EXECUTABLE_SECTIONS long
+ * @return The number of sections, or -1 if the header is invalid
+ */
+int read_executable_header(const uint16_t* words, long header_len, long len, ExecutableSection* sections) {
+    int num_sections = words[3];
+    if (words[2] != EXECUTABLE_VERSION || num_sections > MAX_EXECUTABLE_SECTIONS)
+        return -1;
+    if (EXECUTABLE_HEADER_LEN + num_sections * EXECUTABLE_SECTION_ENTRY_LEN > header_len)
+        return -1;
+
+    for (int i = 0; i < num_sections; i++) {
+        const uint16_t* entry = words + EXECUTABLE_HEADER_LEN + i * EXECUTABLE_SECTION_ENTRY_LEN;
+        sections[i].type = entry[0];
+        sections[i].offset = ((uint32_t)entry[1] << 16) | entry[2];
+        sections[i].len = ((uint32_t)entry[3] << 16) | entry[4];
+
+        if (sections[i].type != CODE_PAGE && sections[i].type != DATA_PAGE && sections[i].type != TEXT_PAGE)
+            return -1;
+        if (sections[i].offset > len || sections[i].len > len - sections[i].offset)
+            return -1;
+    }
+
+    return num_sections;
+}
+
+
+/**
+ * @brief Gets the sections of a program image, from its header if it has one, or by scanning it for
+ * section markers if it is a raw image.
+ *
+ * @param words The program image
+ * @param len The length of the image in words
+ * @param sections Array to put the sections into, MAX_EXECUTABLE_SECTIONS long
+ * @return The number of sections, or -1 if the header is invalid
+ */
+int get_executable_sections(const uint16_t* words, long len, ExecutableSection* sections) {
+    if (!has_executable_header(words, len))
+        return scan_raw_sections(words, len, sections);
+
+    return read_executable_header(words, len, len, sections);
+}
@@ -0,0 +1,65 @@
+#ifndef EXECUTABLE
+#define EXECUTABLE
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EXECUTABLE_MAGIC_0 0x5249 // "IR" in the first word of the file
+#define EXECUTABLE_MAGIC_1 0x5845 // "EX" in the second word
+#define EXECUTABLE_VERSION 1
+#define EXECUTABLE_HEADER_LEN 4
+#define EXECUTABLE_SECTION_ENTRY_LEN 5
+#define MAX_EXECUTABLE_SECTIONS 64
+
+
+/*
+An executable with a header starts with the 4 words "IR", "EX", the version, and the number of sections,
+followed by an entry of 5 words for each section: its page type ('c', 'd' or 't') and then its offset
+and length in words from the start of the file, each as 2 words with the upper 16 bits first. Sections
+are loaded one after the other in the order of their entries.
+
+Files without the magic words are raw images, where the sections are found by scanning for the "data:"
+and "text:" markers.
+*/
+typedef struct ExecutableSection {
+    char type;
+    uint32_t offset;
+    uint32_t len;
+} ExecutableSection;
+
+
+/**
+ * @brief The state of a scan of a raw image for its section markers, which is fed the image a piece at
+ * a time.
+ */
+typedef struct SectionScanner {
+    ExecutableSection* sections;
+    int num_sections;
+    char section; // type of the section being scanned
+    long section_start;
+    long pos; // number of words scanned so far
+    uint16_t window[2]; // the two words before pos, for markers split between pieces
+} SectionScanner;
+
+
+/**
+ * @brief A program image mapped read-only into host memory from a file.
+ */
+typedef struct Executable {
+    const uint16_t* words;
+    long len; // the length of the image in words
+    void* mapping;
+    size_t mapping_len;
+} Executable;
+
+
+Executable* map_executable(const char* path);
+void unmap_executable(Executable* executable);
+void start_section_scan(SectionScanner* scanner, ExecutableSection* sections);
+int scan_section_words(SectionScanner* scanner, const uint16_t* words, long len);
+int finish_section_scan(SectionScanner* scanner);
+int has_executable_header(const uint16_t* words, long len);
+int read_executable_header(const uint16_t* words, long header_len, long len, ExecutableSection* sections);
+int get_executable_sections(const uint16_t* words, long len, ExecutableSection* sections);
+
+#endif
@@ -10,14 +10,12 @@
 #define TRUE  1
 
 
-uint16_t* FAT = NULL;
-int num_open_files = 0;
 const int max_open_files = 256;
-FATPtr** open_files = NULL;
 
 
-/** @brief Prints the ID, start sector, and name of all the open files. */
-void print_open_files() {
+/** @brief Prints the ID, start sector, and name of all the open files of a filesystem. */
+void print_open_files(FileSystem* fs) {
+    FATPtr** open_files = fs->open_files;
     printf("ID\tSector 0\tName\n");
     for (int i = 0; i < max_open_files; i++) {
         if (open_files[i] == NULL)
@@ -28,6 +26,18 @@ void print_open_files() {
 }
 
 
+/**
+ * @brief Get the address of the root directory, which comes straight after the reserved sectors and the
+ * FATs
+ * 
+ * @param metadata The filesystem metadata
+ * @return The address of the start of the root directory
+ */
+long get_root_dir_addr(Metadata* metadata) {
+    return (metadata->BPB_RsvdSecCnt + (metadata->BPB_NumFATs * metadata->BPB_FATz16)) * metadata->BPB_BytesPerSec;
+}
+
+
 /**
  * @brief Get the start address of a given cluster number
  * 
@@ -37,30 +47,45 @@ void print_open_files() {
  */
 long get_addr_from_cluster(long cluster_num, Metadata* metadata) {
     const int sector_offset_for_root = 4;
-    const long root_dir_addr = ((metadata->BPB_RsvdSecCnt + (metadata->BPB_NumFATs * metadata->BPB_FATz16)) 
-                        * metadata->BPB_BytesPerSec);
+    const long root_dir_addr = get_root_dir_addr(metadata);
     long new_addr = (((cluster_num + 2 + sector_offset_for_root) * metadata->BPB_SecPerClus) * 
                         metadata->BPB_BytesPerSec + root_dir_addr);
+
+    return new_addr;
+}
+
+
+/**
+ * @brief Moves the image to the start of the root directory, so that the next call to f_open looks
+ * for the file from the root rather than wherever the image was last left.
+ * 
+ * @param image Image of the harddrive
+ */
+void seek_root_dir(FILE* image) {
+    Metadata metadata;
+    read_sys_metadata(image, &metadata);
+    fseek(image, get_root_dir_addr(&metadata), SEEK_SET);
 }
 
 
 /**
- * @brief Seeks the start of the FAT, and then loads the contents into the passed pointer of 16-bit integers
+ * @brief Seeks the start of the FAT, and then loads the contents into the FAT of the filesystem
  * 
+ * @param fs The filesystem to load the FAT of
  * @param image Image of the harddrive
  * @param metadata Filesystem metadata
  */
-void scan_FAT_into_RAM(FILE* image, Metadata* metadata) {
+void scan_FAT_into_RAM(FileSystem* fs, FILE* image, Metadata* metadata) {
     const int FAT_start_addr = metadata->BPB_BytesPerSec * metadata->BPB_RsvdSecCnt;
     const int FAT_size = metadata->BPB_BytesPerSec * metadata->BPB_FATz16;
-    FAT = malloc(FAT_size);
-    if (FAT == NULL) {
+    fs->FAT = malloc(FAT_size);
+    if (fs->FAT == NULL) {
         printf("ERROR: COULD NOT ALLOCATE SUFFICIENT MEMORY FOR FAT!\n");
         exit(-1);
     }
 
     fseek(image, FAT_start_addr, SEEK_SET);
-    fread(FAT, sizeof(uint16_t), FAT_size / 2, image);
+    fread(fs->FAT, sizeof(uint16_t), FAT_size / 2, image);
 }
 
 
@@ -68,13 +93,15 @@ void scan_FAT_into_RAM(FILE* image, Metadata* metadata) {
  * @brief Initialises the harddrive by scanning the FAT into RAM and getting the metadata
  * before returning a pointer to the harddrive image.
  * 
+ * @param fs The filesystem to hold the FAT and open files of the harddrive
  * @param metadata Pointer to put the harddrive metadata into
  * @return Pointer to the harddrive image file 
  */
-FILE* init_harddrive(Metadata* metadata) {
-    open_files = malloc(max_open_files * sizeof(FATPtr*));
+FILE* init_harddrive(FileSystem* fs, Metadata* metadata) {
+    fs->num_open_files = 0;
+    fs->open_files = malloc(max_open_files * sizeof(FATPtr*));
     for (int i = 0; i < max_open_files; i++) {
-        open_files[i] = NULL;
+        fs->open_files[i] = NULL;
     }
     
 
@@ -82,13 +109,32 @@ FILE* init_harddrive(Metadata* metadata) {
     metadata = malloc(sizeof(Metadata));
     read_sys_metadata(image, metadata);
 
-    scan_FAT_into_RAM(image, metadata);
+    scan_FAT_into_RAM(fs, image, metadata);
     fseek(image, 0x8800, SEEK_SET);
+    free(metadata);
 
     return image;
 }
 
 
+/*
+Closes every file still open on the harddrive and frees the FAT, but not the filesystem itself.
+*/
+void close_harddrive(FileSystem* fs) {
+    if (fs->open_files != NULL) {
+        for (int i = 0; i < max_open_files; i++) {
+            if (fs->open_files[i] != NULL)
+                f_close(fs->open_files[i], i);
+        }
+    }
+
+    free(fs->open_files);
+    free(fs->FAT);
+    fs->open_files = NULL;
+    fs->FAT = NULL;
+}
+
+
 /**
  * @brief Goes into the given directory, gets all the files in it 1-by-1, assigns long filenames to 
  * them if neccessary, and returns array of dirs found and number of dirs found goes into the num_dirs
@@ -112,14 +158,17 @@ Filedir* iterate_directory(FILE* image, int addr, int* num_dirs) {
 
         // get the long file name of the file if applicable
         if ((fdir.DIR_Attr & 0b00111111) == 0b00001111) {
+            free(fdir.DIR_Name);
             fseek(image, -32, SEEK_CUR);
             read_long_filename(image, filename);
             read_filename = TRUE;
             continue;
         }
 
-        else if ((fdir.DIR_FileSize == 0 && fdir.DIR_WrtDate == 0 && fdir.DIR_WrtTime == 0) || ftell(image) > addr + 0x800)
+        else if ((fdir.DIR_FileSize == 0 && fdir.DIR_WrtDate == 0 && fdir.DIR_WrtTime == 0) || ftell(image) > addr + 0x800) {
+            free(fdir.DIR_Name);
             break;
+        }
         
         if (read_filename == TRUE) {
             free(fdir.DIR_Name);
@@ -145,18 +194,34 @@ Filedir* iterate_directory(FILE* image, int addr, int* num_dirs) {
 }
 
 
+/*
+Frees an array of directories from iterate_directory, along with their names.
+*/
+void free_directories(Filedir* directories, int num_dirs) {
+    for (int i = 0; i < num_dirs; i++) {
+        free(directories[i].DIR_Name);
+    }
+
+    free(directories);
+}
+
+
 /**
  * @brief Create a new FAT ptr object
  * 
- * @param filedir The file the new pointer will point to
- * @param sys_metadata The system metadata
+ * @param fs The filesystem the file is opened in
+ * @param filedir The file the new pointer will point to, which is copied
+ * @param sys_metadata The system metadata, which the pointer takes ownership of
  * @param root The start of the file
  * @param id The id of the file
  * @return FATPtr* Abstracted file pointer to the file
  */
-FATPtr* create_new_FAT_ptr(Filedir* filedir, Metadata* sys_metadata, int root, uint8_t id) {
+FATPtr* create_new_FAT_ptr(FileSystem* fs, Filedir* filedir, Metadata* sys_metadata, int root, uint8_t id) {
     FATPtr* fatptr = malloc(sizeof(FATPtr));
+    Filedir* file_context = malloc(sizeof(Filedir));
     FILE* fileptr = fopen("os/filesystem/harddrive.img", "r");
+    *file_context = *filedir;
+    file_context->DIR_Name = strdup(filedir->DIR_Name);
     
     // go to the correct addr according to cluster if not root, else go to 0x8800
     int cluster_num = (long)filedir->DIR_FstClusHI << 16 | filedir->DIR_FstClusLO;
@@ -164,12 +229,13 @@ FATPtr* create_new_FAT_ptr(Filedir* filedir, Metadata* sys_metadata, int root, u
     fseek(fileptr, new_addr, SEEK_SET);
 
     // create the fat pointer to be returned
+    fatptr->fs = fs;
     fatptr->fileptr = fileptr;
     fatptr->sys_context = sys_metadata;
-    fatptr->file_context = filedir;
+    fatptr->file_context = file_context;
     fatptr->sector_num = cluster_num;
     fatptr->start_sector = cluster_num;
-    fatptr->next_sector = FAT[cluster_num];
+    fatptr->next_sector = root == 0 ? fs->FAT[cluster_num] : 0xFFFF;
     fatptr->current_pos = 0;
     fatptr->id = id;
 
@@ -182,15 +248,16 @@ FATPtr* create_new_FAT_ptr(Filedir* filedir, Metadata* sys_metadata, int root, u
  * its different sections, then goes through each of them until it gets to the correct directory, then
  * returns the file pointer. 
  * 
+ * @param fs The filesystem of the harddrive
  * @param image File pointer to image of the harddrive
  * @param dir The file directory being opened
  * @return FATPtr* Abstracted pointer to the file on the disk 
  */
-FATPtr* f_open(FILE* image, char* dir) {
+FATPtr* f_open(FileSystem* fs, FILE* image, char* dir) {
     // determine id for the new file
     int id = -1;
     for (int i = 0; i < max_open_files; i++) {
-        if (open_files[i] == NULL) {
+        if (fs->open_files[i] == NULL) {
             id = i;
             break;
         }
@@ -206,39 +273,41 @@ FATPtr* f_open(FILE* image, char* dir) {
     fseek(image, current_pos, SEEK_SET);
 
     // if this is the root directory
-    Filedir* filedir = malloc(sizeof(Filedir));
     if ((dir[0] == '/' && strlen(dir) == 1) || strlen(dir) == 0) {
-        const long root_dir_addr = ((sys_metadata->BPB_RsvdSecCnt + (sys_metadata->BPB_NumFATs * sys_metadata->BPB_FATz16)) 
-                        * sys_metadata->BPB_BytesPerSec);
+        Filedir filedir;
+        memset(&filedir, 0, sizeof(Filedir));
+        filedir.DIR_Name = "/";
+        filedir.DIR_Attr = 0b010000;
+        filedir.DIR_FstClusHI = 0xFFFF;
+        filedir.DIR_FstClusLO = 0xFFFA;
+        FATPtr* root_ptr = create_new_FAT_ptr(fs, &filedir, sys_metadata, 1, id);
+        fseek(root_ptr->fileptr, get_root_dir_addr(sys_metadata), SEEK_SET);
 
-        filedir->DIR_FstClusHI = 0xFFFF;
-        filedir->DIR_FstClusLO = 0xFFFA;
-        FATPtr* root_ptr = create_new_FAT_ptr(filedir, sys_metadata, 1, id);
-        fseek(root_ptr->fileptr, root_dir_addr, SEEK_SET);
-
-        free(filedir);
         return root_ptr;
     }
 
-    char* dir_copy = malloc(strlen(dir));
+    char* dir_copy = malloc(strlen(dir) + 1);
     strcpy(dir_copy, dir);
     char* subdir;
     int num_subdirs;
     subdir = strtok(dir_copy, "/");
 
     Filedir* root_dirs = iterate_directory(image, ftell(image), &num_subdirs);
-    for (int i = 0; i < num_subdirs; i++) {
-        filedir = &root_dirs[i];
-
+    Filedir* filedir = NULL;
+    for (int i = 0; subdir != NULL && i < num_subdirs; i++) {
         // skip if the directory does not match the goal and validate the directory is not a long file name
-        if (strcmp(filedir->DIR_Name, subdir) != 0 || (filedir->DIR_Attr & 0b00111111) == 0b00001111)
+        if (strcmp(root_dirs[i].DIR_Name, subdir) != 0 || (root_dirs[i].DIR_Attr & 0b00111111) == 0b00001111)
             continue;
-        else
-            break;
+
+        filedir = &root_dirs[i];
+        break;
     }
 
-    if (strcmp(filedir->DIR_Name, subdir) != 0) {
+    free(dir_copy);
+    if (filedir == NULL) {
         printf("WARNING: DID NOT FIND FILE: %s!\n", dir);
+        free_directories(root_dirs, num_subdirs);
+        free(sys_metadata);
         return NULL;
     }
 
@@ -248,22 +317,21 @@ FATPtr* f_open(FILE* image, char* dir) {
 
     char* remaining_dir = strchr(dir, '/');
     if (strlen(dir) > 0 && dir[strlen(dir) - 1] != '/' && remaining_dir != NULL) {
-        free(filedir);
-        free(dir_copy);
-
         long next_cluster = ((long)filedir->DIR_FstClusHI << 16) | filedir->DIR_FstClusLO;
         fseek(image, get_addr_from_cluster(next_cluster, sys_metadata), SEEK_SET);
-        return f_open(image, remaining_dir + 1);
+
+        free_directories(root_dirs, num_subdirs);
+        free(sys_metadata);
+        return f_open(fs, image, remaining_dir + 1);
     }
 
 
     // create a FATPtr struct to hold the details of the file and then return it
-    FATPtr* fatptr = create_new_FAT_ptr(filedir, sys_metadata, 0, id);
-    open_files[id] = fatptr;
-    free(filedir);
-    free(dir_copy);
+    FATPtr* fatptr = create_new_FAT_ptr(fs, filedir, sys_metadata, 0, id);
+    fs->open_files[id] = fatptr;
+    free_directories(root_dirs, num_subdirs);
 
-    num_open_files++;
+    fs->num_open_files++;
     return fatptr;
 }
 
@@ -278,34 +346,28 @@ FATPtr* f_open(FILE* image, char* dir) {
  * @todo Add in an end of file whence
  */
 void f_seek(FATPtr* fileptr, long offset, short whence) {
-    if (offset == 0)
-        return;
-
-    // Start of file, go to start of file and seek thence using recursion
+    // Start of file, go back to the first cluster and seek thence
     if (whence == 0) { 
         fileptr->sector_num = fileptr->start_sector;
+        fileptr->next_sector = fileptr->fs->FAT[fileptr->start_sector];
         fileptr->current_pos = 0;
-        f_seek(fileptr, offset, 1);
-    } 
-    
-    // Current pos in file, iterate through sectors until no sectors left, then go through remainder
-    // and end recursion.
-    else if (whence == 1) {
-        if (fileptr->current_pos + offset > 0x800) {
-            fileptr->sector_num = fileptr->next_sector;
-            fileptr->next_sector = FAT[fileptr->sector_num];
-            f_seek(fileptr, offset - 0x800, whence);
-        } else {
-            fileptr->current_pos = fileptr->current_pos + offset;
-            long new_addr = get_addr_from_cluster(fileptr->sector_num, fileptr->sys_context);
-            fseek(fileptr->fileptr, new_addr + fileptr->current_pos, SEEK_SET);
-        }
-    }
-    
-    else {
-        printf("%d is not a valid whence!\n");
+    } else if (whence != 1) {
+        printf("%d is not a valid whence!\n", whence);
         exit(-1);
     }
+
+    // Follow the chain of clusters until the offset is inside the current one, then go through the
+    // remainder.
+    while (fileptr->current_pos + offset >= 0x800 && fileptr->next_sector < 0xFFF8) {
+        offset -= 0x800 - fileptr->current_pos;
+        fileptr->sector_num = fileptr->next_sector;
+        fileptr->next_sector = fileptr->fs->FAT[fileptr->sector_num];
+        fileptr->current_pos = 0;
+    }
+
+    fileptr->current_pos += offset;
+    long new_addr = get_addr_from_cluster(fileptr->sector_num, fileptr->sys_context);
+    fseek(fileptr->fileptr, new_addr + fileptr->current_pos, SEEK_SET);
 }
 
 
@@ -335,8 +397,12 @@ void f_read(FATPtr* fileptr, long bytes, char* buffer) {
             index += 0x800 - fileptr->current_pos;
 
             fileptr->sector_num = fileptr->next_sector;
-            fileptr->next_sector = fileptr->sector_num < 0xFFF8 ? FAT[fileptr->sector_num] : -1;
+            fileptr->next_sector = fileptr->sector_num < 0xFFF8 ? fileptr->fs->FAT[fileptr->sector_num] : -1;
             fileptr->current_pos = 0;
+
+            // the next cluster in the chain need not follow this one on the disk
+            if (fileptr->sector_num < 0xFFF8)
+                fseek(fileptr->fileptr, get_addr_from_cluster(fileptr->sector_num, fileptr->sys_context), SEEK_SET);
         } else {
             fread(buffer + index, 1, bytes, fileptr->fileptr);
             
@@ -352,22 +418,27 @@ void f_read(FATPtr* fileptr, long bytes, char* buffer) {
  * @brief Takes a file pointer and frees it, including the internal C FILE* pointer
  * 
  * @param fileptr The file pointer abstraction to be freed
+ * @param id The id of the file
  */
 void f_close(FATPtr* fileptr, int id) {
+    FileSystem* fs = fileptr->fs;
     fclose(fileptr->fileptr);
+    free(fileptr->file_context->DIR_Name);
+    free(fileptr->file_context);
+    free(fileptr->sys_context);
     free(fileptr);
-    free(open_files[id]);
-    open_files[id] = NULL;
-    printf("Closed: %d\n", id);
+    fs->open_files[id] = NULL;
+    fs->num_open_files--;
 }
 
 
 /**
  * @brief Get an opened file by its id, return NULL if not found.
  * 
+ * @param fs The filesystem the file was opened in
  * @param id The id of the file to get
  * @return FATPtr* of the file, or NULL if not found
  */
-FATPtr* get_open_file_id(int id) {
-    return open_files[id];
+FATPtr* get_open_file_id(FileSystem* fs, int id) {
+    return fs->open_files[id];
 }
@@ -7,11 +7,12 @@
 #include "file_meta.h"
 
 
-extern uint16_t* FAT;
+typedef struct FileSystem FileSystem;
 
 
 // Represents a pointer to a location in a FAT
 typedef struct fatptr {
+    FileSystem* fs; // the filesystem the file was opened in
     FILE* fileptr;
     Metadata* sys_context;
     Filedir* file_context;
@@ -22,14 +23,27 @@ typedef struct fatptr {
     uint8_t id;
 } FATPtr;
 
-FILE* init_harddrive(Metadata* metadata);
-FATPtr* f_open(FILE* image, char* dir);
+
+/*
+The FAT of a harddrive, scanned into memory, and the files open on it.
+*/
+struct FileSystem {
+    uint16_t* FAT;
+    int num_open_files;
+    FATPtr** open_files; // indexed by file id, NULL where no file is open
+};
+
+FILE* init_harddrive(FileSystem* fs, Metadata* metadata);
+void close_harddrive(FileSystem* fs);
+FATPtr* f_open(FileSystem* fs, FILE* image, char* dir);
 void f_seek(FATPtr* fileptr, long offset, short whence);
 void f_read(FATPtr* fileptr, long bytes, char* buffer);
 void f_close(FATPtr* fileptr, int id);
 Filedir* iterate_directory(FILE* image, int addr, int* num_dirs);
+long get_root_dir_addr(Metadata* metadata);
 long get_addr_from_cluster(long cluster_num, Metadata* metadata);
-void print_open_files();
-FATPtr* get_open_file_id(int id);
+void seek_root_dir(FILE* image);
+void print_open_files(FileSystem* fs);
+FATPtr* get_open_file_id(FileSystem* fs, int id);
 
 #endif
\ No newline at end of file
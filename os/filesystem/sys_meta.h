@@ -5,9 +5,6 @@
 #include <stdio.h>
 
 
-extern uint16_t* FAT;
-
-
 // Designed to store the metadata for a FAT16 image.
 typedef struct metadata {
     uint16_t    BPB_BytesPerSec;    // Bytes per sector
@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "frame_allocator.h"
+
+
+/**
+ * @brief Creates an allocator with every frame free.
+ * 
+ * @param num_frames The number of physical frames
+ * @return Pointer to the new allocator
+ */
+FrameAllocator* new_frame_allocator(uint32_t num_frames) {
+    uint32_t num_words = (num_frames + 63) / 64;
+    FrameAllocator* allocator = malloc(sizeof(FrameAllocator));
+    uint64_t* bitmap = malloc(sizeof(uint64_t) * num_words);
+    if (allocator == NULL || bitmap == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR FRAME BITMAP!\n");
+        exit(-1);
+    }
+
+    for (uint32_t i = 0; i < num_words; i++) {
+        bitmap[i] = ~(uint64_t)0;
+    }
+
+    // frames past the end of the last word do not exist
+    if (num_frames % 64 != 0)
+        bitmap[num_words - 1] = ((uint64_t)1 << (num_frames % 64)) - 1;
+
+    allocator->bitmap = bitmap;
+    allocator->num_frames = num_frames;
+    allocator->num_free = num_frames;
+    allocator->search_start = 0;
+
+    return allocator;
+}
+
+
+/*
+Frees the allocator and its bitmap.
+*/
+void free_frame_allocator(FrameAllocator* allocator) {
+    free(allocator->bitmap);
+    free(allocator);
+}
+
+
+/**
+ * @brief Takes the lowest-numbered free frame out of the allocator.
+ * 
+ * @param allocator The frame allocator
+ * @return The index of the frame, or -1 if there are no free frames
+ */
+int64_t allocate_frame(FrameAllocator* allocator) {
+    if (allocator->num_free == 0)
+        return -1;
+
+    uint32_t num_words = (allocator->num_frames + 63) / 64;
+    for (uint32_t i = allocator->search_start; i < num_words; i++) {
+        if (allocator->bitmap[i] == 0)
+            continue;
+
+        int bit = __builtin_ctzll(allocator->bitmap[i]);
+        allocator->bitmap[i] &= ~((uint64_t)1 << bit);
+        allocator->num_free--;
+        allocator->search_start = i;
+
+        return (int64_t)i * 64 + bit;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Takes `count` free frames out of the allocator, lowest-numbered first. Either all of the frames 
+ * are allocated or none are.
+ * 
+ * @param allocator The frame allocator
+ * @param count The number of frames to allocate
+ * @param frames Array to put the indexes of the frames into, at least count long
+ * @return 0 if the frames were allocated, or -1 if there were not enough free frames
+ */
+int allocate_frames(FrameAllocator* allocator, uint32_t count, uint32_t* frames) {
+    if (allocator->num_free < count)
+        return -1;
+
+    uint32_t num_words = (allocator->num_frames + 63) / 64;
+    uint32_t found = 0;
+    for (uint32_t i = allocator->search_start; i < num_words && found < count; i++) {
+        // take every free frame in this word, or as many as are still needed
+        while (allocator->bitmap[i] != 0 && found < count) {
+            int bit = __builtin_ctzll(allocator->bitmap[i]);
+            allocator->bitmap[i] &= allocator->bitmap[i] - 1;
+            frames[found++] = i * 64 + bit;
+        }
+
+        allocator->search_start = i;
+    }
+
+    allocator->num_free -= count;
+    return 0;
+}
+
+
+/**
+ * @brief Takes a run of `count` contiguous free frames out of the allocator, starting at a frame which 
+ * is a multiple of `count`, for pages larger than a single frame.
+ * 
+ * @param allocator The frame allocator
+ * @param count The number of frames, which must be a power of 2 no larger than 64
+ * @return The index of the first frame, or -1 if there is no free run
+ */
+int64_t allocate_aligned_frames(FrameAllocator* allocator, uint32_t count) {
+    if (allocator->num_free < count)
+        return -1;
+
+    uint64_t run = count == 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+    uint32_t num_words = (allocator->num_frames + 63) / 64;
+    for (uint32_t i = allocator->search_start; i < num_words; i++) {
+        for (uint32_t bit = 0; bit < 64 && allocator->bitmap[i] != 0; bit += count) {
+            if (((allocator->bitmap[i] >> bit) & run) != run)
+                continue;
+
+            allocator->bitmap[i] &= ~(run << bit);
+            allocator->num_free -= count;
+
+            return (int64_t)i * 64 + bit;
+        }
+    }
+
+    return -1;
+}
+
+
+/*
+Returns the frame to the allocator so it can be handed out again. Releasing a frame which is already free 
+does nothing, so that it cannot be counted as free twice.
+*/
+void release_frame(FrameAllocator* allocator, uint32_t frame) {
+    if ((allocator->bitmap[frame / 64] >> (frame % 64)) & 1)
+        return;
+
+    allocator->bitmap[frame / 64] |= (uint64_t)1 << (frame % 64);
+    allocator->num_free++;
+    if (frame / 64 < allocator->search_start)
+        allocator->search_start = frame / 64;
+}
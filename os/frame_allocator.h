@@ -0,0 +1,26 @@
+#ifndef FRAMEALLOCATOR
+#define FRAMEALLOCATOR
+
+#include <stdint.h>
+
+
+/**
+ * @brief Tracks which physical frames are free with one bit per frame (1 = free), so that a free frame
+ * can be found 64 frames at a time by looking for the first set bit in each word.
+ */
+typedef struct FrameAllocator {
+    uint64_t* bitmap;
+    uint32_t num_frames;
+    uint32_t num_free;
+    uint32_t search_start; // index of the first word of the bitmap which may have a free frame
+} FrameAllocator;
+
+
+FrameAllocator* new_frame_allocator(uint32_t num_frames);
+void free_frame_allocator(FrameAllocator* allocator);
+int64_t allocate_frame(FrameAllocator* allocator);
+int allocate_frames(FrameAllocator* allocator, uint32_t count, uint32_t* frames);
+int64_t allocate_aligned_frames(FrameAllocator* allocator, uint32_t count);
+void release_frame(FrameAllocator* allocator, uint32_t frame);
+
+#endif
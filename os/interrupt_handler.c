@@ -7,6 +7,30 @@
 #include "../registers.h"
 #include "../internal_memory.h"
 
+#define STR_CHUNK_LEN 64
+#define PATH_LEN 100
+
+
+/**
+ * @brief Reads a path from a string in the memory of a process, one character per word, ending at 
+ * the first 0x0000 or after PATH_LEN - 1 characters.
+ * 
+ * @param process The process the string belongs to
+ * @param address The logical address of the string
+ * @param buffer Buffer to put the path into, PATH_LEN long
+ * @param machine The machine the process runs on
+ */
+void read_process_path(Process* process, uint32_t address, char* buffer, Machine* machine) {
+    uint16_t name[PATH_LEN];
+    read_process_memory(process, address, name, PATH_LEN, machine);
+    for (int i = 0; i < PATH_LEN; i++) {
+        buffer[i] = name[i] & 0x00FF;
+        if (buffer[i] == '\0')
+            break;
+    }
+
+    buffer[PATH_LEN - 1] = '\0';
+}
 
 
 /**
@@ -17,13 +41,16 @@
  * @note When reading or printing, the `printable` union should be used for integers and floats. This 
  * ensures they can be represented and printed properly.
  * 
+ * @note Interrupts are handled in the kernel, so under the kernel lock.
+ * 
  * @param code The interrupt code
- * @param registers The system registers
- * @param ram The system RAM
- * @param process The process calling the interrupt
- * @param hd_img File pointer to the image of the harddrive
+ * @param machine The machine the process runs on
+ * @param process The process calling the interrupt, whose CPU holds its registers
  */
-void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, Process* process, FILE* hd_img) {
+void handle_interrupt_code(unsigned short code, Machine* machine, Process* process) {
+    uint32_t* registers = process->cpu->registers;
+    lock_kernel(machine);
+
     // represent values that can be read or printed
     union {
         int i;
@@ -37,25 +64,29 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
     int32_t sbrk_pages_offset;
     uint32_t addr_to_get, offset, buffer_len;
     wchar_t char_to_print, *str_input_buffer;
+    uint16_t str_chunk[STR_CHUNK_LEN], *str_ram_buffer;
     switch (code) {
         case 1:  // print signed int in $g8, $g9
-            printf("%d\n", printable.i);
+            fprintf(get_process_output(process), "%d\n", printable.i);
             break;
 
         case 2:  // print float in $g8, $g9
-            printf("%f\n", printable.f);
+            fprintf(get_process_output(process), "%f\n", printable.f);
             break;
 
         case 3:  // print str starting at addr in $ua, $g9, ending at next 0x0000 in RAM
             addr_to_get = (get_register(11, registers).word_16 << 16) | get_register(10, registers).word_16;
-            offset = 0;
-            while (get_from_ram(ram, addr_to_get + offset) != 0) {
-                char_to_print = get_from_ram(ram, addr_to_get + offset);
-                printf("%c", char_to_print);
-                offset++;
-            }
+            do {
+                read_process_memory(process, addr_to_get, str_chunk, STR_CHUNK_LEN, machine);
+                for (offset = 0; offset < STR_CHUNK_LEN && str_chunk[offset] != 0; offset++) {
+                    char_to_print = str_chunk[offset];
+                    fprintf(get_process_output(process), "%c", char_to_print);
+                }
 
-            printf("\n");
+                addr_to_get += STR_CHUNK_LEN;
+            } while (offset == STR_CHUNK_LEN);
+
+            fprintf(get_process_output(process), "\n");
             
             break;
 
@@ -82,7 +113,7 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
         case 6:  // read str into addr in $ua, $g9 of length in $g8
             // allocate size of buffer of characters to read
             buffer_len = get_register(9, registers).word_16;
-            str_input_buffer = malloc(buffer_len * sizeof(wchar_t)); 
+            str_input_buffer = calloc(buffer_len, sizeof(wchar_t)); 
 
             // flush standard input and then get the string from the user
             fflush(stdin);
@@ -98,16 +129,20 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
 
             // add to ram
             addr_to_get = (get_register(11, registers).word_16 << 16) | get_register(10, registers).word_16;
+            str_ram_buffer = malloc(buffer_len * sizeof(uint16_t));
             for (unsigned int i = 0; i < buffer_len; i++) {
-                add_to_ram(ram, addr_to_get + i, str_input_buffer[i]);
+                str_ram_buffer[i] = str_input_buffer[i];
             }
 
+            write_process_memory(process, addr_to_get, str_ram_buffer, buffer_len, machine);
+
+            free(str_ram_buffer);
             free(str_input_buffer);
             break;
 
         case 7: // allocate heap memory, length in bytes of len at $g8, $g9
             addr_to_get = (get_register(10, registers).word_16 << 16) | get_register(9, registers).word_16;
-            addr_to_get = allocate_memory(process->heap_root, addr_to_get);
+            addr_to_get = allocate_memory(process->heap_root, addr_to_get, process->stack_bottom);
             upper_bits.word_16 = (addr_to_get & 0xFFFF0000) >> 16;
             lower_bits.word_16 = addr_to_get & 0x0000FFFF;
             update_register(9, upper_bits, registers);
@@ -115,35 +150,37 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
             break;
 
         case 8: { // open file with name in str starting at addr in $g8, $g9, puts id of open file in $g9
-            char buffer[100];
+            char buffer[PATH_LEN];
             uint32_t address = (get_register(10, registers).word_16 << 16) | get_register(9, registers).word_16;
-            for (int i = 0; i < sizeof(buffer); i++) {
-                buffer[i] = get_from_ram(ram, address + i) & 0x0000FFFF;
-                if (buffer[i] == '\0')
-                    break;
-            }
+            read_process_path(process, address, buffer, machine);
 
-            FATPtr* file_ptr = f_open(hd_img, buffer);
+            seek_root_dir(machine->hd_img);
+            FATPtr* file_ptr = f_open(machine->fs, machine->hd_img, buffer);
             Register id;
-            id.word_16 = file_ptr->id;
+            id.word_16 = file_ptr == NULL ? 0xFFFF : file_ptr->id;
             update_register(10, id, registers);
             break;
         } 
 
         case 9: { // read no. bytes in $g8 from file id in $g9 into buffer at $ua, $g7
-            FATPtr* fileptr = get_open_file_id(GET_REG_VAL(10));
+            FATPtr* fileptr = get_open_file_id(machine->fs, read_register(registers, 10));
 
             // read the data from the file
-            const int data_len = GET_REG_VAL(9);
+            const int data_len = read_register(registers, 9);
             char* buffer = malloc(data_len);
             f_read(fileptr, data_len, buffer);
             
             // put the read data into RAM
-            uint32_t buffer_addr = (GET_REG_VAL(11) << 16) | GET_REG_VAL(8);
+            uint32_t buffer_addr = (read_register(registers, 11) << 16) | read_register(registers, 8);
+            uint16_t* words = malloc(data_len * sizeof(uint16_t));
             for (int i = 0; i < data_len; i++) {
-                add_to_ram(ram, get_physical_from_logical_addr(process->id, buffer_addr + i), buffer[i]);
+                words[i] = buffer[i];
             }
 
+            write_process_memory(process, buffer_addr, words, data_len, machine);
+
+            free(words);
+            free(buffer);
             break;
         }
 
@@ -152,8 +189,9 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
             break;
 
         case 11: { // close file with ID in $g9
-            FATPtr* fileptr = get_open_file_id(GET_REG_VAL(10));
-            f_close(fileptr, GET_REG_VAL(10));
+            FATPtr* fileptr = get_open_file_id(machine->fs, read_register(registers, 10));
+            f_close(fileptr, read_register(registers, 10));
+            break;
         }
 
         case 12: // MIDI out, MIDI code in $g9
@@ -187,25 +225,65 @@ void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, P
             break;
 
         case 18: // print integer in $g9 as hex
-            printf("%X\n", printable.i);
+            fprintf(get_process_output(process), "%X\n", printable.i);
             break;
 
         case 19: // print integer in $g8, $g9 as unsigned int
-            printf("%u\n", printable.i);
+            fprintf(get_process_output(process), "%u\n", printable.i);
             break;
         
         case 20: // "sbrk" syscall, increases heap into stack by $g8, $g9 pages (signed)
             sbrk_pages_offset = (get_register(10, registers).word_16 << 16) | get_register(9, registers).word_16;
-            change_heap_size(sbrk_pages_offset, process);
+            change_heap_size(sbrk_pages_offset, process, machine);
             break;
         
         case 21: // create new file
         case 22: // delete file
             printf("Valid unimplemented syscall detected!\n");
             break;
+
+        case 23: { // fork, $g9 is 0 in the child and the child's id in the parent, or $g8, $g9 is -1 on failure
+            Register pc = get_register(15, registers);
+            Register child_pc, zero;
+            child_pc.word_32 = pc.word_32 + 1;
+            zero.word_16 = 0;
+
+            // the child resumes after the syscall, as its registers are loaded rather than stepped past it
+            update_register(9, zero, registers);
+            update_register(10, zero, registers);
+            update_register(15, child_pc, registers);
+            Process* child = fork_process(process, machine);
+            update_register(15, pc, registers);
+
+            upper_bits.word_16 = child == NULL ? 0xFFFF : 0;
+            lower_bits.word_16 = child == NULL ? 0xFFFF : child->id;
+            update_register(9, upper_bits, registers);
+            update_register(10, lower_bits, registers);
+            break;
+        }
         
-        default:
-            printf("Invalid syscall detected!");
-            exit(-5);
+        case 24: { // exec the program on the harddrive at the path in str starting at addr in $g8, $g9, puts its id in $g9, or $g8, $g9 is -1 on failure
+            char path[PATH_LEN];
+            uint32_t address = (get_register(10, registers).word_16 << 16) | get_register(9, registers).word_16;
+            read_process_path(process, address, path, machine);
+
+            Process* new_process = NULL;
+            int id = get_free_process_id(machine, 0);
+            if (id >= 0)
+                new_process = new_process_from_disk(id, path, 0, NULL, machine);
+            if (new_process != NULL)
+                new_process->output = process->output;
+
+            upper_bits.word_16 = new_process == NULL ? 0xFFFF : 0;
+            lower_bits.word_16 = new_process == NULL ? 0xFFFF : new_process->id;
+            update_register(9, upper_bits, registers);
+            update_register(10, lower_bits, registers);
+            break;
+        }
+
+        default: // decode_command marks invalid syscalls as faulting, so they are never executed
+            break;
     }
+
+    unlock_kernel(machine);
 }
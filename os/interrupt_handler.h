@@ -4,10 +4,12 @@
 #include <stdint.h>
 #include "../registers.h"
 #include "../internal_memory.h"
+#include "../machine.h"
 #include "microkernel.h"
 
+#define MAX_SYSCALL 24 // syscall codes from 1 up to this are valid
 
-void handle_interrupt_code(unsigned short code, Register* registers, RAM* ram, Process* process, FILE* hd_img);
-void print_open_files();
+
+void handle_interrupt_code(unsigned short code, Machine* machine, Process* process);
 
 #endif
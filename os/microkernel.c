@@ -1,240 +1,1497 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include "microkernel.h"
+#include "filesystem/fat_functions.h"
 #include "../internal_memory.h"
 #include "../registers.h"
 #include "../control_unit.h"
+#include "../decode_cache.h"
+#include "../threaded_core.h"
+#include "../translator.h"
+#include "../jit.h"
 #include "../ALU.h"
+#include "run_queue.h"
 
 
-MMUEntry* MMU = NULL;
-Process** processes = NULL;
-uint8_t num_active_processes = 0;
 const uint8_t max_processes = 255;
 
 
 /**
- * @brief Initialise all the processes in the array to NULL
+ * @brief Initialise all the processes in the array of a machine to NULL, and give each CPU a run queue 
+ * if there is more than one.
+ * 
+ * @param machine The machine to initialise the processes of
+ */
+void init_processes(Machine* machine) {
+    machine->processes = malloc(sizeof(Process*) * 255);
+    for (int i = 0; i < max_processes; i++) {
+        machine->processes[i] = NULL;
+    }
+
+    for (uint8_t i = 0; i < machine->num_cpus && machine->num_cpus > 1; i++) {
+        machine->cpus[i].run_queue = new_run_queue(max_processes);
+    }
+}
+
+
+/**
+ * @brief Initialises the memory management unit (MMU), which is an inverted page table. Entries are only 
+ * created for frames as they are first handed out, so the MMU grows with the memory actually used rather 
+ * than the size of physical memory.
+ * 
+ * @param machine The machine to initialise the MMU of
+ * @param num_frames The number of frames of physical memory, at most MAX_PHYSICAL_FRAMES
+ */
+void init_MMU(Machine* machine, uint32_t num_frames) {
+    machine->num_physical_frames = num_frames;
+    machine->MMU_size = 0;
+    machine->MMU = NULL;
+
+    // the last frame is never handed out, so that NO_PHYSICAL_ADDR is never the address of a real word
+    machine->frame_allocator = new_frame_allocator(num_frames < MAX_PHYSICAL_FRAMES ? num_frames : MAX_PHYSICAL_FRAMES - 1);
+    machine->shared_pages = malloc(sizeof(int32_t) * SHARED_PAGE_BUCKETS);
+    if (machine->shared_pages == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR MMU!\n");
+        exit(-1);
+    }
+
+    for (int i = 0; i < SHARED_PAGE_BUCKETS; i++) {
+        machine->shared_pages[i] = -1;
+    }
+
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        init_decode_cache(&machine->cpus[i]);
+    }
+}
+
+
+/**
+ * @brief Frees what init_processes, init_MMU, init_TLB and init_swap set up on a machine, destroying any 
+ * processes still in it first so that their swap slots and frames are released.
+ * 
+ * @param machine The machine to free the kernel of, which must not be running
+ */
+void free_kernel(Machine* machine) {
+    if (machine->processes != NULL) {
+        for (int i = 0; i < max_processes; i++) {
+            if (machine->processes[i] != NULL)
+                destroy_process(machine->processes[i], machine);
+        }
+
+        free(machine->processes);
+        machine->processes = NULL;
+        machine->num_active_processes = 0;
+    }
+
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        CPU* cpu = &machine->cpus[i];
+        if (cpu->run_queue != NULL)
+            free_run_queue(cpu->run_queue);
+        if (cpu->tlb != NULL)
+            free_TLB(cpu->tlb);
+        if (cpu->decode_cache != NULL)
+            free_decode_cache(cpu);
+
+        cpu->run_queue = NULL;
+        cpu->tlb = NULL;
+    }
+
+    if (machine->swap_device != NULL)
+        free_swap_device(machine->swap_device);
+    if (machine->frame_allocator != NULL)
+        free_frame_allocator(machine->frame_allocator);
+
+    free(machine->MMU);
+    free(machine->shared_pages);
+    machine->swap_device = NULL;
+    machine->frame_allocator = NULL;
+    machine->MMU = NULL;
+    machine->shared_pages = NULL;
+}
+
+
+/**
+ * @brief Makes sure the MMU has an entry for the given frame, growing it if not. The frame allocator 
+ * hands out the lowest free frames first, so the MMU only grows as far as the most memory in use at once.
+ * 
+ * @attention Pointers to MMU entries are invalidated when it grows, so must not be held across a frame 
+ * being allocated
+ * 
+ * @param frame The index of the frame
+ * @param machine The machine the MMU belongs to
+ */
+void grow_MMU(uint32_t frame, Machine* machine) {
+    if (frame < machine->MMU_size)
+        return;
+
+    uint32_t new_size = machine->MMU_size < 64 ? 64 : machine->MMU_size * 2;
+    while (new_size <= frame)
+        new_size *= 2;
+    if (new_size > machine->num_physical_frames)
+        new_size = machine->num_physical_frames;
+
+    machine->MMU = realloc(machine->MMU, sizeof(MMUEntry) * new_size);
+    if (machine->MMU == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR MMU!\n");
+        exit(-1);
+    }
+
+    for (uint32_t i = machine->MMU_size; i < new_size; i++) {
+        MMUEntry new_node;
+        new_node.allocated = 0;
+        new_node.referenced = 0;
+        new_node.shared = 0;
+        new_node.large = 0;
+        new_node.ref_count = 0;
+        new_node.content_hash = 0;
+        new_node.next_shared = -1;
+        new_node.process_id = 0;
+        new_node.logical_start_addr = 0;
+        new_node.physical_start_addr = i * PAGE_SIZE;
+        new_node.type = FREE_PAGE;
+        machine->MMU[i] = new_node;
+    }
+
+    machine->MMU_size = new_size;
+}
+
+
+/**
+ * @brief Initialises the translation lookaside buffer of each CPU, which caches the translations of the 
+ * process running on it.
+ * 
+ * @param machine The machine whose CPUs the TLBs belong to
+ * @param size The number of entries in each TLB
+ */
+void init_TLB(Machine* machine, uint32_t size) {
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        machine->cpus[i].tlb = new_TLB(size);
+    }
+}
+
+
+/**
+ * @brief Prints the hit and miss counts of the TLB of each CPU.
+ */
+void print_TLB(Machine* machine) {
+    for (uint8_t i = 0; i < machine->num_cpus; i++) {
+        if (machine->num_cpus > 1)
+            printf("CPU %d:\n", i);
+        print_TLB_stats(machine->cpus[i].tlb);
+    }
+}
+
+
+/*
+Drops the translation of the page holding a logical address of a process from the TLB of the CPU it last
+ran on, if that TLB still holds its translations. No other TLB can.
+*/
+void invalidate_process_page(Process* process, uint32_t logical_addr) {
+    if (process->cpu != NULL && process->cpu->tlb->process_id == process->id)
+        invalidate_TLB_page(process->cpu->tlb, logical_addr);
+}
+
+
+/**
+ * @brief Opens the swap device which pages are evicted to when there are no free frames left. Without 
+ * one, running out of frames fails the allocation.
+ * 
+ * @param machine The machine to give the swap device
+ * @param path The path of the swap file, or NULL to use an anonymous temporary file
+ * @return 0 if the swap file was opened, -1 if not
+ */
+int init_swap(Machine* machine, const char* path) {
+    machine->swap_device = new_swap_device(path);
+    return machine->swap_device == NULL ? -1 : 0;
+}
+
+
+/**
+ * @brief Backs heap, stack and code regions with large pages where they cover a whole aligned large 
+ * page, falling back to ordinary pages when there is no free run of frames for one.
+ */
+void enable_large_pages(Machine* machine) {
+    machine->large_pages_enabled = 1;
+}
+
+
+/**
+ * @brief Runs processes with the threaded interpreter rather than by calling the handler of each
+ * instruction. Must be called before any process is run.
+ * 
+ * @return 0 if the threaded interpreter is enabled, -1 if it is not supported by the compiler
+ */
+int enable_threaded_interpreter(Machine* machine) {
+    if (init_threaded_core() != 0)
+        return -1;
+
+    machine->threaded_interpreter_enabled = 1;
+    return 0;
+}
+
+
+/**
+ * @brief Runs processes with the JIT, which translates their code into native code, rather than with 
+ * an interpreter. Must be called once the MMU and TLB are initialised, and before any process is run.
+ * 
+ * @return 0 if the JIT is enabled, -1 if it is not supported on this host
+ */
+int enable_jit(Machine* machine) {
+    if (init_jit(machine) != 0)
+        return -1;
+
+    machine->jit_enabled = 1;
+    return 0;
+}
+
+
+/**
+ * @brief Prints the page-in and page-out counts of the swap device, if there is one.
+ */
+void print_swap(Machine* machine) {
+    if (machine->swap_device == NULL)
+        printf("Swap disabled\n");
+    else
+        print_swap_stats(machine->swap_device);
+}
+
+
+/**
+ * @brief Debug to check the MMU is working correctly.
+ */
+void print_MMU(Machine* machine, int num_pages) {
+    int pages_to_print = num_pages > 0 && num_pages < machine->MMU_size ? num_pages : machine->MMU_size;
+    printf("Logical\t\tPhysical\tType\tProcess\n");
+    for (int i = 0; i < pages_to_print; i++) {
+        if (machine->MMU[i].allocated == 0)
+            printf("0x%04X: NOT ALLOCATED\n", i);
+        else
+            printf(
+                "0x%08lX:\t0x%08lX\t(%c)\t%d\n", machine->MMU[i].logical_start_addr, 
+                machine->MMU[i].physical_start_addr, machine->MMU[i].type, machine->MMU[i].process_id
+            );
+    }
+}
+
+
+/**
+ * @brief Gives an allocated frame to a process as a page of the given type, mapped at the given logical 
+ * address.
+ * 
+ * @param process The process receiving the page
+ * @param type The type of the new page
+ * @param frame The index of the frame in the MMU
+ * @param logical_addr The logical address of the first word of the page
+ * @param machine The machine the process runs on
+ * @return Pointer to the frame's MMU entry
+ */
+MMUEntry* assign_frame(Process* process, char type, uint32_t frame, uint32_t logical_addr, Machine* machine) {
+    machine->MMU[frame].allocated = 1;
+    machine->MMU[frame].referenced = 1;
+    machine->MMU[frame].shared = 0;
+    machine->MMU[frame].large = 0;
+    machine->MMU[frame].ref_count = 1;
+    machine->MMU[frame].process_id = process->id;
+    machine->MMU[frame].type = type;
+
+    machine->MMU[frame].logical_start_addr = logical_addr;
+    map_page(process->page_table, logical_addr, frame, 0);
+    invalidate_process_page(process, logical_addr);
+
+    // the frame's last contents may still be decoded
+    invalidate_decoded_frame(machine, process->cpu, frame);
+
+    return &machine->MMU[frame];
+}
+
+
+/**
+ * @brief Splits the large page holding the logical address into ordinary pages in a process's page 
+ * table, so that one of its pages can be changed on its own. The frames stay where they are, and other 
+ * processes mapping the same frames keep their large page.
+ * 
+ * @param process The process whose mapping is split
+ * @param logical_addr A logical address in the large page
+ * @param machine The machine the process runs on
+ */
+void split_large_page(Process* process, uint32_t logical_addr, Machine* machine) {
+    uint32_t large_start = logical_addr & ~(LARGE_PAGE_SIZE - 1);
+    for (uint32_t addr = large_start; addr < large_start + LARGE_PAGE_SIZE; addr += PAGE_SIZE) {
+        PageTableEntry* entry = get_page_table_entry(process->page_table, addr, 0);
+        if (entry != NULL)
+            *entry &= ~PTE_LARGE;
+    }
+
+    invalidate_process_page(process, large_start);
+}
+
+
+/**
+ * @brief Frees a frame by writing the page in it out to swap, picking the page with the clock (second 
+ * chance) algorithm: the clock hand sweeps round the MMU, and a page which has been translated since 
+ * the hand last passed has its referenced bit cleared and is skipped, so only cold pages are evicted.
+ * 
+ * @note Clearing a referenced bit also drops the page from the TLB, so that the next use of the page 
+ * goes through translation and sets the bit again.
+ * 
+ * @note With more than one CPU, the pages of processes running on other CPUs are skipped, as they may be 
+ * using them without going through the kernel.
+ * 
+ * @param process The process the frame is wanted for
+ * @param machine The machine to evict a frame from
+ * @return 0 if a frame was freed, -1 if there is no swap device or nothing could be evicted
+ */
+int evict_frame(Process* process, Machine* machine) {
+    if (machine->swap_device == NULL)
+        return -1;
+
+    for (uint32_t scanned = 0; scanned < 2 * machine->MMU_size; scanned++) {
+        uint32_t frame = machine->clock_hand % machine->MMU_size;
+        MMUEntry* page = &machine->MMU[frame];
+        machine->clock_hand = (frame + 1) % machine->MMU_size;
+
+        // frames mapped by more than one process are never evicted, as only the owner's page is known
+        if (page->allocated == 0 || page->shared == 1 || page->ref_count > 1)
+            continue;
+
+        // nor are frames left by a forked process which exited before the survivor wrote to them
+        Process* owner = machine->processes[page->process_id];
+        if (owner == NULL || (lookup_page(owner->page_table, page->logical_start_addr) & PTE_FRAME_MASK) != frame)
+            continue;
+
+        if (owner != process && owner->cpu != NULL && owner->cpu->process == owner)
+            continue;
+
+        if (page->referenced == 1) {
+            page->referenced = 0;
+            invalidate_process_page(owner, page->logical_start_addr);
+            continue;
+        }
+
+        uint16_t words[PAGE_SIZE];
+        ram_read_block(machine->ram, page->physical_start_addr, words, PAGE_SIZE);
+        int64_t slot = swap_out_page(machine->swap_device, words, PAGE_SIZE, page->type);
+        if (slot < 0)
+            return -1;
+
+        if ((lookup_page(owner->page_table, page->logical_start_addr) & PTE_LARGE) != 0)
+            split_large_page(owner, page->logical_start_addr, machine);
+
+        *get_page_table_entry(owner->page_table, page->logical_start_addr, 0) = PTE_SWAPPED | slot;
+        invalidate_process_page(owner, page->logical_start_addr);
+
+        ram_release_block(machine->ram, page->physical_start_addr, PAGE_SIZE);
+        page->allocated = 0;
+        page->type = FREE_PAGE;
+        release_frame(machine->frame_allocator, frame);
+
+        return 0;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Gets a free frame, evicting a page to swap to make one if there are none left.
+ * 
+ * @param process The process the frame is wanted for
+ * @param machine The machine to obtain a frame in
+ * @return The index of the frame, or -1 if no frame could be found
+ */
+int64_t obtain_frame(Process* process, Machine* machine) {
+    int64_t frame = allocate_frame(machine->frame_allocator);
+    if (frame < 0 && evict_frame(process, machine) == 0)
+        frame = allocate_frame(machine->frame_allocator);
+
+    if (frame >= 0)
+        grow_MMU(frame, machine);
+
+    return frame;
+}
+
+
+/**
+ * @brief Takes the ID of a process and assigns a new page to it, if there is one, and returns a
+ * pointer to the page, or NULL if one cannot be found. 
+ * 
+ * @param process The process requesting a page
+ * @param type The type of the new page
+ * @param machine The machine the process runs on
+ * @return MMUEntry* if a page is found, NULL if not
+ */
+MMUEntry* request_new_page(Process* process, char type, Machine* machine) {
+    int64_t frame = obtain_frame(process, machine);
+    if (frame < 0)
+        return NULL;
+
+    process->max_addr += PAGE_SIZE;
+    return assign_frame(process, type, frame, process->max_addr - PAGE_SIZE, machine);
+}
+
+
+/**
+ * @brief Assigns a number of new pages to a process, one after the other in its logical memory, if 
+ * there are enough free frames for all of them.
+ * 
+ * @param process The process requesting pages
+ * @param type The type of the new pages
+ * @param count The number of pages
+ * @param machine The machine the process runs on
+ * @return MMUEntry* of the first page if the pages are found, NULL if not
+ */
+MMUEntry* request_new_pages(Process* process, char type, uint32_t count, Machine* machine) {
+    while (machine->frame_allocator->num_free < count && evict_frame(process, machine) == 0);
+
+    uint32_t* frames = malloc(sizeof(uint32_t) * count);
+    if (count == 0 || frames == NULL || allocate_frames(machine->frame_allocator, count, frames) != 0) {
+        free(frames);
+        return NULL;
+    }
+
+    // frames come out lowest first, so the last is the highest
+    grow_MMU(frames[count - 1], machine);
+
+    uint32_t start_addr = process->max_addr;
+    process->max_addr += count * PAGE_SIZE;
+    for (uint32_t i = 0; i < count; i++) {
+        assign_frame(process, type, frames[i], start_addr + i * PAGE_SIZE, machine);
+    }
+
+    MMUEntry* first = &machine->MMU[frames[0]];
+    free(frames);
+    return first;
+}
+
+
+/**
+ * @brief Hashes the contents of a page with FNV-1a, to find identical pages to share.
+ * 
+ * @param words The contents of the page
+ * @param len The length of the page, PAGE_SIZE or LARGE_PAGE_SIZE
+ * @return The hash of the page
+ */
+uint32_t hash_page(const uint16_t* words, uint32_t len) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < len; i++) {
+        hash = (hash ^ (words[i] & 0xFF)) * 16777619u;
+        hash = (hash ^ (words[i] >> 8)) * 16777619u;
+    }
+
+    return hash;
+}
+
+
+/**
+ * @brief Looks for a shared frame of the given type holding exactly the given page, checking the 
+ * contents of every frame with a matching hash so that a collision can never share the wrong page.
+ * 
+ * @param words The contents of the page
+ * @param len The length of the page, PAGE_SIZE or LARGE_PAGE_SIZE for a large page
+ * @param hash The hash of the page
+ * @param type The type of the page
+ * @param machine The machine to search
+ * @return The index of the frame, or the first frame of a large page, or -1 if there is none
+ */
+int32_t find_shared_frame(const uint16_t* words, uint32_t len, uint32_t hash, char type, Machine* machine) {
+    uint16_t contents[PAGE_SIZE];
+    char large = len > PAGE_SIZE;
+    for (int32_t frame = machine->shared_pages[hash % SHARED_PAGE_BUCKETS]; frame != -1; frame = machine->MMU[frame].next_shared) {
+        if (machine->MMU[frame].content_hash != hash || machine->MMU[frame].type != type || machine->MMU[frame].large != large)
+            continue;
+
+        uint32_t offset = 0;
+        for (; offset < len; offset += PAGE_SIZE) {
+            ram_read_block(machine->ram, machine->MMU[frame].physical_start_addr + offset, contents, PAGE_SIZE);
+            if (memcmp(contents, words + offset, sizeof(contents)) != 0)
+                break;
+        }
+
+        if (offset >= len)
+            return frame;
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Adds a frame to the shared page table so that other processes loading the same page map it 
+ * instead of copying it.
+ * 
+ * @param frame The index of the frame in the MMU
+ * @param hash The hash of the frame's contents
+ * @param machine The machine the frame is in
+ */
+void share_frame(uint32_t frame, uint32_t hash, Machine* machine) {
+    machine->MMU[frame].shared = 1;
+    machine->MMU[frame].content_hash = hash;
+    machine->MMU[frame].next_shared = machine->shared_pages[hash % SHARED_PAGE_BUCKETS];
+    machine->shared_pages[hash % SHARED_PAGE_BUCKETS] = frame;
+}
+
+
+/**
+ * @brief Removes a frame from the shared page table, so that no more processes can map it. A frame of a 
+ * shared large page takes the whole large page out with it.
+ * 
+ * @param frame The index of the frame in the MMU
+ * @param machine The machine the frame is in
+ */
+void unshare_frame(uint32_t frame, Machine* machine) {
+    if (machine->MMU[frame].large == 1) {
+        frame &= ~(LARGE_PAGE_FRAMES - 1);
+        for (uint32_t i = 1; i < LARGE_PAGE_FRAMES; i++) {
+            machine->MMU[frame + i].shared = 0;
+        }
+    }
+
+    int32_t* link = &machine->shared_pages[machine->MMU[frame].content_hash % SHARED_PAGE_BUCKETS];
+    while (*link != -1 && *link != frame) {
+        link = &machine->MMU[*link].next_shared;
+    }
+
+    if (*link == frame)
+        *link = machine->MMU[frame].next_shared;
+
+    machine->MMU[frame].shared = 0;
+    machine->MMU[frame].next_shared = -1;
+}
+
+
+/**
+ * @brief Handles a process writing to a read-only page. If other processes still map the frame the 
+ * process is given its own copy of the page, otherwise it is the last user and the frame just becomes 
+ * its own writable page.
+ * 
+ * @param process The process which wrote to the page
+ * @param logical_addr The logical address which was written to
+ * @param entry The page table entry of the page
+ * @param machine The machine the process runs on
+ * @return The new page table entry for the page, or 0 if there are no free frames for the copy
+ */
+PageTableEntry handle_write_fault(Process* process, uint32_t logical_addr, PageTableEntry entry, Machine* machine) {
+    if ((entry & PTE_LARGE) != 0) {
+        split_large_page(process, logical_addr, machine);
+        entry &= ~PTE_LARGE;
+    }
+
+    uint32_t frame = entry & PTE_FRAME_MASK;
+    uint32_t page_addr = logical_addr & ~(PAGE_SIZE - 1);
+
+    if (machine->MMU[frame].ref_count <= 1) {
+        if (machine->MMU[frame].shared == 1)
+            unshare_frame(frame, machine);
+
+        machine->MMU[frame].process_id = process->id;
+        machine->MMU[frame].logical_start_addr = page_addr;
+        map_page(process->page_table, page_addr, frame, 0);
+        invalidate_process_page(process, page_addr);
+
+        return lookup_page(process->page_table, logical_addr);
+    }
+
+    int64_t new_frame = obtain_frame(process, machine);
+    if (new_frame < 0) {
+        printf("No free frame to copy page 0x%08X of process %d\n", logical_addr, process->id);
+        return 0;
+    }
+
+    uint16_t words[PAGE_SIZE];
+    ram_read_block(machine->ram, machine->MMU[frame].physical_start_addr, words, PAGE_SIZE);
+    machine->MMU[frame].ref_count--;
+
+    MMUEntry* page = assign_frame(process, machine->MMU[frame].type, new_frame, page_addr, machine);
+    ram_write_block(machine->ram, page->physical_start_addr, words, PAGE_SIZE);
+
+    return lookup_page(process->page_table, logical_addr);
+}
+
+
+/**
+ * @brief Backs the whole large page holding the logical address with an aligned run of frames, if large 
+ * pages are enabled, the large page is entirely within the process's heap and stack, and none of it is 
+ * backed or swapped out yet.
+ * 
+ * @param process The process which touched the page
+ * @param logical_addr The logical address which was touched
+ * @param machine The machine the process runs on
+ * @return 0 if the large page was backed, -1 if not
+ */
+int back_large_page(Process* process, uint32_t logical_addr, Machine* machine) {
+    uint32_t large_start = logical_addr & ~(LARGE_PAGE_SIZE - 1);
+    if (machine->large_pages_enabled == 0 || large_start < process->heap_start || large_start + LARGE_PAGE_SIZE > process->max_addr)
+        return -1;
+
+    for (uint32_t addr = large_start; addr < large_start + LARGE_PAGE_SIZE; addr += PAGE_SIZE) {
+        if (lookup_page(process->page_table, addr) != 0)
+            return -1;
+    }
+
+    int64_t first_frame = allocate_aligned_frames(machine->frame_allocator, LARGE_PAGE_FRAMES);
+    if (first_frame < 0)
+        return -1;
+
+    grow_MMU(first_frame + LARGE_PAGE_FRAMES - 1, machine);
+
+    for (uint32_t i = 0; i < LARGE_PAGE_FRAMES; i++) {
+        uint32_t addr = large_start + i * PAGE_SIZE;
+        assign_frame(process, addr < process->stack_bottom ? HEAP_PAGE : STACK_PAGE, first_frame + i, addr, machine);
+        map_page(process->page_table, addr, first_frame + i, PTE_LARGE);
+        machine->MMU[first_frame + i].large = 1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Handles a process touching a page it has reserved but which is not backed by a frame yet, by 
+ * giving it a new frame, or a whole large page of frames if it can. Heap and stack pages are only 
+ * reserved as ranges of logical addresses when a process is created, and get frames this way the first 
+ * time they are used.
+ * 
+ * @param process The process which touched the page
+ * @param logical_addr The logical address which was touched
+ * @param machine The machine the process runs on
+ * @return The page table entry for the newly backed page, or 0 if the address is not reserved or there
+ * are no free frames
+ */
+PageTableEntry handle_page_fault(Process* process, uint32_t logical_addr, Machine* machine) {
+    if (logical_addr < process->heap_start || logical_addr >= process->max_addr)
+        return 0;
+
+    if (back_large_page(process, logical_addr, machine) == 0)
+        return lookup_page(process->page_table, logical_addr);
+
+    int64_t frame = obtain_frame(process, machine);
+    if (frame < 0) {
+        printf("No free frame for page 0x%08X of process %d\n", logical_addr, process->id);
+        return 0;
+    }
+
+    char type = logical_addr < process->stack_bottom ? HEAP_PAGE : STACK_PAGE;
+    assign_frame(process, type, frame, logical_addr & ~(PAGE_SIZE - 1), machine);
+
+    return lookup_page(process->page_table, logical_addr);
+}
+
+
+/**
+ * @brief Brings a page which was evicted back in from swap into a new frame.
+ * 
+ * @param process The process which touched the page
+ * @param logical_addr The logical address which was touched
+ * @param slot The swap slot holding the page
+ * @param machine The machine the process runs on
+ * @return The page table entry for the page, or 0 if there are no free frames
+ */
+PageTableEntry swap_in(Process* process, uint32_t logical_addr, uint32_t slot, Machine* machine) {
+    int64_t frame = obtain_frame(process, machine);
+    if (frame < 0) {
+        printf("No free frame to swap in page 0x%08X of process %d\n", logical_addr, process->id);
+        return 0;
+    }
+
+    uint16_t words[PAGE_SIZE];
+    char type = swap_in_page(machine->swap_device, slot, words, PAGE_SIZE);
+
+    // the heap/stack boundary may have moved while the page was swapped out
+    if (type == HEAP_PAGE || type == STACK_PAGE)
+        type = logical_addr < process->stack_bottom ? HEAP_PAGE : STACK_PAGE;
+
+    MMUEntry* page = assign_frame(process, type, frame, logical_addr & ~(PAGE_SIZE - 1), machine);
+    ram_write_block(machine->ram, page->physical_start_addr, words, PAGE_SIZE);
+
+    return lookup_page(process->page_table, logical_addr);
+}
+
+
+/**
+ * @brief Get the physical address of a byte from its logical address and process id by looking it up 
+ * in the process's page table, backing it with a frame first if it is a reserved heap or stack page or 
+ * swapping it back in if it was evicted
+ * 
+ * @param process_id The id of the process the page belongs to
+ * @param logical_addr The logical address of the byte
+ * @param write TRUE if the address is being written to, which copies the page first if it is shared
+ * @param machine The machine the process runs on
+ * @return The physical address of the byte, or NO_PHYSICAL_ADDR if the process does not have that page
+ */
+uint32_t get_physical_from_logical_addr(uint16_t process_id, uint32_t logical_addr, short write, Machine* machine) {
+    if (process_id >= max_processes || machine->processes[process_id] == NULL)
+        return NO_PHYSICAL_ADDR;
+
+    PageTableEntry entry = lookup_page(machine->processes[process_id]->page_table, logical_addr);
+    if ((entry & PTE_SWAPPED) != 0)
+        entry = swap_in(machine->processes[process_id], logical_addr, entry & PTE_FRAME_MASK, machine);
+    else if (entry == 0)
+        entry = handle_page_fault(machine->processes[process_id], logical_addr, machine);
+    else if (write && (entry & PTE_READ_ONLY) != 0)
+        entry = handle_write_fault(machine->processes[process_id], logical_addr, entry, machine);
+
+    if ((entry & PTE_PRESENT) == 0)
+        return NO_PHYSICAL_ADDR;
+
+    machine->MMU[entry & PTE_FRAME_MASK].referenced = 1;
+    return ((entry & PTE_FRAME_MASK) << PAGE_OFFSET_BITS) | (logical_addr & (PAGE_SIZE - 1));
+}
+
+
+/**
+ * @brief Get the physical address of a byte from its logical address for a process running on a CPU, 
+ * using the CPU's TLB and only going to the page table, in the kernel, on a miss.
+ * 
+ * @param process The process running on the CPU
+ * @param logical_addr The logical address of the byte
+ * @param machine The machine the process runs on
+ * @return The physical address of the byte, or NO_PHYSICAL_ADDR if the process does not have that page
+ */
+uint32_t translate_address(Process* process, uint32_t logical_addr, Machine* machine) {
+    TLB* tlb = process->cpu->tlb;
+    uint32_t physical_addr;
+    if (lookup_TLB(tlb, logical_addr, &physical_addr))
+        return physical_addr;
+
+    lock_kernel(machine);
+    physical_addr = get_physical_from_logical_addr(process->id, logical_addr, 0, machine);
+    if (physical_addr != NO_PHYSICAL_ADDR) {
+        PageTableEntry entry = lookup_page(process->page_table, logical_addr);
+        if ((entry & PTE_LARGE) != 0)
+            fill_large_TLB(tlb, logical_addr, physical_addr, (entry & PTE_READ_ONLY) == 0);
+        else
+            fill_TLB(tlb, logical_addr, physical_addr, (entry & PTE_READ_ONLY) == 0);
+    }
+
+    unlock_kernel(machine);
+    return physical_addr;
+}
+
+
+/**
+ * @brief Get the physical address of a byte being written to by the process running on the CPU. Works 
+ * like translate_address, except read-only pages miss in the TLB and are copied on the way through.
+ * 
+ * @param process The process currently running on the CPU
+ * @param logical_addr The logical address of the byte
+ * @param machine The machine the process runs on
+ * @return The physical address of the byte, or NO_PHYSICAL_ADDR if the process does not have that page
+ */
+uint32_t translate_write_address(Process* process, uint32_t logical_addr, Machine* machine) {
+    TLB* tlb = process->cpu->tlb;
+    uint32_t physical_addr;
+    if (lookup_TLB_write(tlb, logical_addr, &physical_addr))
+        return physical_addr;
+
+    lock_kernel(machine);
+    physical_addr = get_physical_from_logical_addr(process->id, logical_addr, 1, machine);
+    if (physical_addr != NO_PHYSICAL_ADDR && (lookup_page(process->page_table, logical_addr) & PTE_LARGE) != 0)
+        fill_large_TLB(tlb, logical_addr, physical_addr, 1);
+    else if (physical_addr != NO_PHYSICAL_ADDR)
+        fill_TLB(tlb, logical_addr, physical_addr, 1);
+
+    unlock_kernel(machine);
+    return physical_addr;
+}
+
+
+/**
+ * @brief Creates a new HeapBlock with the given parameters, a status of 1, and NULL left and right 
+ * children.
+ * 
+ * @param start_addr The address of the first byte of the block
+ * @param size The size in bytes of the block
+ * @return A pointer to the new block
+ */
+HeapBlock* new_heap_block(long start_addr, long size) {
+    HeapBlock* block = malloc(sizeof(HeapBlock));
+    block->start_addr = start_addr;
+    block->size = size;
+    block->status = 1;
+    block->right_child = NULL;
+    block->left_child = NULL;
+
+    return block;
+}
+
+
+/**
+ * @brief Copies words out of a process's memory, translating each page of the logical range only once. 
+ * Words in pages the process does not have are read as 0.
+ * 
+ * @param process The process whose memory is being read
+ * @param logical_addr The logical address of the first word
+ * @param buffer Buffer to read the words into
+ * @param len The number of words to read
+ * @param machine The machine the process runs on
+ */
+void read_process_memory(Process* process, uint32_t logical_addr, uint16_t* buffer, uint32_t len, Machine* machine) {
+    while (len > 0) {
+        uint32_t run = PAGE_SIZE - (logical_addr % PAGE_SIZE);
+        if (run > len)
+            run = len;
+
+        uint32_t physical_addr = get_physical_from_logical_addr(process->id, logical_addr, 0, machine);
+        if (physical_addr == NO_PHYSICAL_ADDR)
+            memset(buffer, 0, run * sizeof(uint16_t));
+        else
+            ram_read_block(machine->ram, physical_addr, buffer, run);
+
+        buffer += run;
+        logical_addr += run;
+        len -= run;
+    }
+}
+
+
+/**
+ * @brief Copies words into a process's memory, translating each page of the logical range only once. 
+ * Words destined for pages the process does not have are dropped.
+ * 
+ * @param process The process whose memory is being written
+ * @param logical_addr The logical address to write the first word to
+ * @param buffer The words to write
+ * @param len The number of words to write
+ * @param machine The machine the process runs on
+ */
+void write_process_memory(Process* process, uint32_t logical_addr, const uint16_t* buffer, uint32_t len, Machine* machine) {
+    while (len > 0) {
+        uint32_t run = PAGE_SIZE - (logical_addr % PAGE_SIZE);
+        if (run > len)
+            run = len;
+
+        uint32_t physical_addr = get_physical_from_logical_addr(process->id, logical_addr, 1, machine);
+        if (physical_addr != NO_PHYSICAL_ADDR) {
+            ram_write_block(machine->ram, physical_addr, buffer, run);
+            invalidate_decoded_frame(machine, process->cpu, physical_addr >> PAGE_OFFSET_BITS);
+        }
+
+        buffer += run;
+        logical_addr += run;
+        len -= run;
+    }
+}
+
+
+/**
+ * @brief Loads a whole large page of a read-only section at the next free page, if large pages are 
+ * enabled and the next free page is aligned to a large page. The large page is shared with any process 
+ * which has loaded an identical one, like an ordinary code page.
+ * 
+ * @param process The process being loaded
+ * @param type The type of page the section is held in
+ * @param words The contents of the large page, LARGE_PAGE_SIZE words long
+ * @param machine The machine the process runs on
+ * @return 0 if the large page was loaded, -1 if it must be loaded as ordinary pages
+ */
+int load_large_page(Process* process, char type, const uint16_t* words, Machine* machine) {
+    if (machine->large_pages_enabled == 0 || process->max_addr % LARGE_PAGE_SIZE != 0)
+        return -1;
+
+    uint32_t hash = hash_page(words, LARGE_PAGE_SIZE);
+    int32_t first_frame = find_shared_frame(words, LARGE_PAGE_SIZE, hash, type, machine);
+    if (first_frame == -1) {
+        int64_t new_frames = allocate_aligned_frames(machine->frame_allocator, LARGE_PAGE_FRAMES);
+        if (new_frames < 0)
+            return -1;
+
+        grow_MMU(new_frames + LARGE_PAGE_FRAMES - 1, machine);
+
+        first_frame = new_frames;
+        for (uint32_t i = 0; i < LARGE_PAGE_FRAMES; i++) {
+            MMUEntry* page = assign_frame(process, type, first_frame + i, process->max_addr + i * PAGE_SIZE, machine);
+            ram_write_block(machine->ram, page->physical_start_addr, words + i * PAGE_SIZE, PAGE_SIZE);
+            page->large = 1;
+            page->shared = 1;
+            page->ref_count = 0;
+        }
+
+        share_frame(first_frame, hash, machine);
+    }
+
+    for (uint32_t i = 0; i < LARGE_PAGE_FRAMES; i++) {
+        machine->MMU[first_frame + i].ref_count++;
+        map_page(process->page_table, process->max_addr, first_frame + i, PTE_READ_ONLY | PTE_LARGE);
+        invalidate_process_page(process, process->max_addr);
+        process->max_addr += PAGE_SIZE;
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Gives the process one new page of the given type at the next free page and copies a page of 
+ * a section into it. A code or text page is mapped read-only to the frame of an identical page loaded 
+ * by another process if there is one.
+ * 
+ * @param process The process being loaded
+ * @param type The type of page the section is held in
+ * @param page_words The contents of the page, PAGE_SIZE words long with zeros after the section
+ * @param run The number of words of the section in the page
+ * @param machine The machine the process runs on
+ * @return 0 if the page was loaded, -1 if there is no frame for it
+ */
+int load_section_page(Process* process, char type, const uint16_t* page_words, long run, Machine* machine) {
+    if (type != CODE_PAGE && type != TEXT_PAGE) {
+        MMUEntry* page = request_new_page(process, type, machine);
+        if (page == NULL)
+            return -1;
+
+        ram_write_block(machine->ram, page->physical_start_addr, page_words, run);
+        return 0;
+    }
+
+    uint32_t hash = hash_page(page_words, PAGE_SIZE);
+    int32_t frame = find_shared_frame(page_words, PAGE_SIZE, hash, type, machine);
+    if (frame != -1) {
+        machine->MMU[frame].ref_count++;
+        process->max_addr += PAGE_SIZE;
+    } else {
+        MMUEntry* page = request_new_page(process, type, machine);
+        if (page == NULL)
+            return -1;
+
+        frame = page->physical_start_addr >> PAGE_OFFSET_BITS;
+        ram_write_block(machine->ram, page->physical_start_addr, page_words, run);
+        share_frame(frame, hash, machine);
+    }
+
+    map_page(process->page_table, process->max_addr - PAGE_SIZE, frame, PTE_READ_ONLY);
+    invalidate_process_page(process, process->max_addr - PAGE_SIZE);
+    return 0;
+}
+
+
+/**
+ * @brief Gives the process enough new pages of the given type to hold a section of its binary, starting 
+ * at the next free page, and copies the section into them. Every section gets at least one page.
+ * 
+ * Code and text pages are read-only, so each one is looked up by its contents first and the frame of an 
+ * identical page loaded by another process is mapped instead if there is one.
+ * 
+ * @param process The process being loaded
+ * @param type The type of page the section is held in
+ * @param words The contents of the section
+ * @param len The number of words in the section
+ * @param machine The machine the process runs on
+ */
+void load_section(Process* process, char type, const uint16_t* words, long len, Machine* machine) {
+    uint32_t start_addr = process->max_addr;
+    if (type != CODE_PAGE && type != TEXT_PAGE) {
+        do {
+            if (request_new_page(process, type, machine) == NULL)
+                break;
+        } while (process->max_addr < start_addr + len);
+
+        write_process_memory(process, start_addr, words, len, machine);
+        return;
+    }
+
+    uint16_t page_words[PAGE_SIZE];
+    long offset = 0;
+    do {
+        if (len - offset >= LARGE_PAGE_SIZE && load_large_page(process, type, words + offset, machine) == 0) {
+            offset += LARGE_PAGE_SIZE;
+            continue;
+        }
+
+        long run = len - offset < PAGE_SIZE ? len - offset : PAGE_SIZE;
+        memcpy(page_words, words + offset, run * sizeof(uint16_t));
+        memset(page_words + run, 0, (PAGE_SIZE - run) * sizeof(uint16_t));
+
+        if (load_section_page(process, type, page_words, run, machine) != 0)
+            break;
+
+        offset += PAGE_SIZE;
+    } while (offset < len);
+}
+
+
+/*
+Gets the host's monotonic clock in seconds, for timing processes.
+*/
+double get_wall_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/*
+Gets the stream a process prints to.
+*/
+FILE* get_process_output(Process* process) {
+    return process->output == NULL ? stdout : process->output;
+}
+
+
+/*
+Creates a process with no pages and adds it to the machine's process list under the given id.
+*/
+Process* create_process(uint8_t id, Machine* machine) {
+    Process* process = malloc(sizeof(Process));
+    process->id = id;
+    process->started = 0;
+    process->max_addr = 0;
+    process->heap_start = 0;
+    process->stack_bottom = 0;
+    process->flags.carry = 0;
+    process->flags.negative = 0;
+    process->flags.zero = 0;
+    process->heap_root = NULL;
+    process->page_table = new_page_table();
+    process->argc = 0;
+    process->args_addr = 0;
+    process->output = NULL;
+    process->exit_status = 0;
+    process->instructions_retired = 0;
+    process->start_time = get_wall_time();
+    process->report = NULL;
+    process->forked = 0;
+    process->cpu = NULL;
+    machine->processes[id] = process;
+
+    return process;
+}
+
+
+/**
+ * @brief Finishes laying out the memory of a process once its sections are loaded, by copying its 
+ * arguments into a data page and reserving its heap and stack, and counts it as active.
+ * 
+ * @param process The process being loaded
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @param machine The machine the process runs on
  */
-void init_processes() {
-    processes = malloc(sizeof(Process*) * 255);
-    for (int i = 0; i < max_processes; i++) {
-        processes[i] = NULL;
+void finish_process_layout(Process* process, int argc, char** argv, Machine* machine) {
+    if (argc > 0) {
+        long args_len = 0;
+        for (int i = 0; i < argc; i++) {
+            args_len += strlen(argv[i]) + 1;
+        }
+
+        uint16_t* args = malloc(sizeof(uint16_t) * args_len);
+        long offset = 0;
+        for (int i = 0; i < argc; i++) {
+            for (char* c = argv[i]; *c != '\0'; c++) {
+                args[offset++] = (unsigned char)*c;
+            }
+
+            args[offset++] = 0;
+        }
+
+        process->argc = argc;
+        process->args_addr = process->max_addr;
+        load_section(process, DATA_PAGE, args, args_len, machine);
+        free(args);
     }
+
+    // Reserve the default number of pages for heap and stack, which are backed by frames when first used
+    process->heap_start = process->max_addr;
+    process->stack_bottom = process->heap_start + HEAP_SIZE;
+    process->max_addr = process->stack_bottom + HEAP_SIZE;
+    process->heap_root = new_heap_block(process->heap_start, HEAP_SIZE);
+
+    machine->num_active_processes++;
+    queue_process(process, machine);
 }
 
 
 /**
- * @brief Initialises the memory management unit (MMU), which is an inverted page table.
+ * @brief Creates a new Process type to be run on the processor, with no arguments.
+ * 
+ * @param id The id of the new process
+ * @param binary_buffer The program image the process runs, with a section header or as a raw image
+ * @param prog_len The length of the program image in words
+ * @param machine The machine the process runs on
+ * @return New Process struct, or NULL if the image has an invalid header
  */
-void init_MMU() {
-    MMU = malloc(sizeof(MMUEntry) * NUM_PAGES);
-    for (int i = 0; i < NUM_PAGES; i++) {
-        MMUEntry new_node;
-        new_node.allocated = 0;
-        new_node.physical_start_addr = i * 4096;
-        new_node.type = FREE_PAGE;
-        MMU[i] = new_node;
+Process* new_process(uint8_t id, const uint16_t* binary_buffer, long prog_len, Machine* machine) {
+    return new_process_with_args(id, binary_buffer, prog_len, 0, NULL, machine);
+}
+
+
+/**
+ * @brief Creates a new Process type to be run on the processor. The process starts with the number of 
+ * arguments in $g8 and the address of the first one in $ua, $g9.
+ * 
+ * @param id The id of the new process
+ * @param binary_buffer The program image the process runs, with a section header or as a raw image
+ * @param prog_len The length of the program image in words
+ * @param argc The number of arguments
+ * @param argv The arguments, which are copied into a data page after the program's sections as strings 
+ * of one character per word, each ending in 0x0000
+ * @param machine The machine the process runs on
+ * @return New Process struct, or NULL if the image has an invalid header
+ */
+Process* new_process_with_args(uint8_t id, const uint16_t* binary_buffer, long prog_len, int argc, char** argv, Machine* machine) {
+    if (machine->num_active_processes >= 255)
+        return NULL;
+
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+    int num_sections = get_executable_sections(binary_buffer, prog_len, sections);
+    if (num_sections < 0) {
+        printf("Invalid executable header for process %d\n", id);
+        return NULL;
+    }
+
+    Process* process = create_process(id, machine);
+
+    // copy each section into its own pages
+    for (int i = 0; i < num_sections; i++) {
+        load_section(process, sections[i].type, binary_buffer + sections[i].offset, sections[i].len, machine);
     }
+
+    finish_process_layout(process, argc, argv, machine);
+    return machine->processes[id];
 }
 
 
 /**
- * @brief Debug to check the MMU is working correctly.
+ * @brief Finds the sections of a program image on the harddrive, from its header if it has one, or by 
+ * scanning it a page at a time for section markers if it is a raw image.
+ * 
+ * @param file The program image, which is left at an unknown position
+ * @param len The length of the image in words
+ * @param page_words Buffer to read the image into, PAGE_SIZE words long
+ * @param sections Array to put the sections into, MAX_EXECUTABLE_SECTIONS long
+ * @return The number of sections, or -1 if the header is invalid
  */
-void print_MMU(int num_pages) {
-    int pages_to_print = num_pages > 0 ? num_pages : NUM_PAGES;
-    printf("Logical\t\tPhysical\tType\tProcess\n");
-    for (int i = 0; i < pages_to_print; i++) {
-        if (MMU[i].allocated == 0)
-            printf("0x%04X: NOT ALLOCATED\n", i);
-        else
-            printf(
-                "0x%08lX:\t0x%08lX\t(%c)\t%d\n", MMU[i].logical_start_addr, 
-                MMU[i].physical_start_addr, MMU[i].type, MMU[i].process_id
-            );
+int read_disk_sections(FATPtr* file, long len, uint16_t* page_words, ExecutableSection* sections) {
+    long run = len < PAGE_SIZE ? len : PAGE_SIZE;
+    f_read(file, run * sizeof(uint16_t), (char*)page_words);
+    if (has_executable_header(page_words, run))
+        return read_executable_header(page_words, run, len, sections);
+
+    SectionScanner scanner;
+    start_section_scan(&scanner, sections);
+    for (long offset = 0; offset < len; offset += run) {
+        run = len - offset < PAGE_SIZE ? len - offset : PAGE_SIZE;
+        if (offset > 0)
+            f_read(file, run * sizeof(uint16_t), (char*)page_words);
+
+        if (scan_section_words(&scanner, page_words, run) != 0)
+            return -1;
     }
+
+    return finish_section_scan(&scanner);
 }
 
 
 /**
- * @brief Takes the ID of a process and assigns a new page to it, if there is one, and returns a
- * pointer to the page, or NULL if one cannot be found. 
+ * @brief Creates a new Process from a program image on the harddrive. Each section is read from its
+ * clusters one page at a time and copied into the process's frames as it is read, so the image is never
+ * held in host memory as a whole. Sections are loaded as ordinary pages, even with large pages enabled.
  * 
- * @param process_id The ID of the process requesting a page
- * @param type The type of the new page
- * @param logical_addr The logical address of the first byte of the page
- * @return MMUEntry* if a page is found, NULL if not
+ * @param id The id of the new process
+ * @param path The path of the program image on the harddrive
+ * @param argc The number of arguments
+ * @param argv The arguments, copied into the process as for new_process_with_args
+ * @param machine The machine the process runs on
+ * @return New Process struct, or NULL if the image could not be found or has an invalid header
  */
-MMUEntry* request_new_page(Process* process, char type) {
-    for (int i = 0; i < NUM_PAGES; i++) {
-        if (MMU[i].allocated == 0) {
-            MMU[i].allocated = 1;
-            MMU[i].process_id = process->id;
-            MMU[i].type = type;
+Process* new_process_from_disk(uint8_t id, char* path, int argc, char** argv, Machine* machine) {
+    if (machine->num_active_processes >= 255)
+        return NULL;
 
-            MMU[i].logical_start_addr = process->max_addr;
-            process->max_addr += PAGE_SIZE;
+    seek_root_dir(machine->hd_img);
+    FATPtr* file = f_open(machine->fs, machine->hd_img, path);
+    if (file == NULL)
+        return NULL;
 
-            return &MMU[i];
-        }
+    // directories and volumes cannot be run
+    if ((file->file_context->DIR_Attr & 0b011000) != 0) {
+        f_close(file, file->id);
+        return NULL;
     }
 
-    return NULL;
+    long prog_len = file->file_context->DIR_FileSize / sizeof(uint16_t);
+    uint16_t page_words[PAGE_SIZE];
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+    int num_sections = read_disk_sections(file, prog_len, page_words, sections);
+    if (num_sections < 0) {
+        printf("Invalid executable header for process %d\n", id);
+        f_close(file, file->id);
+        return NULL;
+    }
+
+    Process* process = create_process(id, machine);
+
+    // stream each section into its own pages, every section getting at least one page
+    for (int i = 0; i < num_sections; i++) {
+        f_seek(file, sections[i].offset * sizeof(uint16_t), 0);
+
+        long offset = 0;
+        do {
+            long run = sections[i].len - offset < PAGE_SIZE ? sections[i].len - offset : PAGE_SIZE;
+            f_read(file, run * sizeof(uint16_t), (char*)page_words);
+            memset(page_words + run, 0, (PAGE_SIZE - run) * sizeof(uint16_t));
+
+            if (load_section_page(process, sections[i].type, page_words, run, machine) != 0)
+                break;
+
+            offset += PAGE_SIZE;
+        } while (offset < sections[i].len);
+    }
+
+    f_close(file, file->id);
+    finish_process_layout(process, argc, argv, machine);
+    return machine->processes[id];
 }
 
 
 /**
- * @brief Get the physical address of a byte from its logical address and process id
+ * @brief Frees every block in a heap allocation tree, including the root.
  * 
- * @param process_id The id of the process the page belongs to
- * @param logical_addr The logical address of the byte
- * @return The physical address of the byte
+ * @param root Pointer to the root block in the heap allocation tree
  */
-uint32_t get_physical_from_logical_addr(uint16_t process_id, uint32_t logical_addr) {
-    for (int i = 0; i < NUM_PAGES; i++) {
-        if (
-            MMU[i].process_id == process_id && 
-            MMU[i].logical_start_addr <= logical_addr && 
-            MMU[i].logical_start_addr + PAGE_SIZE > logical_addr
-        ) return MMU[i].physical_start_addr + (logical_addr & 0x0FFF);
-    }
-    
-    return -1;
+void free_heap_tree(HeapBlock* root) {
+    if (root == NULL)
+        return;
+
+    free_heap_tree(root->left_child);
+    free_heap_tree(root->right_child);
+    free(root);
 }
 
 
 /**
- * @brief Creates a new HeapBlock with the given parameters, a status of 1, and NULL left and right 
- * children.
+ * @brief Makes a copy of a heap allocation tree.
  * 
- * @param start_addr The address of the first byte of the block
- * @param size The size in bytes of the block
- * @return A pointer to the new block
+ * @param root Pointer to the root block in the heap allocation tree
+ * @return Pointer to the root of the copy
  */
-HeapBlock* new_heap_block(long start_addr, long size) {
-    HeapBlock* block = malloc(sizeof(HeapBlock));
-    block->start_addr = start_addr;
-    block->size = size;
-    block->status = 1;
-    block->right_child = NULL;
-    block->left_child = NULL;
+HeapBlock* copy_heap_tree(HeapBlock* root) {
+    if (root == NULL)
+        return NULL;
 
-    return block;
+    HeapBlock* copy = new_heap_block(root->start_addr, root->size);
+    copy->status = root->status;
+    copy->left_child = copy_heap_tree(root->left_child);
+    copy->right_child = copy_heap_tree(root->right_child);
+
+    return copy;
 }
 
 
 /**
- * @brief Creates a new Process type to be run on the processor.
+ * @brief Finds the lowest process id that is not in use.
  * 
- * @param id The id of the new process
- * @param binary_buffer The binary code the process runs
- * @return New Process struct
+ * @param machine The machine to find an id on
+ * @param first_id The lowest id that may be given out
+ * @return The id, or -1 if every id from first_id up is in use
  */
-Process* new_process(uint8_t id, uint16_t* binary_buffer, long prog_len, RAM* ram) {
-    if (num_active_processes >= 255)
-        return NULL;
+int get_free_process_id(Machine* machine, int first_id) {
+    for (int id = first_id; id < max_processes; id++) {
+        if (machine->processes[id] == NULL)
+            return id;
+    }
 
-    Process* process = malloc(sizeof(Process));
-    process->id = id;
-    process->started = 0;
-    process->max_addr = 0;
-    process->flags.carry = 0;
-    process->flags.negative = 0;
-    process->flags.zero = 0;
+    return -1;
+}
 
-    char section = CODE_PAGE;
-    uint32_t address = 0;
-    MMUEntry* page = request_new_page(process, section);
-    for (long i = 0; i < prog_len; i++) {
-        // check if we have moved into the data section
-        if (binary_buffer[i] == 0x6164 && binary_buffer[i+1] == 0x6174 && binary_buffer[i+2] == 0x003A) {
-            section = DATA_PAGE;
-            page = request_new_page(process, section);
-            address += PAGE_SIZE - (address % PAGE_SIZE);
-
-            // skip the data label bytes
-            i += 2;
-            continue;
-        }
 
-        if (binary_buffer[i] == 0x6574 && binary_buffer[i+1] == 0x7478 && binary_buffer[i+2] == 0x003A) {
-            section = TEXT_PAGE;
-            page = request_new_page(process, section);
-            address += PAGE_SIZE - (address % PAGE_SIZE);
+/**
+ * @brief Creates a child process which is a copy of the given process, with the same memory, heap tree 
+ * and flags, and the registers on its CPU saved as its own. No memory is copied: every frame of the parent is 
+ * mapped read-only in both processes, and is only copied when one of them first writes to it.
+ * 
+ * @param parent The process being forked, which must be running on its CPU
+ * @param machine The machine the process runs on
+ * @return The new process, or NULL if there are no free process ids
+ */
+Process* fork_process(Process* parent, Machine* machine) {
+    // id 0 is never given to a child, so that fork can return 0 to the child
+    int id = get_free_process_id(machine, 1);
+    if (id < 0)
+        return NULL;
 
-            // skip the text label bytes
-            i += 2;
+    Process* child = malloc(sizeof(Process));
+    child->id = id;
+    child->started = 1;
+    child->max_addr = parent->max_addr;
+    child->heap_start = parent->heap_start;
+    child->stack_bottom = parent->stack_bottom;
+    child->flags = get_alu_flags(&parent->cpu->last_op);
+    child->heap_root = copy_heap_tree(parent->heap_root);
+    child->page_table = new_page_table();
+    child->argc = parent->argc;
+    child->args_addr = parent->args_addr;
+    child->output = parent->output;
+    child->exit_status = 0;
+    child->instructions_retired = 0;
+    child->start_time = get_wall_time();
+    child->report = parent->report;
+    child->forked = 1;
+    child->cpu = NULL;
+    machine->processes[id] = child;
+
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        if (parent->page_table->directory[i] == NULL)
             continue;
+
+        for (int j = 0; j < PAGE_TABLE_SIZE; j++) {
+            uint32_t logical_addr = ((i << PAGE_TABLE_BITS) | j) << PAGE_OFFSET_BITS;
+            PageTableEntry entry = parent->page_table->directory[i][j];
+
+            // swap slots belong to a single page, so bring swapped pages back in to share them
+            if ((entry & PTE_SWAPPED) != 0) {
+                get_physical_from_logical_addr(parent->id, logical_addr, 0, machine);
+                entry = parent->page_table->directory[i][j];
+            }
+
+            if ((entry & PTE_PRESENT) == 0)
+                continue;
+
+            machine->MMU[entry & PTE_FRAME_MASK].ref_count++;
+            parent->page_table->directory[i][j] = entry | PTE_READ_ONLY;
+            map_page(child->page_table, logical_addr, entry & PTE_FRAME_MASK, PTE_READ_ONLY | (entry & PTE_LARGE));
         }
+    }
 
-        add_to_ram(ram, get_physical_from_logical_addr(id, address), binary_buffer[i]);
-        if (address >= process->max_addr)
-            page = request_new_page(process, section);
-        
-        address++;
+    // the parent's cached translations may still be writable
+    flush_TLB(parent->cpu->tlb);
+    parent->cpu->tlb->process_id = parent->id;
+
+    if (save_registers(child, parent->cpu->registers, machine) != 0) {
+        destroy_process(child, machine);
+        machine->processes[id] = NULL;
+        return NULL;
     }
 
-    // Assign the default number of pages for heap and stack
-    process->heap_root = NULL;
-    for (int i = 0; i < HEAP_SIZE / PAGE_SIZE; i++) {
-        MMUEntry* this = request_new_page(process, HEAP_PAGE);
-        if (process->heap_root == NULL)
-            process->heap_root = new_heap_block(this->logical_start_addr, HEAP_SIZE);
+    machine->num_active_processes++;
+    queue_process(child, machine);
+
+    return child;
+}
+
+
+/**
+ * @brief Finds another process mapping a frame at the same logical address as its owner, which is 
+ * where a process forked from the owner maps it.
+ * 
+ * @param frame The index of the frame in the MMU
+ * @param exclude The process to ignore
+ * @param machine The machine the frame is in
+ * @return The process, or NULL if there is none
+ */
+Process* find_frame_mapper(uint32_t frame, Process* exclude, Machine* machine) {
+    for (int i = 0; i < max_processes; i++) {
+        if (machine->processes[i] == NULL || machine->processes[i] == exclude)
+            continue;
+
+        PageTableEntry entry = lookup_page(machine->processes[i]->page_table, machine->MMU[frame].logical_start_addr);
+        if ((entry & PTE_PRESENT) != 0 && (entry & PTE_FRAME_MASK) == frame)
+            return machine->processes[i];
     }
 
-    for (int i = 0; i < HEAP_SIZE / PAGE_SIZE; i++) {
-        request_new_page(process, STACK_PAGE);
+    return NULL;
+}
+
+
+/**
+ * @brief Tears down a process which has finished: every page it owns is emptied in RAM and given back 
+ * to the MMU to be handed out again, and its heap tree and the process itself are freed.
+ * 
+ * @param process The process to destroy
+ * @param machine The machine the process runs on
+ */
+void destroy_process(Process* process, Machine* machine) {
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        PageTableEntry* entries = process->page_table->directory[i];
+        if (entries == NULL)
+            continue;
+
+        for (int j = 0; j < PAGE_TABLE_SIZE; j++) {
+            if ((entries[j] & PTE_SWAPPED) != 0)
+                release_swap_slot(machine->swap_device, entries[j] & PTE_FRAME_MASK);
+            if ((entries[j] & PTE_PRESENT) == 0)
+                continue;
+
+            // frames which other processes still map are left to them
+            MMUEntry* page = &machine->MMU[entries[j] & PTE_FRAME_MASK];
+            if (page->ref_count > 1) {
+                page->ref_count--;
+
+                // hand the frame to a process which still maps it, so that it can be evicted again
+                Process* mapper = page->process_id == process->id ? find_frame_mapper(entries[j] & PTE_FRAME_MASK, process, machine) : NULL;
+                if (mapper != NULL)
+                    page->process_id = mapper->id;
+
+                continue;
+            }
+
+            if (page->shared == 1)
+                unshare_frame(entries[j] & PTE_FRAME_MASK, machine);
+
+            page->ref_count = 0;
+            ram_release_block(machine->ram, page->physical_start_addr, PAGE_SIZE);
+            page->allocated = 0;
+            page->type = FREE_PAGE;
+            release_frame(machine->frame_allocator, entries[j] & PTE_FRAME_MASK);
+        }
     }
 
-    num_active_processes++;
-    processes[id] = process;
+    if (process->cpu != NULL && process->cpu->tlb->process_id == process->id)
+        flush_TLB(process->cpu->tlb);
 
-    return processes[id];
+    free_page_table(process->page_table);
+    free_heap_tree(process->heap_root);
+    free(process);
 }
 
 
-void print_processes() {
+void print_processes(Machine* machine) {
     printf("ID\tStarted\t\tMax Addr\tHeap Start\tHeap Phys Start\n");
     for (int i = 0; i < max_processes; i++) {
-        if (processes[i] == NULL)
+        if (machine->processes[i] == NULL)
             continue;
 
+        // only show where the heap starts in physical memory if it has been used yet
+        PageTableEntry heap_entry = lookup_page(machine->processes[i]->page_table, machine->processes[i]->heap_start);
+        uint32_t heap_phys_start = (heap_entry & PTE_PRESENT) == 0 ? -1 : (heap_entry & PTE_FRAME_MASK) << PAGE_OFFSET_BITS;
+
         printf("%d\t0x%08X\t0x%08X\t0x%08X\t0x%08X\n", 
-            processes[i]->id, processes[i]->started, processes[i]->max_addr, 
-            processes[i]->heap_root->start_addr, 
-            get_physical_from_logical_addr(processes[i]->id, processes[i]->heap_root->size)
+            machine->processes[i]->id, machine->processes[i]->started, machine->processes[i]->max_addr, 
+            machine->processes[i]->heap_start, heap_phys_start
         );
     }
 }
 
 
 /**
- * @brief Saves the current state of the registers to the start of the stack (first 19 words)
+ * @brief Saves the current state of a CPU's registers to the start of the stack (first 19 words). The 16-bit 
+ * registers $g0 to $ua go from the top of the stack downwards, followed by $sp, $fp, $ra, and $pc, which 
+ * take 2 words each with the upper 16 bits first.
  * 
  * @attention Should be taken into account by future programmers and compilers
  * 
  * @param process The process being saved
- * @param registers The registers file
- * @param ram The system RAM
+ * @param registers The registers of the CPU the process ran on
+ * @param machine The machine the process runs on
+ * @return 0 if the registers were saved, -1 if there is no frame for the top of the stack
  */
-void save_registers(Process* process, Register* registers, RAM* ram) {
+int save_registers(Process* process, uint32_t* registers, Machine* machine) {
+    if (get_physical_from_logical_addr(process->id, process->max_addr - SAVED_REGISTERS_LEN, 1, machine) == NO_PHYSICAL_ADDR)
+        return -1;
+
+    uint16_t saved[SAVED_REGISTERS_LEN];
     for (int i = 1; i < 12; i++) {
-        add_to_ram(ram, get_physical_from_logical_addr(process->id, process->max_addr - i), 
-            GET_REG_VAL(i)
-        );
+        saved[SAVED_REGISTERS_LEN - i] = read_register(registers, i);
     }
 
-    int reg = 12;
-    for (int i = 12; i < 19; i += 2) {
-        add_to_ram(ram, get_physical_from_logical_addr(process->id, process->max_addr - i), 
-            (GET_REG_VAL(reg) & 0xFFFF0000) >> 16);
-        add_to_ram(ram, get_physical_from_logical_addr(process->id, process->max_addr - i + 1), 
-            GET_REG_VAL(reg) & 0x0000FFFF);
-
-        reg++;
+    for (int reg = 12; reg < 16; reg++) {
+        saved[30 - 2 * reg] = (read_register(registers, reg) & 0xFFFF0000) >> 16;
+        saved[31 - 2 * reg] = read_register(registers, reg) & 0x0000FFFF;
     }
+
+    write_process_memory(process, process->max_addr - SAVED_REGISTERS_LEN, saved, SAVED_REGISTERS_LEN, machine);
+    return 0;
 }
 
 
@@ -244,25 +1501,18 @@ void save_registers(Process* process, Register* registers, RAM* ram) {
  * 
  * @param process The process being executed
  * @param registers The system registers
- * @param ram The system RAM
+ * @param machine The machine the process runs on
  */
-void load_registers(Process* process, Register* registers, RAM* ram) {
-    Register new_val;
+void load_registers(Process* process, uint32_t* registers, Machine* machine) {
+    uint16_t saved[SAVED_REGISTERS_LEN];
+    read_process_memory(process, process->max_addr - SAVED_REGISTERS_LEN, saved, SAVED_REGISTERS_LEN, machine);
+
     for (int i = 1; i < 12; i++) {
-        new_val.word_16 = get_from_ram(ram,
-            get_physical_from_logical_addr(process->id, process->max_addr - i));
-        update_register(i, new_val, registers);
+        write_register(registers, i, saved[SAVED_REGISTERS_LEN - i]);
     }
 
-    int reg = 12;
-    for (int i = 12; i < 19; i += 2) {
-        new_val.word_32 = get_from_ram(ram,
-            get_physical_from_logical_addr(process->id, process->max_addr - i)) << 16;
-        new_val.word_32 |= get_from_ram(ram,
-            get_physical_from_logical_addr(process->id, process->max_addr - i + 1));
-        update_register(reg, new_val, registers);
-
-        reg++;
+    for (int reg = 12; reg < 16; reg++) {
+        write_register_32(registers, reg, ((uint32_t)saved[30 - 2 * reg] << 16) | saved[31 - 2 * reg]);
     }
 }
 
@@ -272,94 +1522,284 @@ void load_registers(Process* process, Register* registers, RAM* ram) {
  * 
  * @param registers The system registers
  */
-void reset_registers(Register* registers) {
-    for (int i = 0; i < 16; i++) {
-        Register new_reg;
-        new_reg.word_32 = 0;
-        update_register(i, new_reg, registers);
+void reset_registers(uint32_t* registers) {
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        write_register(registers, i, 0);
+    }
+}
+
+
+/**
+ * @brief Runs a process for a burst by fetching each decoded instruction and calling its handler.
+ * 
+ * @param machine The machine the process runs on
+ * @param process The process being executed, whose CPU holds its registers
+ * @param burst_len The number of instructions to execute
+ * @param instrs_executed Set to the number of instructions executed
+ * @return How the process halted, HALT_EXIT or HALT_FAULT, or 0 if the burst ended
+ */
+int run_handler_burst(Machine* machine, Process* process, uint32_t burst_len, uint32_t* instrs_executed) {
+    CPU* cpu = process->cpu;
+    uint32_t* registers = cpu->registers;
+    DecodedInstr* instr;
+    FetchWindow window = { TLB_INVALID_PAGE, 0, 0 };
+    while (1) {
+        instr = fetch_instruction(process, cpu, read_register(registers, 15), &window, machine);
+        if (instr->halts)
+            return instr->halts;
+
+        instr->handler(instr, machine, registers, process);
+        write_register_32(registers, 15, read_register(registers, 15) + 1);
+
+        *instrs_executed += instr->length;
+        if (*instrs_executed > burst_len && cpu->periodic_interrupts_enabled == 1)
+            return 0;
+    }
+}
+
+
+/**
+ * @brief Makes a process the one running on a CPU. A process which last ran on another CPU takes none of 
+ * its translations with it: they are dropped from the TLB of the CPU it left, and the decoded instructions 
+ * of this CPU are all dropped, as it has not seen the writes the process made elsewhere.
+ * 
+ * @attention Must be called under the kernel lock
+ * 
+ * @param cpu The CPU to run the process on
+ * @param process The process being executed
+ */
+void dispatch_process(CPU* cpu, Process* process) {
+    if (process->cpu != cpu) {
+        if (process->cpu != NULL && process->cpu->tlb->process_id == process->id)
+            flush_TLB(process->cpu->tlb);
+
+        flush_decode_cache(cpu);
+        process->cpu = cpu;
     }
+
+    // the TLB still holds the translations of the last process run, unless it was this one
+    if (cpu->tlb->process_id != process->id) {
+        flush_TLB(cpu->tlb);
+        cpu->tlb->process_id = process->id;
+    }
+
+    // read by other CPUs looking for work to steal without the kernel lock
+    __atomic_store_n(&cpu->process, process, __ATOMIC_RELAXED);
 }
 
 
 /**
- * @brief Takes a process, RAM, and registers, then executes the process for a number of instructions
+ * @brief Takes a process and the CPU to run it on, then executes the process for a number of instructions
  * equal to the burst length, round-robin style.
  * 
  * @note Does not move on to next process if atom flag is set in the control unit, waits until it is
  * disabled.
  * 
- * @param ram The system RAM
- * @param register The CPU registers
+ * @param machine The machine the process runs on
+ * @param cpu The CPU to run the process on
  * @param process The process being executed
  * @param burst_len The number of instructions to execute
- * @param hd_img File pointer to the harddrive image
  * @return The value in the program counter at the end of the burst, or -1 if the process completes
  */
-uint32_t execute_process_burst(RAM* ram, Register* registers, Process* process, FILE* hd_img, uint32_t burst_len) {
+uint32_t execute_process_burst(Machine* machine, CPU* cpu, Process* process, uint32_t burst_len) {
+    uint32_t* registers = cpu->registers;
+    lock_kernel(machine);
+    dispatch_process(cpu, process);
     if (process->started != 0)
-        load_registers(process, registers, ram);
+        load_registers(process, registers, machine);
     else {
         reset_registers(registers);
         process->started = 1;
+
+        write_register(registers, 9, process->argc);
+        write_register(registers, 11, process->args_addr >> 16);
+        write_register(registers, 10, process->args_addr & 0xFFFF);
     }
 
-    alu_flags.carry = process->flags.carry;
-    alu_flags.negative = process->flags.negative;
-    alu_flags.zero = process->flags.zero;
+    unlock_kernel(machine);
+    set_alu_flags(&cpu->last_op, process->flags);
 
-    uint16_t command;
-    Register new_count;
-    uint32_t address;
     uint32_t instrs_executed = 0;
-    while (1) {
-        address = get_physical_from_logical_addr(process->id, get_register(15, registers).word_32);
-        command = get_from_ram(ram, address);
-        if (command == 0x0000 || command == 0xFFFF)
-            return -1;
+    int halted;
+    if (machine->jit_enabled)
+        halted = run_jit_burst(machine, process, burst_len, &instrs_executed);
+    else if (machine->threaded_interpreter_enabled)
+        halted = run_threaded_burst(machine, process, burst_len, &instrs_executed);
+    else
+        halted = run_handler_burst(machine, process, burst_len, &instrs_executed);
+
+    process->instructions_retired += instrs_executed;
+    cpu->fusion_stats->instrs += instrs_executed;
+    if (halted == HALT_FAULT) {
+        printf("Process %d ended by an invalid instruction or syscall at 0x%08X\n", process->id, 
+            read_register(registers, 15));
+        process->exit_status = -1;
+    }
+
+    if (halted)
+        return -1;
 
-        execute_command(command, ram, registers, process, hd_img);
-        new_count.word_32 = get_register(15, registers).word_32 + 1;
-        update_register(15, new_count, registers);
+    process->flags = get_alu_flags(&cpu->last_op);
+    lock_kernel(machine);
+    int saved = save_registers(process, registers, machine);
+    __atomic_store_n(&cpu->process, NULL, __ATOMIC_RELAXED);
+    unlock_kernel(machine);
 
-        instrs_executed++;
-        if (instrs_executed > burst_len && get_periodic_interrupts_enabled() == 1)
-            break;
+    if (saved != 0) {
+        printf("No free frame to save the registers of process %d\n", process->id);
+        process->exit_status = -1;
+        return -1;
+    }
+
+    return read_register(registers, 15);
+}
+
+
+/**
+ * @brief Ends a process which has completed on a CPU: its registers are printed, its report is filled 
+ * in, and it is destroyed. A process which halted in an atomic section leaves it. A forked process 
+ * shares the report of the process it was forked from, and only adds its instructions to it.
+ * 
+ * @param machine The machine the process runs on
+ * @param cpu The CPU the process ran on
+ * @param process The process which has completed
+ */
+void end_process(Machine* machine, CPU* cpu, Process* process) {
+    lock_kernel(machine);
+    fprint_registers(get_process_output(process), cpu->registers);
+    fprintf(get_process_output(process), "\n\n");
+
+    if (process->report != NULL) {
+        process->report->instructions_retired += process->instructions_retired;
+        if (process->forked == 0) {
+            process->report->exit_status = process->exit_status;
+            process->report->wall_time = get_wall_time() - process->start_time;
+        }
     }
 
-    process->flags.carry = alu_flags.carry;
-    process->flags.negative = alu_flags.negative;
-    process->flags.zero = alu_flags.zero;
-    save_registers(process, registers, ram);
+    machine->processes[process->id] = NULL;
+    destroy_process(process, machine);
+    machine->num_active_processes--;
+    __atomic_store_n(&cpu->process, NULL, __ATOMIC_RELAXED);
 
-    return get_register(15, registers).word_32;
+    if (cpu->periodic_interrupts_enabled == 0)
+        toggle_atomic_section(machine, cpu);
+
+    unlock_kernel(machine);
 }
 
 
 /**
- * @brief Runs all the currently active processes using round-robin scheduling.
+ * @brief Puts a new process on the run queue of a CPU, spreading processes over the CPUs by their id. 
+ * With only one CPU there are no run queues, as processes are run in the order of their ids.
  * 
- * @param ram The system RAM
- * @param registers The system registers
- * @param hd_img File pointer to the harddrive image
+ * @param process The new process
+ * @param machine The machine the process runs on
+ */
+void queue_process(Process* process, Machine* machine) {
+    if (machine->num_cpus > 1)
+        push_run_queue(machine->cpus[process->id % machine->num_cpus].run_queue, process);
+}
+
+
+/*
+Takes the next process for a CPU to run from its own run queue, or steals one from the back of the queue 
+of another CPU if its own is empty. Only CPUs which are busy running a process are stolen from, so that a 
+CPU between two bursts of its only process does not lose it.
+*/
+Process* next_process(Machine* machine, CPU* cpu) {
+    Process* process = pop_run_queue(cpu->run_queue);
+    for (uint8_t i = 1; i < machine->num_cpus && process == NULL; i++) {
+        CPU* victim = &machine->cpus[(cpu->id + i) % machine->num_cpus];
+        if (__atomic_load_n(&victim->process, __ATOMIC_RELAXED) != NULL)
+            process = steal_run_queue(victim->run_queue);
+    }
+
+    return process;
+}
+
+
+/*
+The arguments of the host thread running a CPU.
+*/
+typedef struct CPUThread {
+    Machine* machine;
+    CPU* cpu;
+} CPUThread;
+
+
+/*
+Runs the processes of one CPU until there are no active processes left on the machine, stealing work 
+from the other CPUs when it runs out of its own.
+*/
+void* run_cpu(void* arg) {
+    CPUThread* thread = arg;
+    Machine* machine = thread->machine;
+    CPU* cpu = thread->cpu;
+    struct timespec idle = { 0, 100000 };
+
+    while (1) {
+        Process* process = next_process(machine, cpu);
+        if (process == NULL) {
+            lock_kernel(machine);
+            uint8_t active = machine->num_active_processes;
+            unlock_kernel(machine);
+
+            if (active == 0)
+                return NULL;
+
+            // the other CPUs are running every process that is left
+            nanosleep(&idle, NULL);
+            continue;
+        }
+
+        if (execute_process_burst(machine, cpu, process, BURST_LEN) == -1)
+            end_process(machine, cpu, process);
+        else
+            push_run_queue(cpu->run_queue, process);
+    }
+}
+
+
+/**
+ * @brief Runs all the currently active processes. With one CPU they are run round-robin in the order of 
+ * their ids. With more, each CPU is run by its own host thread, the first by the calling thread, and runs
+ * the processes in its run queue round-robin.
+ * 
+ * @param machine The machine to run the processes of
  */
-void execute_scheduled_processes(RAM* ram, Register* registers, FILE* hd_img) {
-    while (num_active_processes > 0) {
+void execute_scheduled_processes(Machine* machine) {
+    if (machine->num_cpus > 1) {
+        pthread_t threads[MAX_CPUS];
+        CPUThread args[MAX_CPUS];
+        for (uint8_t i = 0; i < machine->num_cpus; i++) {
+            args[i].machine = machine;
+            args[i].cpu = &machine->cpus[i];
+        }
+
+        for (uint8_t i = 1; i < machine->num_cpus; i++) {
+            if (pthread_create(&threads[i], NULL, run_cpu, &args[i]) != 0) {
+                printf("ERROR: COULD NOT START CPU %d!\n", i);
+                exit(-1);
+            }
+        }
+
+        run_cpu(&args[0]);
+        for (uint8_t i = 1; i < machine->num_cpus; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        return;
+    }
+
+    CPU* cpu = &machine->cpus[0];
+    while (machine->num_active_processes > 0) {
         for (int i = 0; i < max_processes; i++) {
-            if (processes[i] == NULL)
+            if (machine->processes[i] == NULL)
                 continue;
 
-            uint32_t result = execute_process_burst(ram, registers, processes[i], hd_img, BURST_LEN);
-            if (result == -1) {
-                print_registers(registers);
-                printf("\n\n");
-                
-                free(processes[i]);
-                processes[i] = NULL;
-                num_active_processes--;
-
-                if (get_periodic_interrupts_enabled() == 0)
-                    toggle_periodic_interrupts();
-            }
+            if (execute_process_burst(machine, cpu, machine->processes[i], BURST_LEN) == -1)
+                end_process(machine, cpu, machine->processes[i]);
         }
     }
 }
@@ -372,24 +1812,26 @@ void execute_scheduled_processes(RAM* ram, Register* registers, FILE* hd_img) {
  * 
  * @param root Pointer to the root block in the heap allocation tree
  * @param size The size of the memory to allocate
+ * @param heap_end The first address past the heap; the tree may extend past it after the heap shrinks
+ * or when it has grown by less than a power of two, and no allocation may go beyond it
  * @return Returns the address of the allocated block if one is found, and -1 if one could not be found. 
  */
-uint32_t allocate_memory(HeapBlock* root, uint32_t size) {
+uint32_t allocate_memory(HeapBlock* root, uint32_t size, uint32_t heap_end) {
     if (size == 0)
         return -1;
         
     // if memory is taken, do nothing
-    if (root == NULL || size > root->size || root->status == 0)
+    if (root == NULL || size > root->size || root->status == 0 || root->start_addr + size > heap_end)
         return -1;
     
     // if root is subdivided, can continue to go down the tree but cannot allocate
     else if (root->status == 2) {
-        long alloc_status = allocate_memory(root->left_child, size);
-        if (alloc_status >= 0)
+        uint32_t alloc_status = allocate_memory(root->left_child, size, heap_end);
+        if (alloc_status != (uint32_t)-1)
             return alloc_status;
         
-        alloc_status = allocate_memory(root->right_child, size);
-        if (alloc_status >= 0)
+        alloc_status = allocate_memory(root->right_child, size, heap_end);
+        if (alloc_status != (uint32_t)-1)
             return alloc_status;
     }
     
@@ -401,12 +1843,12 @@ uint32_t allocate_memory(HeapBlock* root, uint32_t size) {
         if (root->left_child == NULL || root->right_child == NULL)
             printf("Could not find memory for heap tree child node!\n");
 
-        long child_alloc = allocate_memory(root->left_child, size);
-        if (child_alloc >= 0)
+        uint32_t child_alloc = allocate_memory(root->left_child, size, heap_end);
+        if (child_alloc != (uint32_t)-1)
             return child_alloc;
 
-        child_alloc = allocate_memory(root->right_child, size);
-        if (child_alloc >= 0)
+        child_alloc = allocate_memory(root->right_child, size, heap_end);
+        if (child_alloc != (uint32_t)-1)
             return child_alloc;
         
         return -1;
@@ -492,44 +1934,89 @@ void print_malloc_tree(HeapBlock root, int depth) {
 }
 
 
+/**
+ * @brief Finds the end of the highest block in use in a heap allocation tree.
+ * 
+ * @param root Pointer to the root block in the heap allocation tree
+ * @return The first address past the highest allocated block, or the start of the tree if none are
+ */
+uint32_t get_heap_high_water(HeapBlock* root) {
+    if (root->status == 0)
+        return root->start_addr + root->size;
+    if (root->status == 1)
+        return root->start_addr;
+
+    uint32_t high = root->start_addr;
+    if (root->left_child != NULL)
+        high = get_heap_high_water(root->left_child);
+    if (root->right_child != NULL && get_heap_high_water(root->right_child) > high)
+        high = get_heap_high_water(root->right_child);
+
+    return high;
+}
+
+
+/**
+ * @brief Doubles a heap allocation tree until it covers every address up to heap_end, so that heap 
+ * pages added by sbrk can be allocated. A free root is just resized, otherwise the old tree becomes 
+ * the left child of a new root whose right child is the new free space.
+ * 
+ * @param root Pointer to the root block in the heap allocation tree
+ * @param heap_end The first address past the heap
+ * @return The new root of the tree
+ */
+HeapBlock* grow_heap_tree(HeapBlock* root, uint32_t heap_end) {
+    while (root->start_addr + root->size < heap_end) {
+        if (root->status == 1) {
+            root->size *= 2;
+            continue;
+        }
+
+        HeapBlock* new_root = new_heap_block(root->start_addr, root->size * 2);
+        new_root->status = 2;
+        new_root->left_child = root;
+        new_root->right_child = new_heap_block(root->start_addr + root->size, root->size);
+        root = new_root;
+    }
+
+    return root;
+}
+
+
 /**
  * @brief Adjusts the breakpoint between the process stack and heap by the offset. Note that increasing 
  * the heap shrinks the stack, and vice versa.
  * 
  * @param offset The number of pages to add to the heap; negative value shrinks the heap.
  * @param process The process to adjust
+ * @param machine The machine the process runs on
  */
-void change_heap_size(int32_t offset, Process* process) {
-    if (offset == 0)
+void change_heap_size(int32_t offset, Process* process, Machine* machine) {
+    uint32_t new_bottom = process->stack_bottom + offset * PAGE_SIZE;
+    if (offset == 0 || new_bottom <= process->heap_start || new_bottom >= process->max_addr) {
+        if (offset != 0)
+            printf("Failed to adjust stack size\n");
         return;
-    
-    MMUEntry* lowest_stack = NULL;
-    MMUEntry* highest_heap = NULL;
-    for (int i = 0; i < NUM_PAGES; i++) {
-        if (MMU[i].process_id == process->id) {
-            if (lowest_stack == NULL && MMU[i].type == STACK_PAGE)
-                lowest_stack = &MMU[i];
-            else if (highest_heap == NULL && MMU[i].type == HEAP_PAGE)
-                highest_heap = &MMU[i];
-            else if (MMU[i].type == STACK_PAGE && MMU[i].logical_start_addr < lowest_stack->logical_start_addr)
-                lowest_stack = &MMU[i];
-            else if (MMU[i].type == HEAP_PAGE && MMU[i].logical_start_addr > highest_heap->logical_start_addr)
-                highest_heap = &MMU[i];
-        }
     }
 
-    if (lowest_stack == NULL && highest_heap == NULL) {
+    // the heap cannot shrink below memory which is still allocated in it
+    if (offset < 0 && new_bottom < get_heap_high_water(process->heap_root)) {
         printf("Failed to adjust stack size\n");
-        exit(50);
+        return;
     }
 
-    if (offset > 0) {
-        lowest_stack->type = HEAP_PAGE;
-        offset--;
-    } else {
-        highest_heap->type = STACK_PAGE;
-        offset++;
+    // retype the pages which have already been backed between the old and new boundary
+    uint32_t low = offset > 0 ? process->stack_bottom : new_bottom;
+    uint32_t high = offset > 0 ? new_bottom : process->stack_bottom;
+    for (uint32_t addr = low; addr < high; addr += PAGE_SIZE) {
+        PageTableEntry entry = lookup_page(process->page_table, addr);
+        if ((entry & PTE_PRESENT) == 0)
+            continue;
+
+        machine->MMU[entry & PTE_FRAME_MASK].type = offset > 0 ? HEAP_PAGE : STACK_PAGE;
+        invalidate_process_page(process, addr);
     }
-    
-    change_heap_size(offset, process);
+
+    process->stack_bottom = new_bottom;
+    process->heap_root = grow_heap_tree(process->heap_root, new_bottom);
 }
@@ -2,7 +2,9 @@
 #define MICROKERNEL
 
 #define PAGE_SIZE 4096
-#define NUM_PAGES 0x1000 // 256Mb total data in 65536 pages
+#define NUM_PAGES 0x1000 // default number of physical frames, 16M words
+#define MAX_PHYSICAL_FRAMES 0x100000 // the whole 32-bit physical address space, 4G words
+#define NO_PHYSICAL_ADDR 0xFFFFFFFF // given back for a page the process does not have, never a real address
 #define HEAP_SIZE 0x100000 // 1Mb heap per process
 #define BURST_LEN 1024
 #define CODE_PAGE 'c' 
@@ -11,12 +13,21 @@
 #define HEAP_PAGE 'h' 
 #define FREE_PAGE 'f' 
 #define STACK_PAGE 's'
+#define SAVED_REGISTERS_LEN 19
+#define SHARED_PAGE_BUCKETS 1024
+#define LARGE_PAGE_SIZE (PAGE_SIZE * LARGE_PAGE_FRAMES) // 64K words
 
 #include <stdint.h>
 #include <stdio.h>
 #include "../internal_memory.h"
 #include "../registers.h"
 #include "../ALU.h"
+#include "../machine.h"
+#include "page_table.h"
+#include "tlb.h"
+#include "frame_allocator.h"
+#include "swap.h"
+#include "executable.h"
 
 
 /**
@@ -33,17 +44,34 @@ typedef struct HeapBlock {
 
 /**
  * @brief Used to keep track of all the pages currently created and how they map from logical to 
- * physical memory, and to track available IDs and locations in physical memory.
+ * physical memory, and to track available IDs and locations in physical memory. There is one entry per 
+ * physical frame; translation goes through each process's own page table instead.
  */
 typedef struct MMUEntry {
     uint8_t process_id;
     char type;
     char allocated;
+    char referenced; // set whenever the page is translated, cleared by the clock as it passes
+    char shared; // 1 if the page is in the shared page table, so other processes may map it
+    char large; // 1 if the frame was allocated as part of a large page
+    uint16_t ref_count; // the number of page tables the frame is mapped in
+    uint32_t content_hash; // hash of the page's contents when it was loaded, if it is shared
+    int32_t next_shared; // the next frame in the same shared page bucket, or -1
     uint32_t logical_start_addr;
     uint32_t physical_start_addr;
 } MMUEntry;
 
 
+/**
+ * @brief How a process ended, filled in by the kernel when it exits for whoever launched it.
+ */
+typedef struct ProcessReport {
+    int exit_status; // 0 if the process halted, -1 if the kernel had to end it
+    unsigned long instructions_retired; // including those of every process forked from it
+    double wall_time; // seconds from the process being created to it ending
+} ProcessReport;
+
+
 /**
  * @brief Represents a single process being run on the processor
  */
@@ -51,25 +79,57 @@ typedef struct Process {
     uint8_t id;
     uint8_t started; // 0 if process not ever run, otherwise 1
     uint32_t max_addr; // the highest valid address
-    HeapBlock* heap_root;
+    uint32_t heap_start; // the first address of the heap, which is reserved up to stack_bottom
+    uint32_t stack_bottom; // the lowest address of the stack, which is reserved up to max_addr
+    HeapBlock* heap_root; // buddy tree over the heap, rounded up to a power of two past stack_bottom
+    PageTable* page_table; // maps the process's logical pages to frames in the MMU
     struct ALU_flags flags;
+    uint16_t argc; // the number of arguments, put in $g8 when the process starts
+    uint32_t args_addr; // the address of the first argument string, put in $ua, $g9 when it starts
+    FILE* output; // where the process prints to, stdout if NULL
+    int exit_status;
+    unsigned long instructions_retired;
+    double start_time;
+    ProcessReport* report; // filled in when the process ends, if not NULL
+    uint8_t forked; // 1 if forked from another process, whose report this only adds its instructions to
+    CPU* cpu; // the CPU the process is running on or last ran on, NULL if it has not run yet
 } Process;
 
 
-void init_processes();
-void init_MMU();
-
-Process* new_process(uint8_t id, uint16_t* binary_buffer, long prog_len, RAM* ram);
-void execute_scheduled_processes(RAM* ram, Register* registers, FILE* hd_img);
-
-MMUEntry* request_new_page(Process* process, char type);
-uint32_t allocate_memory(HeapBlock* root, uint32_t size);
+void init_processes(Machine* machine);
+void init_MMU(Machine* machine, uint32_t num_frames);
+void init_TLB(Machine* machine, uint32_t size);
+void print_TLB(Machine* machine);
+int init_swap(Machine* machine, const char* path);
+void free_kernel(Machine* machine);
+void enable_large_pages(Machine* machine);
+int enable_threaded_interpreter(Machine* machine);
+int enable_jit(Machine* machine);
+void print_swap(Machine* machine);
+Process* new_process(uint8_t id, const uint16_t* binary_buffer, long prog_len, Machine* machine);
+Process* new_process_with_args(uint8_t id, const uint16_t* binary_buffer, long prog_len, int argc, char** argv, Machine* machine);
+Process* new_process_from_disk(uint8_t id, char* path, int argc, char** argv, Machine* machine);
+FILE* get_process_output(Process* process);
+double get_wall_time();
+void execute_scheduled_processes(Machine* machine);
+uint32_t execute_process_burst(Machine* machine, CPU* cpu, Process* process, uint32_t burst_len);
+int get_free_process_id(Machine* machine, int first_id);
+void queue_process(Process* process, Machine* machine);
+Process* fork_process(Process* parent, Machine* machine);
+int save_registers(Process* process, uint32_t* registers, Machine* machine);
+void destroy_process(Process* process, Machine* machine);
+MMUEntry* request_new_page(Process* process, char type, Machine* machine);
+MMUEntry* request_new_pages(Process* process, char type, uint32_t count, Machine* machine);
+uint32_t allocate_memory(HeapBlock* root, uint32_t size, uint32_t heap_end);
 void free_memory(HeapBlock* root, long address);
-void change_heap_size(int32_t offset, Process* process);
-
+void change_heap_size(int32_t offset, Process* process, Machine* machine);
 void print_malloc_tree(HeapBlock root, int depth);
-void print_MMU(int num_pages);
-void print_processes();
-uint32_t get_physical_from_logical_addr(uint16_t process_id, uint32_t logical_addr);
+void print_MMU(Machine* machine, int num_pages);
+void print_processes(Machine* machine);
+uint32_t get_physical_from_logical_addr(uint16_t process_id, uint32_t logical_addr, short write, Machine* machine);
+uint32_t translate_address(Process* process, uint32_t logical_addr, Machine* machine);
+uint32_t translate_write_address(Process* process, uint32_t logical_addr, Machine* machine);
+void read_process_memory(Process* process, uint32_t logical_addr, uint16_t* buffer, uint32_t len, Machine* machine);
+void write_process_memory(Process* process, uint32_t logical_addr, const uint16_t* buffer, uint32_t len, Machine* machine);
 
 #endif
@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "page_table.h"
+
+#define FALSE 0
+#define TRUE  1
+
+
+/**
+ * @brief Creates a new page table with no pages mapped.
+ * 
+ * @return Pointer to the new page table
+ */
+PageTable* new_page_table() {
+    PageTable* table = calloc(1, sizeof(PageTable));
+    if (table == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR PAGE TABLE!\n");
+        exit(-1);
+    }
+
+    return table;
+}
+
+
+/**
+ * @brief Frees the page table and all the tables of entries in it. Does not free the frames the entries 
+ * point to.
+ * 
+ * @param table The page table to free
+ */
+void free_page_table(PageTable* table) {
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        free(table->directory[i]);
+    }
+
+    free(table);
+}
+
+
+/**
+ * @brief Gets a pointer to the entry for the page holding the logical address.
+ * 
+ * @param table The page table
+ * @param logical_addr Any logical address in the page
+ * @param create TRUE to allocate the table of entries holding the entry if it does not exist yet
+ * @return Pointer to the entry, or NULL if its table does not exist and create is FALSE
+ */
+PageTableEntry* get_page_table_entry(PageTable* table, uint32_t logical_addr, short create) {
+    PageTableEntry** entries = &table->directory[logical_addr >> (PAGE_OFFSET_BITS + PAGE_TABLE_BITS)];
+    if (*entries == NULL) {
+        if (create == FALSE)
+            return NULL;
+
+        *entries = calloc(PAGE_TABLE_SIZE, sizeof(PageTableEntry));
+        if (*entries == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR PAGE TABLE!\n");
+            exit(-1);
+        }
+    }
+
+    return &(*entries)[(logical_addr >> PAGE_OFFSET_BITS) & (PAGE_TABLE_SIZE - 1)];
+}
+
+
+/**
+ * @brief Maps the page holding the logical address to the given physical frame.
+ * 
+ * @param table The page table
+ * @param logical_addr Any logical address in the page
+ * @param frame The index of the physical frame
+ * @param flags Flags to set on the entry alongside PTE_PRESENT
+ */
+void map_page(PageTable* table, uint32_t logical_addr, uint32_t frame, uint32_t flags) {
+    *get_page_table_entry(table, logical_addr, TRUE) = PTE_PRESENT | flags | (frame & PTE_FRAME_MASK);
+}
+
+
+/**
+ * @brief Removes the mapping for the page holding the logical address, if there is one.
+ * 
+ * @param table The page table
+ * @param logical_addr Any logical address in the page
+ */
+void unmap_page(PageTable* table, uint32_t logical_addr) {
+    PageTableEntry* entry = get_page_table_entry(table, logical_addr, FALSE);
+    if (entry != NULL)
+        *entry = 0;
+}
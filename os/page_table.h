@@ -0,0 +1,59 @@
+#ifndef PAGETABLE
+#define PAGETABLE
+
+#include <stdint.h>
+
+#define PAGE_OFFSET_BITS 12
+#define PAGE_TABLE_BITS 10
+#define PAGE_TABLE_SIZE (1 << PAGE_TABLE_BITS)
+#define PAGE_DIRECTORY_SIZE (1 << (32 - PAGE_OFFSET_BITS - PAGE_TABLE_BITS))
+#define LARGE_PAGE_BITS 16
+#define LARGE_PAGE_FRAMES (1 << (LARGE_PAGE_BITS - PAGE_OFFSET_BITS))
+
+#define PTE_PRESENT 0x80000000
+#define PTE_SWAPPED 0x40000000 // not present, the low bits hold the swap slot the page is in
+#define PTE_READ_ONLY 0x20000000 // the frame may be shared, so writing to it makes a copy first
+#define PTE_LARGE 0x10000000 // one of the entries of a large page, backed by contiguous aligned frames
+#define PTE_FRAME_MASK 0x000FFFFF
+
+
+/*
+An entry in a page table, holding the index of the physical frame a logical page is mapped to in its 
+low bits and flags in its high bits. An entry of 0 is an unmapped page, and an entry with PTE_SWAPPED 
+set holds the swap slot of a page which has been evicted instead of a frame.
+
+A large page is LARGE_PAGE_FRAMES ordinary entries in a row, each mapping its own frame of an aligned 
+run of frames and marked PTE_LARGE, so it can be split back into ordinary pages just by clearing the flag.
+*/
+typedef uint32_t PageTableEntry;
+
+
+/**
+ * @brief A radix tree mapping the logical pages of a single process to physical frames. The top bits of
+ * a logical address index the directory, and the next bits index a table of entries, which is only
+ * allocated once a page in its range is mapped.
+ */
+typedef struct PageTable {
+    PageTableEntry* directory[PAGE_DIRECTORY_SIZE];
+} PageTable;
+
+
+PageTable* new_page_table();
+void free_page_table(PageTable* table);
+void map_page(PageTable* table, uint32_t logical_addr, uint32_t frame, uint32_t flags);
+void unmap_page(PageTable* table, uint32_t logical_addr);
+PageTableEntry* get_page_table_entry(PageTable* table, uint32_t logical_addr, short create);
+
+
+/*
+Looks up the entry for the page holding the logical address, returning 0 if the page is unmapped.
+*/
+static inline PageTableEntry lookup_page(PageTable* table, uint32_t logical_addr) {
+    PageTableEntry* entries = table->directory[logical_addr >> (PAGE_OFFSET_BITS + PAGE_TABLE_BITS)];
+    if (entries == NULL)
+        return 0;
+
+    return entries[(logical_addr >> PAGE_OFFSET_BITS) & (PAGE_TABLE_SIZE - 1)];
+}
+
+#endif
@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "run_queue.h"
+
+
+/**
+ * @brief Creates an empty run queue.
+ *
+ * @param capacity The most processes the queue can hold, which should be the most that can be active
+ * @return Pointer to the run queue
+ */
+RunQueue* new_run_queue(uint32_t capacity) {
+    RunQueue* queue = malloc(sizeof(RunQueue));
+    Process** processes = malloc(sizeof(Process*) * capacity);
+    if (queue == NULL || processes == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RUN QUEUE!\n");
+        exit(-1);
+    }
+
+    queue->processes = processes;
+    queue->capacity = capacity;
+    queue->head = 0;
+    queue->len = 0;
+    pthread_mutex_init(&queue->lock, NULL);
+
+    return queue;
+}
+
+
+/*
+Frees a run queue, but not the processes still in it.
+*/
+void free_run_queue(RunQueue* queue) {
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->processes);
+    free(queue);
+}
+
+
+/*
+Puts a process at the end of a run queue.
+*/
+void push_run_queue(RunQueue* queue, Process* process) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->len == queue->capacity) {
+        printf("ERROR: RUN QUEUE IS FULL!\n");
+        exit(-1);
+    }
+
+    queue->processes[(queue->head + queue->len) % queue->capacity] = process;
+    queue->len++;
+    pthread_mutex_unlock(&queue->lock);
+}
+
+
+/*
+Takes the process from the front of a run queue, or NULL if it is empty.
+*/
+Process* pop_run_queue(RunQueue* queue) {
+    Process* process = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->len > 0) {
+        process = queue->processes[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->len--;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return process;
+}
+
+
+/*
+Takes the process from the end of a run queue, which has waited least and so is the one its CPU will
+miss least, or NULL if it is empty.
+*/
+Process* steal_run_queue(RunQueue* queue) {
+    Process* process = NULL;
+    pthread_mutex_lock(&queue->lock);
+    if (queue->len > 0) {
+        queue->len--;
+        process = queue->processes[(queue->head + queue->len) % queue->capacity];
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return process;
+}
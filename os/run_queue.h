@@ -0,0 +1,29 @@
+#ifndef RUN_QUEUE
+#define RUN_QUEUE
+
+#include <stdint.h>
+#include <pthread.h>
+#include "../machine.h"
+
+
+/**
+ * @brief The processes waiting to run on one CPU, in the order they are run. The CPU takes processes
+ * from the front and puts them back at the end after each burst, while other CPUs with nothing to run
+ * steal from the end, so each queue has its own lock.
+ */
+struct RunQueue {
+    Process** processes; // circular, capacity long
+    uint32_t capacity;
+    uint32_t head; // the index of the front of the queue
+    uint32_t len;
+    pthread_mutex_t lock;
+};
+
+
+RunQueue* new_run_queue(uint32_t capacity);
+void free_run_queue(RunQueue* queue);
+void push_run_queue(RunQueue* queue, Process* process);
+Process* pop_run_queue(RunQueue* queue);
+Process* steal_run_queue(RunQueue* queue);
+
+#endif
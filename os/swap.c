@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "swap.h"
+
+
+/**
+ * @brief Opens a swap device backed by the given file, which is created or emptied.
+ * 
+ * @param path The path of the swap file, or NULL to use an anonymous temporary file
+ * @return Pointer to the swap device, or NULL if the file could not be opened
+ */
+SwapDevice* new_swap_device(const char* path) {
+    FILE* file = path == NULL ? tmpfile() : fopen(path, "w+b");
+    if (file == NULL)
+        return NULL;
+
+    SwapDevice* swap = malloc(sizeof(SwapDevice));
+    if (swap == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR SWAP DEVICE!\n");
+        exit(-1);
+    }
+
+    swap->file = file;
+    swap->slot_types = NULL;
+    swap->free_slots = NULL;
+    swap->num_free_slots = 0;
+    swap->num_slots = 0;
+    swap->capacity = 0;
+    swap->page_ins = 0;
+    swap->page_outs = 0;
+
+    return swap;
+}
+
+
+/*
+Closes the swap file and frees the swap device.
+*/
+void free_swap_device(SwapDevice* swap) {
+    fclose(swap->file);
+    free(swap->slot_types);
+    free(swap->free_slots);
+    free(swap);
+}
+
+
+/*
+Gets a free slot, reusing an old one if possible and otherwise growing the file by one slot.
+*/
+static uint32_t get_free_slot(SwapDevice* swap) {
+    if (swap->num_free_slots > 0)
+        return swap->free_slots[--swap->num_free_slots];
+
+    if (swap->num_slots == swap->capacity) {
+        swap->capacity = swap->capacity == 0 ? 64 : swap->capacity * 2;
+        swap->slot_types = realloc(swap->slot_types, swap->capacity);
+        swap->free_slots = realloc(swap->free_slots, swap->capacity * sizeof(uint32_t));
+        if (swap->slot_types == NULL || swap->free_slots == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR SWAP DEVICE!\n");
+            exit(-1);
+        }
+    }
+
+    return swap->num_slots++;
+}
+
+
+/**
+ * @brief Writes a page out to a free slot in the swap file.
+ * 
+ * @param swap The swap device
+ * @param words The contents of the page
+ * @param len The number of words in a page
+ * @param type The type of the page, given back when it is swapped in
+ * @return The slot the page was written to, or -1 if it could not be written
+ */
+int64_t swap_out_page(SwapDevice* swap, const uint16_t* words, uint32_t len, char type) {
+    uint32_t slot = get_free_slot(swap);
+    fseek(swap->file, (long)slot * len * sizeof(uint16_t), SEEK_SET);
+    if (fwrite(words, sizeof(uint16_t), len, swap->file) != len) {
+        release_swap_slot(swap, slot);
+        return -1;
+    }
+
+    swap->slot_types[slot] = type;
+    swap->page_outs++;
+    return slot;
+}
+
+
+/**
+ * @brief Reads a page back in from the swap file and frees its slot.
+ * 
+ * @param swap The swap device
+ * @param slot The slot holding the page
+ * @param words Buffer to read the page into
+ * @param len The number of words in a page
+ * @return The type the page had when it was swapped out
+ */
+char swap_in_page(SwapDevice* swap, uint32_t slot, uint16_t* words, uint32_t len) {
+    fseek(swap->file, (long)slot * len * sizeof(uint16_t), SEEK_SET);
+    if (fread(words, sizeof(uint16_t), len, swap->file) != len) {
+        printf("ERROR: COULD NOT READ SLOT %u FROM SWAP!\n", slot);
+        exit(-1);
+    }
+
+    swap->page_ins++;
+    release_swap_slot(swap, slot);
+    return swap->slot_types[slot];
+}
+
+
+/*
+Frees a slot in the swap file so it can be used for another page.
+*/
+void release_swap_slot(SwapDevice* swap, uint32_t slot) {
+    swap->free_slots[swap->num_free_slots++] = slot;
+}
+
+
+void print_swap_stats(SwapDevice* swap) {
+    printf("Swap slots: %u\nSwap slots in use: %u\nPage-ins: %lu\nPage-outs: %lu\n", 
+        swap->num_slots, swap->num_slots - swap->num_free_slots, swap->page_ins, swap->page_outs);
+}
@@ -0,0 +1,31 @@
+#ifndef SWAP
+#define SWAP
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+/**
+ * @brief A file which pages evicted from physical memory are written to, one page per slot. Slots are
+ * reused once the page in them has been read back in or its process has ended.
+ */
+typedef struct SwapDevice {
+    FILE* file;
+    char* slot_types;     // the type of page held in each slot
+    uint32_t* free_slots; // stack of slots which have been used before and are free again
+    uint32_t num_free_slots;
+    uint32_t num_slots;   // the number of slots the file has grown to
+    uint32_t capacity;    // the length of slot_types and free_slots
+    unsigned long page_ins;
+    unsigned long page_outs;
+} SwapDevice;
+
+
+SwapDevice* new_swap_device(const char* path);
+void free_swap_device(SwapDevice* swap);
+int64_t swap_out_page(SwapDevice* swap, const uint16_t* words, uint32_t len, char type);
+char swap_in_page(SwapDevice* swap, uint32_t slot, uint16_t* words, uint32_t len);
+void release_swap_slot(SwapDevice* swap, uint32_t slot);
+void print_swap_stats(SwapDevice* swap);
+
+#endif
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tlb.h"
+
+
+/**
+ * @brief Creates an empty TLB.
+ * 
+ * @param size The number of entries, rounded up to the next power of 2
+ * @return Pointer to the new TLB
+ */
+TLB* new_TLB(uint32_t size) {
+    uint32_t num_entries = 1;
+    while (num_entries < size)
+        num_entries <<= 1;
+
+    TLB* tlb = malloc(sizeof(TLB));
+    TLBEntry* entries = malloc(sizeof(TLBEntry) * num_entries);
+    if (tlb == NULL || entries == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR TLB!\n");
+        exit(-1);
+    }
+
+    tlb->entries = entries;
+    tlb->mask = num_entries - 1;
+    tlb->hits = 0;
+    tlb->large_hits = 0;
+    tlb->misses = 0;
+    tlb->flushes = 0;
+    tlb->generation = 0;
+    flush_TLB(tlb);
+
+    return tlb;
+}
+
+
+/*
+Frees the TLB and its entries.
+*/
+void free_TLB(TLB* tlb) {
+    free(tlb->entries);
+    free(tlb);
+}
+
+
+/*
+Invalidates every entry in the TLB.
+*/
+void flush_TLB(TLB* tlb) {
+    for (uint32_t i = 0; i <= tlb->mask; i++) {
+        tlb->entries[i].logical_page = TLB_INVALID_PAGE;
+    }
+
+    for (uint32_t i = 0; i < LARGE_TLB_SIZE; i++) {
+        tlb->large_entries[i].logical_page = TLB_INVALID_PAGE;
+    }
+
+    tlb->process_id = -1;
+    tlb->flushes++;
+    tlb->generation++;
+}
+
+
+/*
+Invalidates the entry for the page holding the logical address, if it is cached, and the entry for the 
+large page holding it.
+*/
+void invalidate_TLB_page(TLB* tlb, uint32_t logical_addr) {
+    uint32_t page = logical_addr >> 12;
+    tlb->generation++;
+    if (tlb->entries[page & tlb->mask].logical_page == page)
+        tlb->entries[page & tlb->mask].logical_page = TLB_INVALID_PAGE;
+
+    uint32_t large_page = logical_addr >> LARGE_PAGE_SHIFT;
+    if (tlb->large_entries[large_page & (LARGE_TLB_SIZE - 1)].logical_page == large_page)
+        tlb->large_entries[large_page & (LARGE_TLB_SIZE - 1)].logical_page = TLB_INVALID_PAGE;
+}
+
+
+/*
+Caches the translation of the page holding the logical address, replacing whatever was in its entry.
+*/
+void fill_TLB(TLB* tlb, uint32_t logical_addr, uint32_t physical_addr, uint8_t writable) {
+    uint32_t page = logical_addr >> 12;
+    tlb->entries[page & tlb->mask].logical_page = page;
+    tlb->entries[page & tlb->mask].physical_start_addr = physical_addr & ~0x0FFF;
+    tlb->entries[page & tlb->mask].writable = writable;
+}
+
+
+/*
+Caches the translation of the large page holding the logical address.
+*/
+void fill_large_TLB(TLB* tlb, uint32_t logical_addr, uint32_t physical_addr, uint8_t writable) {
+    uint32_t page = logical_addr >> LARGE_PAGE_SHIFT;
+    TLBEntry* entry = &tlb->large_entries[page & (LARGE_TLB_SIZE - 1)];
+    entry->logical_page = page;
+    entry->physical_start_addr = physical_addr & ~((1 << LARGE_PAGE_SHIFT) - 1);
+    entry->writable = writable;
+}
+
+
+void print_TLB_stats(TLB* tlb) {
+    unsigned long lookups = tlb->hits + tlb->misses;
+    printf("TLB entries: %u (+%d large)\nHits: %lu (%lu large)\nMisses: %lu\nHit rate: %.3f\nFlushes: %lu\n", 
+        tlb->mask + 1, LARGE_TLB_SIZE, tlb->hits, tlb->large_hits, tlb->misses, 
+        lookups > 0 ? (double)tlb->hits / lookups : 0, tlb->flushes);
+}
@@ -0,0 +1,101 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+#define TLB_INVALID_PAGE 0xFFFFFFFF // no 20-bit page number can match this
+#define DEFAULT_TLB_SIZE 64
+#define LARGE_TLB_SIZE 16
+#define LARGE_PAGE_SHIFT 16
+
+
+/*
+A cached translation from a logical page number to the physical address of the start of its frame.
+*/
+typedef struct TLBEntry {
+    uint32_t logical_page;
+    uint32_t physical_start_addr;
+    uint8_t writable; // 0 if writes must go through the page table, as the page is read-only
+} TLBEntry;
+
+
+/**
+ * @brief A direct-mapped translation lookaside buffer for one CPU. Each logical page can only be cached
+ * in the entry given by the low bits of its page number. Entries are not tagged with a process, so the
+ * TLB only ever holds the translations of the process it was last filled for.
+ * 
+ * Large pages are cached in a separate, smaller array indexed by large page number, which is checked 
+ * when the ordinary entries miss.
+ */
+typedef struct TLB {
+    TLBEntry* entries;
+    uint32_t mask; // number of entries - 1, the number of entries is always a power of 2
+    TLBEntry large_entries[LARGE_TLB_SIZE];
+    int16_t process_id; // the process the entries belong to, or -1 if empty
+    unsigned long hits;
+    unsigned long large_hits; // hits counted in hits which were on a large page
+    unsigned long misses;
+    unsigned long flushes;
+    unsigned long generation; // changes whenever an entry is invalidated, so copies of a translation can tell it may be stale
+} TLB;
+
+
+TLB* new_TLB(uint32_t size);
+void free_TLB(TLB* tlb);
+void flush_TLB(TLB* tlb);
+void invalidate_TLB_page(TLB* tlb, uint32_t logical_addr);
+void fill_TLB(TLB* tlb, uint32_t logical_addr, uint32_t physical_addr, uint8_t writable);
+void fill_large_TLB(TLB* tlb, uint32_t logical_addr, uint32_t physical_addr, uint8_t writable);
+void print_TLB_stats(TLB* tlb);
+
+
+/*
+Looks up the logical address in the large page entries of the TLB, which are only checked once the 
+ordinary entries have missed.
+*/
+static inline int lookup_large_TLB(TLB* tlb, uint32_t logical_addr, uint32_t* physical_addr, int write) {
+    uint32_t page = logical_addr >> LARGE_PAGE_SHIFT;
+    TLBEntry* entry = &tlb->large_entries[page & (LARGE_TLB_SIZE - 1)];
+    if (entry->logical_page != page || (write && entry->writable == 0)) {
+        tlb->misses++;
+        return 0;
+    }
+
+    tlb->hits++;
+    tlb->large_hits++;
+    *physical_addr = entry->physical_start_addr | (logical_addr & ((1 << LARGE_PAGE_SHIFT) - 1));
+    return 1;
+}
+
+
+/*
+Looks up the logical address in the TLB, putting the physical address into `physical_addr` and 
+returning 1 on a hit, or returning 0 on a miss.
+*/
+static inline int lookup_TLB(TLB* tlb, uint32_t logical_addr, uint32_t* physical_addr) {
+    uint32_t page = logical_addr >> 12;
+    TLBEntry* entry = &tlb->entries[page & tlb->mask];
+    if (entry->logical_page != page)
+        return lookup_large_TLB(tlb, logical_addr, physical_addr, 0);
+
+    tlb->hits++;
+    *physical_addr = entry->physical_start_addr | (logical_addr & 0x0FFF);
+    return 1;
+}
+
+
+/*
+Looks up the logical address in the TLB for a write, which also misses if the cached page is read-only.
+*/
+static inline int lookup_TLB_write(TLB* tlb, uint32_t logical_addr, uint32_t* physical_addr) {
+    uint32_t page = logical_addr >> 12;
+    TLBEntry* entry = &tlb->entries[page & tlb->mask];
+    if (entry->logical_page != page || entry->writable == 0)
+        return lookup_large_TLB(tlb, logical_addr, physical_addr, 1);
+
+    tlb->hits++;
+    *physical_addr = entry->physical_start_addr | (logical_addr & 0x0FFF);
+    return 1;
+}
+
+#endif
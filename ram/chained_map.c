@@ -0,0 +1,202 @@
+/*
+RAM backend holding each word as a node in a chained hashmap.
+
+The hashmap contains a fixed number of proverbial "buckets" which each are a linked list which may be 
+empty. When adding a value to RAM, the item is appended to the linked list corresponding to the result 
+of the hash function when applied to its address.
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "ram_backends.h"
+
+
+/*
+Represents a node in a linked list in the RAM hashmap data structure.
+*/
+typedef struct RAMKeyValuePair {
+    uint32_t key;
+    uint16_t value;
+    struct RAMKeyValuePair* next;
+} RAMKeyValuePair;
+
+
+/*
+Contains the buckets which may contain 0, 1, or more items corresponding to values at addresses in 
+memory represented as a linked list.
+*/
+typedef struct ChainedMap {
+    RAMKeyValuePair** buckets;
+    long capacity;
+} ChainedMap;
+
+
+static void* chained_map_create(long capacity) {
+    ChainedMap* map = malloc(sizeof(ChainedMap));
+    RAMKeyValuePair** buckets = calloc(capacity, sizeof(RAMKeyValuePair*));
+    if (map == NULL || buckets == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM!\n");
+        exit(-2);
+    }
+
+    map->buckets = buckets;
+    map->capacity = capacity;
+    return map;
+}
+
+
+static void chained_map_destroy(void* store) {
+    ChainedMap* map = store;
+    for (long i = 0; i < map->capacity; i++) {
+        RAMKeyValuePair* current_kvp = map->buckets[i];
+        while (current_kvp != NULL) {
+            RAMKeyValuePair* next = current_kvp->next;
+            free(current_kvp);
+            current_kvp = next;
+        }
+    }
+
+    free(map->buckets);
+    free(map);
+}
+
+
+static long hash_function(ChainedMap* map, uint32_t input) {
+    return input % map->capacity;
+}
+
+
+/*
+Hashes the key (RAM address) and updates the value if it is already in the bucket's linked list, or 
+appends a new node to the end of the list if not.
+*/
+static void chained_map_write(void* store, uint32_t key, uint16_t value) {
+    ChainedMap* map = store;
+    RAMKeyValuePair** link = &map->buckets[hash_function(map, key)];
+    while (*link != NULL) {
+        if ((*link)->key == key) {
+            (*link)->value = value;
+            return;
+        }
+
+        link = &(*link)->next;
+    }
+
+    RAMKeyValuePair* pair = malloc(sizeof(RAMKeyValuePair));
+    pair->key = key;
+    pair->value = value;
+    pair->next = NULL;
+    *link = pair;
+}
+
+
+/*
+Goes through each item in the linked list for the key's bucket and returns the value of the first node 
+with the correct key, or 0 if there is none.
+*/
+static uint16_t chained_map_read(void* store, uint32_t key) {
+    ChainedMap* map = store;
+    RAMKeyValuePair* current_kvp = map->buckets[hash_function(map, key)];
+    while (current_kvp != NULL) {
+        if (current_kvp->key == key)
+            return current_kvp->value;
+
+        current_kvp = current_kvp->next;
+    }
+
+    return 0;
+}
+
+
+/*
+Unlinks and frees every node whose key is in the range. Each key in a short range is looked up in its 
+own bucket, while a range longer than the number of buckets is removed in one pass over all of them.
+*/
+static void chained_map_release_block(void* store, uint32_t key, uint32_t len) {
+    ChainedMap* map = store;
+    long first_bucket = 0, last_bucket = map->capacity - 1;
+    uint32_t num_keys = 1;
+    if (len <= map->capacity)
+        num_keys = len;
+
+    for (uint32_t i = 0; i < num_keys; i++) {
+        if (len <= map->capacity)
+            first_bucket = last_bucket = hash_function(map, key + i);
+
+        for (long bucket = first_bucket; bucket <= last_bucket; bucket++) {
+            RAMKeyValuePair** link = &map->buckets[bucket];
+            while (*link != NULL) {
+                if ((*link)->key - key < len) {
+                    RAMKeyValuePair* removed = *link;
+                    *link = removed->next;
+                    free(removed);
+                } else {
+                    link = &(*link)->next;
+                }
+            }
+        }
+    }
+}
+
+
+/*
+The probe length of a word is its position in its bucket's linked list, starting from 1.
+*/
+static void chained_map_get_stats(void* store, RAMStats* stats) {
+    ChainedMap* map = store;
+    unsigned long total_probes = 0;
+    for (long i = 0; i < map->capacity; i++) {
+        unsigned long position = 0;
+        for (RAMKeyValuePair* kvp = map->buckets[i]; kvp != NULL; kvp = kvp->next) {
+            position++;
+            total_probes += position;
+        }
+
+        stats->entries += position;
+        if (position > stats->max_probe_length)
+            stats->max_probe_length = position;
+    }
+
+    stats->capacity = map->capacity;
+    stats->load_factor = (double)stats->entries / map->capacity;
+    stats->mean_probe_length = stats->entries > 0 ? (double)total_probes / stats->entries : 0;
+    stats->host_bytes = sizeof(ChainedMap) + map->capacity * sizeof(RAMKeyValuePair*) 
+                        + stats->entries * sizeof(RAMKeyValuePair);
+}
+
+
+/*
+Iterates through each bucket in RAM and prints the contents from top to bottom.
+*/
+static void chained_map_print(void* store) {
+    ChainedMap* map = store;
+    for (long i = 0; i < map->capacity; i++) {
+        RAMKeyValuePair* current_kvp = map->buckets[i];
+        if (current_kvp == NULL)
+            continue;
+        
+        printf("Bucket %03lX:\n", i);
+        do {
+            printf("    0x%08X:\t0x%04hX\n", current_kvp->key, current_kvp->value);
+            current_kvp = current_kvp->next;
+        } while (current_kvp != NULL);
+
+        printf("\n");
+    }
+}
+
+
+const RAMBackend chained_map_backend = {
+    .name = "chained",
+    .create = chained_map_create,
+    .destroy = chained_map_destroy,
+    .write = chained_map_write,
+    .read = chained_map_read,
+    .read_block = NULL,
+    .write_block = NULL,
+    .release_block = chained_map_release_block,
+    .get_stats = chained_map_get_stats,
+    .print = chained_map_print,
+};
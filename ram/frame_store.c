@@ -0,0 +1,280 @@
+/*
+RAM backend holding words in a sparse two-level store of page frames.
+
+RAM is split into frames of 4K words, which line up with the pages handed out by the MMU, and a frame 
+is only allocated the first time something is written to it. The 32-bit address is split into three 
+parts: the top 10 bits index a directory of frame tables, the next 10 bits index a table of frames, 
+and the bottom 12 bits are the offset into the frame itself.
+
+With more than one CPU, frames are written by several host threads at once, so new frame tables and 
+frames are published with a compare and swap: a thread which loses the race frees its own and uses the 
+one which won. Each frame is only released by the kernel once no CPU can be using it.
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "ram_backends.h"
+
+#define FALSE 0
+#define TRUE  1
+
+#define RAM_TABLE_BITS 10
+#define RAM_TABLE_SIZE (1 << RAM_TABLE_BITS)
+#define RAM_DIRECTORY_SIZE (1 << (32 - RAM_FRAME_BITS - RAM_TABLE_BITS))
+
+#define DIRECTORY_INDEX(addr) ((addr) >> (RAM_FRAME_BITS + RAM_TABLE_BITS))
+#define TABLE_INDEX(addr) (((addr) >> RAM_FRAME_BITS) & (RAM_TABLE_SIZE - 1))
+#define FRAME_OFFSET(addr) ((addr) & (RAM_FRAME_SIZE - 1))
+
+
+/*
+A contiguous block of 4K words of RAM.
+*/
+typedef struct RAMFrame {
+    uint16_t words[RAM_FRAME_SIZE];
+} RAMFrame;
+
+
+/*
+Second level of the directory, mapping the middle bits of an address to the frame holding it.
+*/
+typedef struct RAMFrameTable {
+    RAMFrame* frames[RAM_TABLE_SIZE];
+} RAMFrameTable;
+
+
+typedef struct FrameStore {
+    RAMFrameTable* directory[RAM_DIRECTORY_SIZE];
+} FrameStore;
+
+
+static void* frame_store_create(long capacity) {
+    // all frame tables start as NULL and are only created when written to
+    FrameStore* store = calloc(1, sizeof(FrameStore));
+    if (store == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM!\n");
+        exit(-2);
+    }
+
+    return store;
+}
+
+
+static void frame_store_destroy(void* store) {
+    FrameStore* frames = store;
+    for (long i = 0; i < RAM_DIRECTORY_SIZE; i++) {
+        if (frames->directory[i] == NULL)
+            continue;
+
+        for (long j = 0; j < RAM_TABLE_SIZE; j++) {
+            free(frames->directory[i]->frames[j]);
+        }
+
+        free(frames->directory[i]);
+    }
+
+    free(frames);
+}
+
+
+/**
+ * @brief Finds the frame holding the given address, optionally creating it (and the frame table above
+ * it) if it does not exist yet.
+ * 
+ * @param store The frame store
+ * @param key Address inside the frame
+ * @param create TRUE to allocate the frame if it is missing, FALSE to return NULL instead
+ * @return Pointer to the frame, or NULL if it does not exist and create is FALSE
+ */
+static RAMFrame* get_frame(FrameStore* store, uint32_t key, short create) {
+    RAMFrameTable** table_slot = &store->directory[DIRECTORY_INDEX(key)];
+    RAMFrameTable* table = __atomic_load_n(table_slot, __ATOMIC_ACQUIRE);
+    if (table == NULL) {
+        if (create == FALSE)
+            return NULL;
+
+        RAMFrameTable* new_table = calloc(1, sizeof(RAMFrameTable));
+        if (new_table == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM FRAME TABLE!\n");
+            exit(-2);
+        }
+
+        // on failure, table is set to the table another thread published first
+        if (__atomic_compare_exchange_n(table_slot, &table, new_table, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            table = new_table;
+        else
+            free(new_table);
+    }
+
+    RAMFrame** frame_slot = &table->frames[TABLE_INDEX(key)];
+    RAMFrame* frame = __atomic_load_n(frame_slot, __ATOMIC_ACQUIRE);
+    if (frame == NULL && create == TRUE) {
+        RAMFrame* new_frame = calloc(1, sizeof(RAMFrame));
+        if (new_frame == NULL) {
+            printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM FRAME!\n");
+            exit(-2);
+        }
+
+        if (__atomic_compare_exchange_n(frame_slot, &frame, new_frame, FALSE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            frame = new_frame;
+        else
+            free(new_frame);
+    }
+
+    return frame;
+}
+
+
+static void frame_store_write(void* store, uint32_t key, uint16_t value) {
+    get_frame(store, key, TRUE)->words[FRAME_OFFSET(key)] = value;
+}
+
+
+static uint16_t frame_store_read(void* store, uint32_t key) {
+    RAMFrame* frame = get_frame(store, key, FALSE);
+    if (frame == NULL)
+        return 0;
+
+    return frame->words[FRAME_OFFSET(key)];
+}
+
+
+/*
+Copies whole runs of words at a time, looking up each frame only once. Frames which have never been 
+written read as zeros.
+*/
+static void frame_store_read_block(void* store, uint32_t key, uint16_t* buffer, uint32_t len) {
+    while (len > 0) {
+        uint32_t run = RAM_FRAME_SIZE - FRAME_OFFSET(key);
+        if (run > len)
+            run = len;
+
+        RAMFrame* frame = get_frame(store, key, FALSE);
+        if (frame == NULL)
+            memset(buffer, 0, run * sizeof(uint16_t));
+        else
+            memcpy(buffer, &frame->words[FRAME_OFFSET(key)], run * sizeof(uint16_t));
+
+        buffer += run;
+        key += run;
+        len -= run;
+    }
+}
+
+
+static void frame_store_write_block(void* store, uint32_t key, const uint16_t* buffer, uint32_t len) {
+    while (len > 0) {
+        uint32_t run = RAM_FRAME_SIZE - FRAME_OFFSET(key);
+        if (run > len)
+            run = len;
+
+        memcpy(&get_frame(store, key, TRUE)->words[FRAME_OFFSET(key)], buffer, run * sizeof(uint16_t));
+
+        buffer += run;
+        key += run;
+        len -= run;
+    }
+}
+
+
+/*
+Frees every frame which lies entirely inside the range, and zeroes the part of the range in any frame 
+it only partly covers.
+*/
+static void frame_store_release_block(void* store, uint32_t key, uint32_t len) {
+    FrameStore* frames = store;
+    while (len > 0) {
+        uint32_t run = RAM_FRAME_SIZE - FRAME_OFFSET(key);
+        if (run > len)
+            run = len;
+
+        RAMFrame* frame = get_frame(store, key, FALSE);
+        if (frame != NULL && run == RAM_FRAME_SIZE) {
+            __atomic_store_n(&frames->directory[DIRECTORY_INDEX(key)]->frames[TABLE_INDEX(key)], NULL, __ATOMIC_RELEASE);
+            free(frame);
+        } else if (frame != NULL) {
+            memset(&frame->words[FRAME_OFFSET(key)], 0, run * sizeof(uint16_t));
+        }
+
+        key += run;
+        len -= run;
+    }
+}
+
+
+/*
+Every lookup is exactly one directory and one table access, so the probe length is always 2. The load 
+factor is the fraction of words in allocated frames which are non-zero.
+*/
+static void frame_store_get_stats(void* store, RAMStats* stats) {
+    FrameStore* frames = store;
+    unsigned long num_tables = 0, num_frames = 0;
+    for (long i = 0; i < RAM_DIRECTORY_SIZE; i++) {
+        if (frames->directory[i] == NULL)
+            continue;
+
+        num_tables++;
+        for (long j = 0; j < RAM_TABLE_SIZE; j++) {
+            RAMFrame* frame = frames->directory[i]->frames[j];
+            if (frame == NULL)
+                continue;
+
+            num_frames++;
+            for (long k = 0; k < RAM_FRAME_SIZE; k++) {
+                if (frame->words[k] != 0)
+                    stats->entries++;
+            }
+        }
+    }
+
+    stats->capacity = num_frames * RAM_FRAME_SIZE;
+    stats->load_factor = num_frames > 0 ? (double)stats->entries / stats->capacity : 0;
+    stats->mean_probe_length = 2;
+    stats->max_probe_length = 2;
+    stats->host_bytes = sizeof(FrameStore) + num_tables * sizeof(RAMFrameTable) 
+                        + num_frames * sizeof(RAMFrame);
+}
+
+
+/*
+Iterates through each allocated frame in RAM and prints the non-zero words in it from top to bottom.
+*/
+static void frame_store_print(void* store) {
+    FrameStore* frames = store;
+    for (uint32_t i = 0; i < RAM_DIRECTORY_SIZE; i++) {
+        if (frames->directory[i] == NULL)
+            continue;
+        
+        for (uint32_t j = 0; j < RAM_TABLE_SIZE; j++) {
+            RAMFrame* frame = frames->directory[i]->frames[j];
+            if (frame == NULL)
+                continue;
+
+            uint32_t frame_addr = (i << (RAM_FRAME_BITS + RAM_TABLE_BITS)) | (j << RAM_FRAME_BITS);
+            printf("Frame 0x%08X:\n", frame_addr);
+            for (uint32_t k = 0; k < RAM_FRAME_SIZE; k++) {
+                if (frame->words[k] != 0)
+                    printf("    0x%08X:\t0x%04hX\n", frame_addr | k, frame->words[k]);
+            }
+
+            printf("\n");
+        }
+    }
+}
+
+
+const RAMBackend frame_store_backend = {
+    .name = "frames",
+    .create = frame_store_create,
+    .destroy = frame_store_destroy,
+    .write = frame_store_write,
+    .read = frame_store_read,
+    .read_block = frame_store_read_block,
+    .write_block = frame_store_write_block,
+    .release_block = frame_store_release_block,
+    .get_stats = frame_store_get_stats,
+    .print = frame_store_print,
+};
@@ -0,0 +1,249 @@
+/*
+RAM backend holding each word in an open-addressing hashmap.
+
+Every address/value pair lives directly in one array of slots. When adding a value, the slot given by 
+the hash of its address is tried first, then each following slot in turn (linear probing) until the 
+address or an empty slot is found. The array doubles in size whenever it becomes more than 3/4 full, 
+which keeps the runs of occupied slots short.
+*/
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "ram_backends.h"
+
+#define MAX_LOAD_NUMERATOR 3
+#define MAX_LOAD_DENOMINATOR 4
+
+
+typedef struct OpenAddressingSlot {
+    uint32_t key;
+    uint16_t value;
+    uint8_t used;
+} OpenAddressingSlot;
+
+
+typedef struct OpenAddressingMap {
+    OpenAddressingSlot* slots;
+    unsigned long capacity; // always a power of 2
+    unsigned long entries;
+    unsigned int shift; // 32 - log2(capacity), so the top bits of a hash index the slots
+} OpenAddressingMap;
+
+
+static OpenAddressingSlot* allocate_slots(unsigned long capacity) {
+    OpenAddressingSlot* slots = calloc(capacity, sizeof(OpenAddressingSlot));
+    if (slots == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM!\n");
+        exit(-2);
+    }
+
+    return slots;
+}
+
+
+/*
+Works out the shift which keeps the top log2(capacity) bits of a 32-bit hash.
+*/
+static unsigned int capacity_shift(unsigned long capacity) {
+    unsigned int shift = 32;
+    while (capacity > 1) {
+        capacity >>= 1;
+        shift--;
+    }
+
+    return shift;
+}
+
+
+static void* open_addressing_create(long capacity) {
+    OpenAddressingMap* map = malloc(sizeof(OpenAddressingMap));
+    if (map == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR RAM!\n");
+        exit(-2);
+    }
+
+    map->capacity = 1;
+    while (map->capacity < capacity)
+        map->capacity <<= 1;
+
+    map->shift = capacity_shift(map->capacity);
+    map->slots = allocate_slots(map->capacity);
+    map->entries = 0;
+    return map;
+}
+
+
+static void open_addressing_destroy(void* store) {
+    OpenAddressingMap* map = store;
+    free(map->slots);
+    free(map);
+}
+
+
+/*
+Fibonacci hashing, so that runs of consecutive addresses are spread across the whole table. The top bits 
+of the product are taken, as the low bits only depend on the low bits of the key, which would put every 
+address at the same offset in a page in the same slot.
+*/
+static unsigned long home_slot(OpenAddressingMap* map, uint32_t key) {
+    return (uint64_t)(uint32_t)(key * 2654435769u) >> map->shift;
+}
+
+
+/*
+Returns the slot holding the key, or the empty slot where it would be inserted.
+*/
+static OpenAddressingSlot* find_slot(OpenAddressingMap* map, uint32_t key) {
+    unsigned long index = home_slot(map, key);
+    while (map->slots[index].used && map->slots[index].key != key)
+        index = (index + 1) & (map->capacity - 1);
+
+    return &map->slots[index];
+}
+
+
+/*
+Doubles the number of slots and reinserts every entry into the new array.
+*/
+static void grow(OpenAddressingMap* map) {
+    OpenAddressingSlot* old_slots = map->slots;
+    unsigned long old_capacity = map->capacity;
+
+    map->capacity <<= 1;
+    map->shift = capacity_shift(map->capacity);
+    map->slots = allocate_slots(map->capacity);
+    for (unsigned long i = 0; i < old_capacity; i++) {
+        if (old_slots[i].used)
+            *find_slot(map, old_slots[i].key) = old_slots[i];
+    }
+
+    free(old_slots);
+}
+
+
+static void open_addressing_write(void* store, uint32_t key, uint16_t value) {
+    OpenAddressingMap* map = store;
+    OpenAddressingSlot* slot = find_slot(map, key);
+    if (slot->used) {
+        slot->value = value;
+        return;
+    }
+
+    if ((map->entries + 1) * MAX_LOAD_DENOMINATOR > map->capacity * MAX_LOAD_NUMERATOR) {
+        grow(map);
+        slot = find_slot(map, key);
+    }
+
+    slot->key = key;
+    slot->value = value;
+    slot->used = 1;
+    map->entries++;
+}
+
+
+static uint16_t open_addressing_read(void* store, uint32_t key) {
+    OpenAddressingSlot* slot = find_slot(store, key);
+    return slot->used ? slot->value : 0;
+}
+
+
+/*
+Empties the slot, then moves later entries in the same run back into the gap if that brings them no 
+further from their home slot, so that no lookup is cut short by the new empty slot.
+*/
+static void remove_slot(OpenAddressingMap* map, unsigned long index) {
+    unsigned long mask = map->capacity - 1;
+    unsigned long next = (index + 1) & mask;
+    while (map->slots[next].used) {
+        unsigned long home = home_slot(map, map->slots[next].key);
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            map->slots[index] = map->slots[next];
+            index = next;
+        }
+
+        next = (next + 1) & mask;
+    }
+
+    map->slots[index].used = 0;
+    map->entries--;
+}
+
+
+/*
+Removes every entry whose key is in the range. A range longer than the table is removed by rebuilding 
+the table from the entries outside it instead of one key at a time.
+*/
+static void open_addressing_release_block(void* store, uint32_t key, uint32_t len) {
+    OpenAddressingMap* map = store;
+    if (len <= map->capacity) {
+        for (uint32_t i = 0; i < len; i++) {
+            OpenAddressingSlot* slot = find_slot(map, key + i);
+            if (slot->used)
+                remove_slot(map, slot - map->slots);
+        }
+
+        return;
+    }
+
+    OpenAddressingSlot* old_slots = map->slots;
+    map->slots = allocate_slots(map->capacity);
+    map->entries = 0;
+    for (unsigned long i = 0; i < map->capacity; i++) {
+        if (old_slots[i].used && old_slots[i].key - key >= len) {
+            *find_slot(map, old_slots[i].key) = old_slots[i];
+            map->entries++;
+        }
+    }
+
+    free(old_slots);
+}
+
+
+/*
+The probe length of a word is the number of slots visited from its home slot to reach it, starting 
+from 1.
+*/
+static void open_addressing_get_stats(void* store, RAMStats* stats) {
+    OpenAddressingMap* map = store;
+    unsigned long total_probes = 0;
+    for (unsigned long i = 0; i < map->capacity; i++) {
+        if (!map->slots[i].used)
+            continue;
+
+        unsigned long probes = ((i - home_slot(map, map->slots[i].key)) & (map->capacity - 1)) + 1;
+        total_probes += probes;
+        if (probes > stats->max_probe_length)
+            stats->max_probe_length = probes;
+    }
+
+    stats->entries = map->entries;
+    stats->capacity = map->capacity;
+    stats->load_factor = (double)map->entries / map->capacity;
+    stats->mean_probe_length = map->entries > 0 ? (double)total_probes / map->entries : 0;
+    stats->host_bytes = sizeof(OpenAddressingMap) + map->capacity * sizeof(OpenAddressingSlot);
+}
+
+
+static void open_addressing_print(void* store) {
+    OpenAddressingMap* map = store;
+    for (unsigned long i = 0; i < map->capacity; i++) {
+        if (map->slots[i].used)
+            printf("Slot %06lX:\t0x%08X:\t0x%04hX\n", i, map->slots[i].key, map->slots[i].value);
+    }
+}
+
+
+const RAMBackend open_addressing_backend = {
+    .name = "open",
+    .create = open_addressing_create,
+    .destroy = open_addressing_destroy,
+    .write = open_addressing_write,
+    .read = open_addressing_read,
+    .read_block = NULL,
+    .write_block = NULL,
+    .release_block = open_addressing_release_block,
+    .get_stats = open_addressing_get_stats,
+    .print = open_addressing_print,
+};
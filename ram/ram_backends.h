@@ -0,0 +1,11 @@
+#ifndef RAMBACKENDS
+#define RAMBACKENDS
+
+#include "../internal_memory.h"
+
+
+extern const RAMBackend chained_map_backend;
+extern const RAMBackend open_addressing_backend;
+extern const RAMBackend frame_store_backend;
+
+#endif
@@ -3,18 +3,23 @@
 #include "registers.h"
 
 
+/*
+The bits of each register that can be set: none for $zero, the lower 16 for the 16-bit registers and all
+of them for the 32-bit registers.
+*/
+const uint32_t register_masks[NUM_REGISTERS] = {
+    0x00000000, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 
+    0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0x0000FFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+
 // Allocates memory for 16 registers and returns a pointer to that chunk of memory with all the registers
 // initialised to 0.
-Register* init_registers() {
-    Register* register_file = malloc(sizeof(Register) * 16);
-    for (int i = 0; i < 16; i++) {
-        Register new_register;
-        if (i < 0xC)
-            new_register.word_16 = 0;
-        else
-            new_register.word_32 = 0;
-
-        register_file[i] = new_register;
+uint32_t* init_registers() {
+    uint32_t* register_file = calloc(NUM_REGISTERS, sizeof(uint32_t));
+    if (register_file == NULL) {
+        printf("ERROR: COULD NOT ALLOCATE MEMORY FOR REGISTERS!\n");
+        exit(-1);
     }
 
     return register_file;
@@ -23,59 +28,60 @@ Register* init_registers() {
 
 /*
 Takes the index of a register, the new value, and a pointer to the array of registers, and changes 
-the value in the register to the new value. Will change the register, represented by a Union, to the
-field appropriate to that register, which is `short` if index < 12, and `int` otherwise.
+the value in the register to the new value. Only the `short` field of the value is used if index < 12, 
+and the `int` field otherwise.
 
 The register with index 0 will always be 0 and cannot be changed.
 */
-void update_register(unsigned int index, Register new_value, Register* registers) {
-    if (index == 0)
-        return;
-
-    if (index < 12)
-        registers[index].word_16 = new_value.word_16;
-    else if (index < 16)
-        registers[index].word_32 = new_value.word_32;
-    else
+void update_register(unsigned int index, Register new_value, uint32_t* registers) {
+    if (index >= NUM_REGISTERS)
         exit(-4);
+
+    write_register(registers, index, index < 12 ? new_value.word_16 : new_value.word_32);
 }
 
 
 /*
 Takes the index of a register and the array of register, and returns a `Register` containing the value of
-the register with that index. The field containing the value will be `short` if the index < 12, and `int`
-otherwise.
+the register with that index. Both fields of the `Register` hold the value, as the 16-bit registers are
+zero extended.
 
 The register at index 0 will always return 0.
 */
-Register get_register(unsigned int index, Register* registers) {
-    if (index == 0) {
-        Register zero;
-        zero.word_32 = 0;
-        return zero;
-    } else if (index > 15) {
+Register get_register(unsigned int index, uint32_t* registers) {
+    if (index >= NUM_REGISTERS) {
         printf("Invalid register index %d\n", index);
         exit(-4);
     }
 
-    return registers[index];
+    Register value;
+    value.word_32 = read_register(registers, index);
+    return value;
 }
 
 
 /*
 Takes the array of registers (which should have length 16), and prints their values.
 */
-void print_registers(Register* registers) {
-    printf("$zero: 0x0000\n");
+void print_registers(uint32_t* registers) {
+    fprint_registers(stdout, registers);
+}
+
+
+/*
+Prints the values of the registers to the given stream.
+*/
+void fprint_registers(FILE* stream, uint32_t* registers) {
+    fprintf(stream, "$zero: 0x0000\n");
 
     for (int i = 1; i < 11; i++) {
-        printf("$g%d: 0x%04hX\n", i-1, registers[i].word_16);
+        fprintf(stream, "$g%d: 0x%04hX\n", i-1, read_register_16(registers, i));
     }
 
-    printf("$ua: 0x%04hX\n", registers[11].word_16);
-    printf("$sp: 0x%08hX\n", registers[12].word_32);
-    printf("$fp: 0x%08hX\n", registers[13].word_32);
-    printf("$ra: 0x%08hX\n", registers[14].word_32);
-    printf("$pc: 0x%08hX\n", registers[15].word_32);
+    fprintf(stream, "$ua: 0x%04hX\n", read_register_16(registers, 11));
+    fprintf(stream, "$sp: 0x%08hX\n", read_register(registers, 12));
+    fprintf(stream, "$fp: 0x%08hX\n", read_register(registers, 13));
+    fprintf(stream, "$ra: 0x%08hX\n", read_register(registers, 14));
+    fprintf(stream, "$pc: 0x%08hX\n", read_register(registers, 15));
 }
 
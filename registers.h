@@ -2,18 +2,63 @@
 #define REGISTERS
 
 #include <stdint.h>
+#include <stdio.h>
 
-#define GET_REG_VAL(index) index < 12 ? get_register(index, registers).word_16 : get_register(index, registers).word_32
+#define NUM_REGISTERS 16
 
+/*
+A value given to or taken from a register by update_register and get_register. The register file itself
+is a flat array of NUM_REGISTERS words.
+*/
 typedef union Register {
     uint16_t word_16;
     uint32_t word_32;
 } Register;
 
 
-Register* init_registers();
-void update_register(unsigned int index, Register new_value, Register* registers);
-Register get_register(unsigned int index, Register* registers);
-void print_registers(Register* registers);
+extern const uint32_t register_masks[NUM_REGISTERS];
+
+uint32_t* init_registers();
+void update_register(unsigned int index, Register new_value, uint32_t* registers);
+Register get_register(unsigned int index, uint32_t* registers);
+void print_registers(uint32_t* registers);
+void fprint_registers(FILE* stream, uint32_t* registers);
+
+
+/*
+The accessors below do not check the index, which must be less than NUM_REGISTERS. Indices taken from an
+instruction are always in range, as decode_command takes each one from a single nibble.
+
+Every write is masked with the mask of its register, so $zero is always 0 and the 16-bit registers are 
+always zero extended, which lets any register be read with a single load.
+*/
+static inline uint32_t read_register(const uint32_t* registers, unsigned int index) {
+    return registers[index];
+}
+
+
+static inline uint16_t read_register_16(const uint32_t* registers, unsigned int index) {
+    return registers[index];
+}
+
+
+static inline void write_register(uint32_t* registers, unsigned int index, uint32_t value) {
+    registers[index] = value & register_masks[index];
+}
+
+
+// writes to a register known to be one of the 32-bit registers, which have no mask
+static inline void write_register_32(uint32_t* registers, unsigned int index, uint32_t value) {
+    registers[index] = value;
+}
+
+
+/*
+Writes the lower 16 bits of a register, keeping the upper 16 bits of the 32-bit registers, as the ALU 
+does with the result of an addition.
+*/
+static inline void write_register_lower(uint32_t* registers, unsigned int index, uint16_t value) {
+    registers[index] = ((registers[index] & 0xFFFF0000) | value) & register_masks[index];
+}
 
 #endif
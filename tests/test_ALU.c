@@ -13,47 +13,48 @@ Test that ALU addition does the following:
   - sets the flags correctly
 */
 void test_add() {
-    Register* registers = init_registers();
+    uint32_t* registers = init_registers();
+    struct ALU_last_op last_op = { 0, 0 };
     Register new_reg;
 
     // Check will not change the $zero register
-    addition(5, 5, 0, registers);
+    addition(5, 5, 0, registers, &last_op);
     assert(get_register(0, registers).word_16 == 0);
 
     // Check will add 16-bit registers
-    addition(0x4444, 0x4321, 1, registers);
+    addition(0x4444, 0x4321, 1, registers, &last_op);
     assert(get_register(1, registers).word_16 == 0x8765);
 
     // Check will add 32-bit registers (will only add the 1st 16 bits and AND them 
     // into the 1st 16-bits of the 32 bit-reg)    
     new_reg.word_32 = 0x55555555;
     update_register(13, new_reg, registers);
-    addition(0x5555, 0xF123, 13, registers);
+    addition(0x5555, 0xF123, 13, registers, &last_op);
     assert(get_register(13, registers).word_32 == 0x55554678);
 
     // Check will properly add a 16-bit to a 32-bit register
     new_reg.word_32 = 0xAAAAAAAA;
     update_register(13, new_reg, registers);
-    addition(0x1234, 0xAAAA, 13, registers);
+    addition(0x1234, 0xAAAA, 13, registers, &last_op);
     assert(get_register(13, registers).word_32 == 0xAAAABCDE);
 
     // Check sets flags correctly
-    addition(0, 0, 1, registers);
-    assert(alu_flags.zero == 1);
-    assert(alu_flags.carry == 0);
-    assert(alu_flags.negative == 0);
+    addition(0, 0, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 1);
+    assert(get_alu_flags(&last_op).carry == 0);
+    assert(get_alu_flags(&last_op).negative == 0);
 
-    addition(5, 5, 1, registers);
-    assert(alu_flags.zero == 0);
-    assert(alu_flags.carry == 0);
-    assert(alu_flags.negative == 0);
+    addition(5, 5, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 0);
+    assert(get_alu_flags(&last_op).carry == 0);
+    assert(get_alu_flags(&last_op).negative == 0);
 
     new_reg.word_32 = 0;
     update_register(0, new_reg, registers);
-    addition(0xF000, 0xA000, 1, registers);
-    assert(alu_flags.zero == 0);
-    assert(alu_flags.carry == 1);
-    assert(alu_flags.negative == 1);
+    addition(0xF000, 0xA000, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 0);
+    assert(get_alu_flags(&last_op).carry == 1);
+    assert(get_alu_flags(&last_op).negative == 1);
 }
 
 
@@ -65,48 +66,73 @@ Test that the ALU can do the following:
   - sets the flags correctly
 */
 void test_subtraction() {
-    Register* registers = init_registers();
+    uint32_t* registers = init_registers();
+    struct ALU_last_op last_op = { 0, 0 };
     Register new_reg;
 
     // Check will not change the $zero register
-    addition(8, 5, 0, registers);
+    addition(8, 5, 0, registers, &last_op);
     assert(get_register(0, registers).word_16 == 0);
 
     // Check will subtract 16-bit registers properly
-    subtraction(10, 5, 1, registers);
+    subtraction(10, 5, 1, registers, &last_op);
     assert(get_register(1, registers).word_16 == 5);
 
     // Check will subtract 32-bit registers (will only add the 1st 16 bits and AND them 
     // into the 1st 16-bits of the 32 bit-reg)    
     new_reg.word_32 = 0x55555555;
     update_register(13, new_reg, registers);
-    subtraction(0x5555, 0x3333, 13, registers);
+    subtraction(0x5555, 0x3333, 13, registers, &last_op);
     assert(get_register(13, registers).word_32 == 0x55552222);
 
     new_reg.word_32 = 0x55555555;
     update_register(13, new_reg, registers);
-    subtraction(0x5555, 0x7777, 13, registers);
+    subtraction(0x5555, 0x7777, 13, registers, &last_op);
     assert(get_register(13, registers).word_32 == 0x5555DDDE);
 
     // Check sets the flags correctly
-    subtraction(5, 5, 1, registers);
-    assert(alu_flags.zero == 1);
-    assert(alu_flags.negative == 0);
-    assert(alu_flags.carry == 0);   
-
-    subtraction(5, 10, 1, registers);
-    assert(alu_flags.zero == 0);
-    assert(alu_flags.negative == 1);
-    assert(alu_flags.carry == 0);
-
-    subtraction(0x8000, 1, 1, registers);
-    assert(alu_flags.zero == 0);
-    assert(alu_flags.negative == 0);
-    assert(alu_flags.carry == 1);
+    subtraction(5, 5, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 1);
+    assert(get_alu_flags(&last_op).negative == 0);
+    assert(get_alu_flags(&last_op).carry == 0);   
+
+    subtraction(5, 10, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 0);
+    assert(get_alu_flags(&last_op).negative == 1);
+    assert(get_alu_flags(&last_op).carry == 0);
+
+    subtraction(0x8000, 1, 1, registers, &last_op);
+    assert(get_alu_flags(&last_op).zero == 0);
+    assert(get_alu_flags(&last_op).negative == 0);
+    assert(get_alu_flags(&last_op).carry == 1);
+}
+
+
+/*
+Test that the flags set when a process is switched back in are the ones read back, for every combination
+an addition can give.
+*/
+void test_flags_restore() {
+    struct ALU_last_op last_op;
+    struct ALU_flags flags, restored;
+    const int combinations[5][3] = { {1, 0, 0}, {0, 0, 0}, {0, 1, 0}, {0, 1, 1}, {0, 0, 1} };
+
+    for (int i = 0; i < 5; i++) {
+        flags.zero = combinations[i][0];
+        flags.negative = combinations[i][1];
+        flags.carry = combinations[i][2];
+        set_alu_flags(&last_op, flags);
+
+        restored = get_alu_flags(&last_op);
+        assert(restored.zero == flags.zero);
+        assert(restored.negative == flags.negative);
+        assert(restored.carry == flags.carry);
+    }
 }
 
 
 void test_ALU() {
     test_add();
     test_subtraction();
+    test_flags_restore();
 }
@@ -3,5 +3,6 @@
 
 void test_ALU();
 void test_add();
+void test_flags_restore();
 
 #endif
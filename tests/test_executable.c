@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../os/executable.h"
+#include "../os/microkernel.h"
+
+
+/*
+A raw image of 3 code words, "data:" and 2 data words, then "text:" and 1 text word.
+*/
+static const uint16_t raw_image[] = {
+    0x1111, 0x2222, 0x3333,
+    0x6164, 0x6174, 0x003A, 0x4444, 0x5555,
+    0x6574, 0x7478, 0x003A, 0x6666
+};
+static const long raw_image_len = sizeof(raw_image) / sizeof(raw_image[0]);
+
+
+/*
+Checks the sections found in raw_image.
+*/
+static void check_raw_image_sections(const ExecutableSection* sections, int num_sections) {
+    assert(num_sections == 3);
+    assert(sections[0].type == CODE_PAGE && sections[0].offset == 0 && sections[0].len == 3);
+    assert(sections[1].type == DATA_PAGE && sections[1].offset == 6 && sections[1].len == 2);
+    assert(sections[2].type == TEXT_PAGE && sections[2].offset == 11 && sections[2].len == 1);
+}
+
+
+/*
+Reading a valid header should:
+  - find the magic words
+  - give back each section entry with its offset and length joined from 2 words
+*/
+void test_executable_header() {
+    const uint16_t image[] = {
+        EXECUTABLE_MAGIC_0, EXECUTABLE_MAGIC_1, EXECUTABLE_VERSION, 2,
+        CODE_PAGE, 0, 14, 0, 2,
+        DATA_PAGE, 0, 16, 0, 1,
+        0xAAAA, 0xBBBB, 0xCCCC
+    };
+    long len = sizeof(image) / sizeof(image[0]);
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+
+    assert(has_executable_header(image, len));
+    assert(get_executable_sections(image, len, sections) == 2);
+    assert(sections[0].type == CODE_PAGE && sections[0].offset == 14 && sections[0].len == 2);
+    assert(sections[1].type == DATA_PAGE && sections[1].offset == 16 && sections[1].len == 1);
+
+    // the upper word of the offset and length come first
+    const uint16_t large_image[] = {
+        EXECUTABLE_MAGIC_0, EXECUTABLE_MAGIC_1, EXECUTABLE_VERSION, 1,
+        TEXT_PAGE, 0x0001, 0x0002, 0x0003, 0x0004
+    };
+    assert(read_executable_header(large_image, 9, 0x00050000, sections) == 1);
+    assert(sections[0].offset == 0x00010002 && sections[0].len == 0x00030004);
+}
+
+
+/*
+An image whose header is invalid should:
+  - not be taken as having a header if either magic word is wrong
+  - be rejected if its version is not EXECUTABLE_VERSION
+  - be rejected if a section starts or ends past the end of the file
+  - be rejected if its section entries run past the words in memory
+*/
+void test_executable_bad_header() {
+    uint16_t image[] = {
+        EXECUTABLE_MAGIC_0, EXECUTABLE_MAGIC_1, EXECUTABLE_VERSION, 1,
+        CODE_PAGE, 0, 9, 0, 2,
+        0xAAAA, 0xBBBB
+    };
+    long len = sizeof(image) / sizeof(image[0]);
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+    assert(get_executable_sections(image, len, sections) == 1);
+
+    image[0] = 0x5248;
+    assert(!has_executable_header(image, len));
+    image[0] = EXECUTABLE_MAGIC_0;
+    image[1] = 0x4558;
+    assert(!has_executable_header(image, len));
+    image[1] = EXECUTABLE_MAGIC_1;
+
+    image[2] = EXECUTABLE_VERSION + 1;
+    assert(get_executable_sections(image, len, sections) == -1);
+    image[2] = EXECUTABLE_VERSION;
+
+    // the section runs one word past the end
+    image[8] = 3;
+    assert(get_executable_sections(image, len, sections) == -1);
+    image[8] = 2;
+
+    // the section starts past the end
+    image[6] = 12;
+    image[8] = 0;
+    assert(get_executable_sections(image, len, sections) == -1);
+    image[6] = 9;
+    image[8] = 2;
+
+    assert(read_executable_header(image, 8, len, sections) == -1);
+    assert(read_executable_header(image, 9, len, sections) == 1);
+}
+
+
+/*
+An image without a header should fall back to being scanned for its "data:" and "text:" markers, with
+everything before the first marker taken as code.
+*/
+void test_executable_raw_image() {
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+
+    assert(!has_executable_header(raw_image, raw_image_len));
+    check_raw_image_sections(sections, get_executable_sections(raw_image, raw_image_len, sections));
+
+    // an image with no markers is all code
+    assert(get_executable_sections(raw_image, 3, sections) == 1);
+    assert(sections[0].type == CODE_PAGE && sections[0].offset == 0 && sections[0].len == 3);
+}
+
+
+/*
+Scanning a raw image in pieces should find the same sections however it is split, including when a
+marker is split across two pieces.
+*/
+void test_executable_split_scan() {
+    ExecutableSection sections[MAX_EXECUTABLE_SECTIONS];
+    SectionScanner scanner;
+
+    for (long split = 0; split <= raw_image_len; split++) {
+        start_section_scan(&scanner, sections);
+        assert(scan_section_words(&scanner, raw_image, split) == 0);
+        assert(scan_section_words(&scanner, raw_image + split, raw_image_len - split) == 0);
+        check_raw_image_sections(sections, finish_section_scan(&scanner));
+    }
+
+    // one word at a time splits every marker across three pieces
+    start_section_scan(&scanner, sections);
+    for (long i = 0; i < raw_image_len; i++) {
+        assert(scan_section_words(&scanner, raw_image + i, 1) == 0);
+    }
+
+    check_raw_image_sections(sections, finish_section_scan(&scanner));
+}
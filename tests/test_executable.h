@@ -0,0 +1,9 @@
+#ifndef TEST_EXECUTABLE
+#define TEST_EXECUTABLE
+
+void test_executable_header();
+void test_executable_bad_header();
+void test_executable_raw_image();
+void test_executable_split_scan();
+
+#endif
@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../os/frame_allocator.h"
+
+
+/*
+Allocating and freeing single frames should:
+  - hand out the lowest free frame first
+  - count each allocated frame as no longer free
+  - hand a released frame out again before any higher one
+*/
+void test_frame_allocator_single() {
+    FrameAllocator* allocator = new_frame_allocator(100);
+    assert(allocator->num_free == 100);
+
+    assert(allocate_frame(allocator) == 0);
+    assert(allocate_frame(allocator) == 1);
+    assert(allocate_frame(allocator) == 2);
+    assert(allocator->num_free == 97);
+
+    release_frame(allocator, 1);
+    assert(allocator->num_free == 98);
+    assert(allocate_frame(allocator) == 1);
+    assert(allocate_frame(allocator) == 3);
+
+    free_frame_allocator(allocator);
+}
+
+
+/*
+Allocating many frames at once should:
+  - hand out the lowest free frames, in order, across words of the bitmap
+  - skip frames which are already allocated
+*/
+void test_frame_allocator_bulk() {
+    FrameAllocator* allocator = new_frame_allocator(300);
+    uint32_t frames[150];
+
+    assert(allocate_frame(allocator) == 0);
+    assert(allocate_frame(allocator) == 1);
+    release_frame(allocator, 0);
+
+    assert(allocate_frames(allocator, 150, frames) == 0);
+    assert(frames[0] == 0);
+    for (int i = 1; i < 150; i++) {
+        assert(frames[i] == i + 1);
+    }
+
+    assert(allocator->num_free == 300 - 151);
+    assert(allocate_frame(allocator) == 151);
+
+    free_frame_allocator(allocator);
+}
+
+
+/*
+Allocating an aligned run of frames, as for a 64K large page, should:
+  - start the run at a multiple of its length
+  - skip runs which have any frame allocated
+  - give back -1 when no whole aligned run is free, even if enough frames are
+*/
+void test_frame_allocator_aligned() {
+    FrameAllocator* allocator = new_frame_allocator(64);
+
+    assert(allocate_frame(allocator) == 0);
+    assert(allocate_aligned_frames(allocator, 16) == 16);
+    assert(allocator->num_free == 64 - 17);
+    assert(allocate_aligned_frames(allocator, 16) == 32);
+    assert(allocate_aligned_frames(allocator, 16) == 48);
+
+    // frames 1 to 15 are free, but not as an aligned run of 16
+    assert(allocate_aligned_frames(allocator, 16) == -1);
+    assert(allocator->num_free == 15);
+
+    release_frame(allocator, 0);
+    assert(allocate_aligned_frames(allocator, 16) == 0);
+    assert(allocator->num_free == 0);
+
+    free_frame_allocator(allocator);
+}
+
+
+/*
+Releasing a frame which is already free should leave the allocator as it was, so the frame is not
+handed out twice.
+*/
+void test_frame_allocator_double_free() {
+    FrameAllocator* allocator = new_frame_allocator(10);
+
+    assert(allocate_frame(allocator) == 0);
+    release_frame(allocator, 0);
+    release_frame(allocator, 0);
+    assert(allocator->num_free == 10);
+
+    release_frame(allocator, 5);
+    assert(allocator->num_free == 10);
+
+    for (int i = 0; i < 10; i++) {
+        assert(allocate_frame(allocator) == i);
+    }
+
+    assert(allocate_frame(allocator) == -1);
+
+    free_frame_allocator(allocator);
+}
+
+
+/*
+Once every frame is allocated:
+  - allocating a frame, frames or an aligned run should give back -1
+  - a failed bulk allocation should allocate none of the frames
+*/
+void test_frame_allocator_exhaustion() {
+    FrameAllocator* allocator = new_frame_allocator(70);
+    uint32_t frames[70];
+
+    assert(allocate_frames(allocator, 71, frames) == -1);
+    assert(allocator->num_free == 70);
+
+    assert(allocate_frames(allocator, 70, frames) == 0);
+    assert(allocator->num_free == 0);
+    assert(allocate_frame(allocator) == -1);
+    assert(allocate_frames(allocator, 1, frames) == -1);
+    assert(allocate_aligned_frames(allocator, 16) == -1);
+
+    release_frame(allocator, 69);
+    assert(allocate_frame(allocator) == 69);
+    assert(allocate_frame(allocator) == -1);
+
+    free_frame_allocator(allocator);
+}
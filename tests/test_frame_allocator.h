@@ -0,0 +1,10 @@
+#ifndef TEST_FRAME_ALLOCATOR
+#define TEST_FRAME_ALLOCATOR
+
+void test_frame_allocator_single();
+void test_frame_allocator_bulk();
+void test_frame_allocator_aligned();
+void test_frame_allocator_double_free();
+void test_frame_allocator_exhaustion();
+
+#endif
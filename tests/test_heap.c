@@ -0,0 +1,72 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../machine.h"
+#include "../os/microkernel.h"
+#include "../os/tlb.h"
+
+
+/*
+Creates a machine running one process with a program of a single word, so it has an empty heap.
+*/
+static Process* new_heap_test_process(Machine** machine) {
+    static const uint16_t program[] = { 0x0000 };
+    *machine = new_machine(init_RAM(RAM_FRAME_STORE, 1024), 1);
+    init_MMU(*machine, 1024);
+    init_TLB(*machine, DEFAULT_TLB_SIZE);
+    init_processes(*machine);
+
+    Process* process = new_process_with_args(0, program, 1, 0, NULL, *machine);
+    assert(process != NULL);
+    return process;
+}
+
+
+/*
+Allocating from the heap should:
+  - give back -1 for a block of 0 bytes or one larger than the heap
+  - give back the lowest free block of the right size, in either half of a split block
+  - give back -1 once the heap is full, and the freed space again once both halves of a block are freed
+*/
+void test_heap_allocate() {
+    Machine* machine;
+    Process* process = new_heap_test_process(&machine);
+    uint32_t start = process->heap_start;
+
+    assert(allocate_memory(process->heap_root, 0, process->stack_bottom) == (uint32_t)-1);
+    assert(allocate_memory(process->heap_root, HEAP_SIZE + 1, process->stack_bottom) == (uint32_t)-1);
+
+    assert(allocate_memory(process->heap_root, HEAP_SIZE / 2, process->stack_bottom) == start);
+    assert(allocate_memory(process->heap_root, HEAP_SIZE / 4, process->stack_bottom) == start + HEAP_SIZE / 2);
+    assert(allocate_memory(process->heap_root, HEAP_SIZE / 4, process->stack_bottom) == start + HEAP_SIZE * 3 / 4);
+    assert(allocate_memory(process->heap_root, 1, process->stack_bottom) == (uint32_t)-1);
+
+    free_memory(process->heap_root, start + HEAP_SIZE / 2);
+    free_memory(process->heap_root, start + HEAP_SIZE * 3 / 4);
+    assert(allocate_memory(process->heap_root, 0x100, process->stack_bottom) == start + HEAP_SIZE / 2);
+
+    free_machine(machine);
+}
+
+
+/*
+Growing a full heap with sbrk should let the new pages be allocated, from just past the old end of the
+heap, while blocks past the new end still cannot be.
+*/
+void test_heap_allocate_after_sbrk() {
+    Machine* machine;
+    Process* process = new_heap_test_process(&machine);
+    uint32_t start = process->heap_start;
+
+    assert(allocate_memory(process->heap_root, HEAP_SIZE, process->stack_bottom) == start);
+    assert(allocate_memory(process->heap_root, 0x8000, process->stack_bottom) == (uint32_t)-1);
+
+    change_heap_size(16, process, machine);
+    assert(process->stack_bottom == start + HEAP_SIZE + 16 * PAGE_SIZE);
+    assert(allocate_memory(process->heap_root, 0x8000, process->stack_bottom) == start + HEAP_SIZE);
+    assert(allocate_memory(process->heap_root, 0x8000, process->stack_bottom) == start + HEAP_SIZE + 0x8000);
+    assert(allocate_memory(process->heap_root, 0x8000, process->stack_bottom) == (uint32_t)-1);
+
+    free_machine(machine);
+}
@@ -0,0 +1,7 @@
+#ifndef TEST_HEAP
+#define TEST_HEAP
+
+void test_heap_allocate();
+void test_heap_allocate_after_sbrk();
+
+#endif
@@ -3,69 +3,206 @@
 #include <stdio.h>
 #include "../internal_memory.h"
 
+static const RAMBackendType backends[] = { RAM_CHAINED_MAP, RAM_OPEN_ADDRESSING, RAM_FRAME_STORE };
+static const int num_backends = sizeof(backends) / sizeof(backends[0]);
+
 
 /*
-Upon initialisation the RAM should:
-  - have the correct number of "buckets"
-  - all buckets should be empty (pointers == NULL)
+Upon initialisation the RAM should, for every backend:
+  - hold no entries
+  - return 0 when reading an address that was never written
+  - not store anything when reading an address that was never written
 */
 void test_ram_init() {
-    RAM* ram = init_RAM(1024);
-    for (long i = 0; i < 1024; i++) {
-        assert(ram->buckets[i] == NULL);
-    }
+    for (int i = 0; i < num_backends; i++) {
+        RAM* ram = init_RAM(backends[i], 1024);
+        RAMStats stats;
+
+        get_RAM_stats(ram, &stats);
+        assert(stats.entries == 0);
 
-    free (ram);
+        assert(get_from_ram(ram, 0x12345678) == 0);
+        get_RAM_stats(ram, &stats);
+        assert(stats.entries == 0);
+
+        free_RAM(ram);
+    }
 }
 
 
 /*
-When inserting into the RAM the value should:
-  - be inserted at the top correctly if the first value in that bucket
-  - be inserted at the end if not the first value in that bucket
+When inserting into the RAM the value should, for every backend:
+  - be inserted correctly if the first value at that hash or in that frame
+  - be inserted correctly if not the first value at that hash or in that frame
+  - be inserted correctly at the very top of the address space
   - properly store all correct 16-bit values
   - not properly store values that overflow 16-bits
 */
 void test_ram_insert() {
-    reset_RAM(); // allow for a new RAM to be initialised
-
-    RAM* ram = init_RAM(1024);
-    add_to_ram(ram, 0, 0x0000);
-    add_to_ram(ram, 1, 0x000F);
-    add_to_ram(ram, 1024, 0x0005);
-    add_to_ram(ram, 2048, 0x0006);
-    add_to_ram(ram, 100, 0xABCDEF);
-
-    assert(get_from_ram(ram, 0) == 0);
-    assert(get_from_ram(ram, 1) == 15);
-    assert(get_from_ram(ram, 1024) == 5);
-    assert(get_from_ram(ram, 2048) == 6);
-    assert(get_from_ram(ram, 1) != 0xABCDEF);
-    free(ram);
+    for (int i = 0; i < num_backends; i++) {
+        RAM* ram = init_RAM(backends[i], 1024);
+        add_to_ram(ram, 0, 0x0000);
+        add_to_ram(ram, 1, 0x000F);
+        add_to_ram(ram, 1024, 0x0005);
+        add_to_ram(ram, 2048, 0x0006);
+        add_to_ram(ram, 100, 0xABCDEF);
+        add_to_ram(ram, 0xFFFFFFFF, 0x0007);
+
+        assert(get_from_ram(ram, 0) == 0);
+        assert(get_from_ram(ram, 1) == 15);
+        assert(get_from_ram(ram, 1024) == 5);
+        assert(get_from_ram(ram, 2048) == 6);
+        assert(get_from_ram(ram, 1) != 0xABCDEF);
+        assert(get_from_ram(ram, 0xFFFFFFFF) == 7);
+        assert(get_from_ram(ram, 0xFFFFFFFE) == 0);
+        free_RAM(ram);
+    }
 }
 
 
 /* 
-When updating an existant value in RAM, the value should:
-  - update the correct value at the start of the bucket
-  - update the correct value in the middle of the bucket
-  - update the correct value at the end of the bucket
+When updating an existant value in RAM, the value should, for every backend:
+  - update the correct value at the start of a bucket or frame
+  - update the correct value in the middle of a bucket or frame
+  - update the correct value at the end of a bucket or frame
 */
 void test_ram_update() {
-    reset_RAM(); // allow for a new RAM to be initialised
-
-    // initialise values
-    RAM* ram = init_RAM(1024);
-    add_to_ram(ram, 0, 0x0000);
-    add_to_ram(ram, 1024, 0x0005);
-    add_to_ram(ram, 2048, 0x0006);
-
-    // update values
-    add_to_ram(ram, 0, 0x0001);
-    add_to_ram(ram, 1024, 0x0002);
-    add_to_ram(ram, 2048, 0x0003);
-
-    assert(get_from_ram(ram, 0) == 1);
-    assert(get_from_ram(ram, 1024) == 2);
-    assert(get_from_ram(ram, 2048) == 3);
+    for (int i = 0; i < num_backends; i++) {
+        // initialise values
+        RAM* ram = init_RAM(backends[i], 1024);
+        add_to_ram(ram, 0, 0x0000);
+        add_to_ram(ram, 1024, 0x0005);
+        add_to_ram(ram, 4095, 0x0006);
+
+        // update values
+        add_to_ram(ram, 0, 0x0001);
+        add_to_ram(ram, 1024, 0x0002);
+        add_to_ram(ram, 4095, 0x0003);
+
+        assert(get_from_ram(ram, 0) == 1);
+        assert(get_from_ram(ram, 1024) == 2);
+        assert(get_from_ram(ram, 4095) == 3);
+        free_RAM(ram);
+    }
+}
+
+
+/*
+When filling RAM with many more values than its initial capacity:
+  - every backend should return every value
+  - the open-addressing backend should grow to keep its load factor at or below 3/4, and keep its probes
+    short even for addresses at the same offset in consecutive pages
+  - the chained backend should report the correct load factor and longest chain
+*/
+void test_ram_stats() {
+    for (int i = 0; i < num_backends; i++) {
+        RAM* ram = init_RAM(backends[i], 16);
+        for (unsigned int addr = 0; addr < 10000; addr++) {
+            add_to_ram(ram, addr * 3, addr + 1);
+        }
+
+        for (unsigned int addr = 0; addr < 10000; addr++) {
+            assert(get_from_ram(ram, addr * 3) == (short)(addr + 1));
+        }
+
+        RAMStats stats;
+        get_RAM_stats(ram, &stats);
+        if (backends[i] == RAM_OPEN_ADDRESSING) {
+            assert(stats.entries == 10000);
+            assert(stats.load_factor <= 0.75);
+        } else if (backends[i] == RAM_CHAINED_MAP) {
+            assert(stats.entries == 10000);
+            assert(stats.capacity == 16);
+            assert(stats.load_factor == 10000.0 / 16);
+            assert(stats.max_probe_length == 625);
+        }
+
+        free_RAM(ram);
+    }
+
+    // fill the open-addressing backend to 3/4 with one address per page
+    RAM* ram = init_RAM(RAM_OPEN_ADDRESSING, 8192);
+    for (unsigned int page = 0; page < 6144; page++) {
+        add_to_ram(ram, page * 4096 + 5, page + 1);
+    }
+
+    RAMStats stats;
+    get_RAM_stats(ram, &stats);
+    assert(stats.capacity == 8192);
+    assert(stats.mean_probe_length < 2);
+    free_RAM(ram);
+}
+
+
+/*
+Block reads and writes should, for every backend:
+  - write a run which crosses a frame boundary so each word can be read back individually
+  - read back a run which crosses a frame boundary in one call
+  - read words which were never written as 0
+*/
+void test_ram_block() {
+    uint16_t words[6000], read_back[6010];
+    for (int i = 0; i < 6000; i++) {
+        words[i] = i * 7;
+    }
+
+    for (int i = 0; i < num_backends; i++) {
+        RAM* ram = init_RAM(backends[i], 1024);
+        ram_write_block(ram, 3000, words, 6000);
+
+        for (int j = 0; j < 6000; j++) {
+            assert((uint16_t)get_from_ram(ram, 3000 + j) == (uint16_t)(j * 7));
+        }
+
+        ram_read_block(ram, 2995, read_back, 6010);
+        for (int j = 0; j < 5; j++) {
+            assert(read_back[j] == 0);
+            assert(read_back[6005 + j] == 0);
+        }
+
+        for (int j = 0; j < 6000; j++) {
+            assert(read_back[j + 5] == (uint16_t)(j * 7));
+        }
+
+        free_RAM(ram);
+    }
+}
+
+
+/*
+Releasing a block of RAM should, for every backend:
+  - make every word in the block read as 0
+  - leave the words either side of the block untouched
+  - work for a block longer than the backend's capacity
+*/
+void test_ram_release() {
+    uint16_t words[10000];
+    for (int i = 0; i < 10000; i++) {
+        words[i] = i + 1;
+    }
+
+    for (int i = 0; i < num_backends; i++) {
+        RAM* ram = init_RAM(backends[i], 1024);
+        ram_write_block(ram, 1000, words, 10000);
+
+        ram_release_block(ram, 2000, 500);
+        ram_release_block(ram, 4096, 4096);
+        for (uint32_t addr = 1000; addr < 11000; addr++) {
+            if ((addr >= 2000 && addr < 2500) || (addr >= 4096 && addr < 8192))
+                assert(get_from_ram(ram, addr) == 0);
+            else
+                assert(get_from_ram(ram, addr) == (short)(addr - 1000 + 1));
+        }
+
+        RAMStats stats;
+        get_RAM_stats(ram, &stats);
+        assert(stats.entries == 10000 - 500 - 4096);
+
+        ram_release_block(ram, 0, 0x100000);
+        get_RAM_stats(ram, &stats);
+        assert(stats.entries == 0);
+        assert(get_from_ram(ram, 1000) == 0);
+
+        free_RAM(ram);
+    }
 }
@@ -4,5 +4,8 @@
 void test_ram_init();
 void test_ram_insert();
 void test_ram_update();
+void test_ram_stats();
+void test_ram_block();
+void test_ram_release();
 
 #endif
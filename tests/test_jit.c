@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "../machine.h"
+#include "../registers.h"
+#include "../os/microkernel.h"
+#include "../os/tlb.h"
+
+
+/*
+Runs a program to completion as the only process on a new machine, with the JIT or with the interpreter,
+copying out the final registers and the words of memory starting at a logical address. Gives back -1,
+having run nothing, if the JIT is wanted but is not supported on this host.
+*/
+static int run_test_program(const uint16_t* program, long len, int use_jit, uint32_t* registers, uint32_t data_addr, uint16_t* data, uint32_t data_len) {
+    Machine* machine = new_machine(init_RAM(RAM_FRAME_STORE, 1024), 1);
+    init_MMU(machine, 1024);
+    init_TLB(machine, DEFAULT_TLB_SIZE);
+    if (use_jit && enable_jit(machine) != 0) {
+        free_machine(machine);
+        return -1;
+    }
+
+    init_processes(machine);
+    Process* process = new_process_with_args(0, program, len, 0, NULL, machine);
+    assert(process != NULL);
+
+    CPU* cpu = &machine->cpus[0];
+    while (execute_process_burst(machine, cpu, process, BURST_LEN) != (uint32_t)-1);
+    assert(process->exit_status == 0);
+
+    memcpy(registers, cpu->registers, sizeof(uint32_t) * NUM_REGISTERS);
+    read_process_memory(process, data_addr, data, data_len, machine);
+    free_machine(machine);
+    return 0;
+}
+
+
+/*
+Runs a program with the interpreter and then with the JIT, checking both end with the same registers
+and the same words of memory, which are copied out of the interpreted run for the caller to check too.
+The JIT run is skipped if the JIT is not supported on this host.
+*/
+static void compare_jit_run(const uint16_t* program, long len, uint32_t* registers, uint32_t data_addr, uint16_t* data, uint32_t data_len) {
+    uint32_t jit_registers[NUM_REGISTERS];
+    uint16_t* jit_data = malloc(sizeof(uint16_t) * data_len);
+    assert(jit_data != NULL);
+
+    assert(run_test_program(program, len, 0, registers, data_addr, data, data_len) == 0);
+    if (run_test_program(program, len, 1, jit_registers, data_addr, jit_data, data_len) == 0) {
+        assert(memcmp(registers, jit_registers, sizeof(uint32_t) * NUM_REGISTERS) == 0);
+        assert(memcmp(data, jit_data, sizeof(uint16_t) * data_len) == 0);
+    }
+
+    free(jit_data);
+}
+
+
+/*
+A program filling 200 words of the heap with 3 * i in a loop, then summing them back in a second loop,
+should end the same with the JIT as with the interpreter. Each loop runs its block 200 times, so the JIT
+chains the blocks of the loop to themselves.
+*/
+void test_jit_memory_loops() {
+    const uint16_t program[] = {
+        0xC100, 0xD100, 0xC200, 0xD2C8, 0xC300, 0xD300, 0xCB00, 0xDB00, 0xC430, 0xD400, 0xC700, 0xD700,
+        0x1511, 0x1551, 0xB541, 0x3111, 0xF412, 0xC800, 0xD80C, 0xF678, // fill: store 3 * i at 0x3000 + i
+        0xC100, 0xD100,
+        0xA541, 0x1335, 0x3111, 0xF412, 0xC800, 0xD816, 0xF678, // sum: add the word at 0x3000 + i
+        0xFFFF
+    };
+    uint32_t registers[NUM_REGISTERS];
+    uint16_t data[200];
+
+    compare_jit_run(program, 30, registers, 0x3000, data, 200);
+    assert(registers[3] == 0xE934); // 3 * (0 + 1 + ... + 199)
+    for (int i = 0; i < 200; i++) {
+        assert(data[i] == 3 * i);
+    }
+}
+
+
+/*
+A program running shifts, NAND and OR on changing values in a loop, including arithmetic and logical
+shifts of negative values, storing each result and the loop count, and ending the loop with CMP and BLT,
+should end the same with the JIT as with the interpreter.
+*/
+void test_jit_shifts_and_logic() {
+    const uint16_t program[] = {
+        0xC100, 0xD101, 0xC200, 0xD200, 0xC300, 0xD328, 0xC420, 0xD400, 0xC600, 0xD603, 0xC700, 0xD700,
+        0xCB00, 0xDB00, 0x5516, 0x8A51, 0x79A6, 0x6AA6, 0x9AA9, 0xBA42, 0x3221, 0x3113, // loop
+        0xC521, 0xD500, 0xB250, 0xF423, 0xC800, 0xD80C, 0xF778,
+        0xC521, 0xD500, 0xA650, 0x4665, 0xFFFF
+    };
+    uint32_t registers[NUM_REGISTERS];
+    uint16_t data[0x101];
+
+    compare_jit_run(program, 34, registers, 0x2000, data, 0x101);
+    assert(registers[2] == 41 && data[0x100] == 41);
+    assert(registers[6] == 36); // the loop count loaded back, less 5
+}
+
+
+/*
+A program computing Fibonacci numbers into memory in a loop, then jumping over an instruction, and
+calling and returning from a subroutine through $ra, should end the same with the JIT as with the
+interpreter.
+*/
+void test_jit_jumps_and_calls() {
+    const uint16_t program[] = {
+        0xC100, 0xD100, 0xC200, 0xD201, 0xC300, 0xD300, 0xC400, 0xD418, 0xC700, 0xD700, 0xC940, 0xD900,
+        0x1512, 0x1120, 0x1250, 0xB293, 0x3331, 0xF434, 0xC800, 0xD80C, 0xF678, // fib
+        0xC800, 0xD81A, 0xF278, // jump to done
+        0xC177, 0xD177, // skipped
+        0xC800, 0xD81E, 0xF378, 0xFFFF, // done: call sub, then halt
+        0x3AA7, 0xF20E // sub: add 7 to $g9 and return
+    };
+    uint32_t registers[NUM_REGISTERS];
+    uint16_t data[24];
+
+    compare_jit_run(program, 32, registers, 0x4000, data, 24);
+    assert(registers[1] != 0x7777);
+    assert(registers[10] == 7);
+    assert(data[0] == 1 && data[1] == 2 && data[2] == 3 && data[3] == 5);
+}
@@ -0,0 +1,8 @@
+#ifndef TEST_JIT
+#define TEST_JIT
+
+void test_jit_memory_loops();
+void test_jit_shifts_and_logic();
+void test_jit_jumps_and_calls();
+
+#endif
@@ -0,0 +1,232 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "../launcher.h"
+#include "../machine.h"
+#include "../os/tlb.h"
+
+
+/*
+Writes the contents to a new temporary manifest, putting its path into `path`, which must hold at
+least 32 characters.
+*/
+static void write_manifest(char* path, const char* contents) {
+    strcpy(path, "/tmp/iridium_manifest_XXXXXX");
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+
+    FILE* manifest = fdopen(fd, "w");
+    assert(manifest != NULL);
+    fputs(contents, manifest);
+    fclose(manifest);
+}
+
+
+/*
+Writes a raw program image to a new temporary file, putting its path into `path`, which must hold at
+least 32 characters.
+*/
+static void write_program(char* path, const uint16_t* words, size_t len) {
+    strcpy(path, "/tmp/iridium_program_XXXXXX");
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+
+    FILE* program = fdopen(fd, "wb");
+    assert(program != NULL);
+    assert(fwrite(words, sizeof(uint16_t), len, program) == len);
+    fclose(program);
+}
+
+
+/*
+Reads the contents as a manifest into a new batch, checking it gives back the expected status.
+*/
+static Batch* read_test_manifest(const char* contents, int expected_status) {
+    char path[32];
+    write_manifest(path, contents);
+
+    Batch* batch = new_batch();
+    assert(read_manifest(batch, path) == expected_status);
+    unlink(path);
+
+    return batch;
+}
+
+
+/*
+Reading a manifest with comments and blank lines should:
+  - skip lines starting with #, even after whitespace or with a > in them
+  - skip lines which are empty or only whitespace
+  - add a job for every other line, in order, with its arguments
+*/
+void test_manifest_comments() {
+    Batch* batch = read_test_manifest(
+        "# a comment\n"
+        "\n"
+        "first.bin a b\n"
+        "   \t\n"
+        "  # an indented comment > out.txt\n"
+        "#no space after the hash\n"
+        "second.bin\n",
+        0);
+
+    assert(batch->num_jobs == 2);
+    assert(strcmp(batch->jobs[0].program, "first.bin") == 0);
+    assert(batch->jobs[0].argc == 2);
+    assert(strcmp(batch->jobs[0].argv[0], "a") == 0);
+    assert(strcmp(batch->jobs[0].argv[1], "b") == 0);
+    assert(batch->jobs[0].output_path == NULL);
+    assert(strcmp(batch->jobs[1].program, "second.bin") == 0);
+    assert(batch->jobs[1].argc == 0);
+    assert(batch->jobs[1].report.exit_status == JOB_NOT_LOADED);
+
+    free_batch(batch);
+}
+
+
+/*
+A > in a manifest line should:
+  - take the following token as the output file, whether or not there is a space after the >
+  - not be taken as an argument, wherever it is in the line
+  - make the whole manifest invalid if nothing follows it
+*/
+void test_manifest_output() {
+    Batch* batch = read_test_manifest(
+        "first.bin > first.txt\n"
+        "second.bin arg >second.txt\n"
+        "third.bin >third.txt arg\n",
+        0);
+
+    assert(batch->num_jobs == 3);
+    assert(strcmp(batch->jobs[0].output_path, "first.txt") == 0);
+    assert(batch->jobs[0].argc == 0);
+    assert(strcmp(batch->jobs[1].output_path, "second.txt") == 0);
+    assert(batch->jobs[1].argc == 1 && strcmp(batch->jobs[1].argv[0], "arg") == 0);
+    assert(strcmp(batch->jobs[2].output_path, "third.txt") == 0);
+    assert(batch->jobs[2].argc == 1 && strcmp(batch->jobs[2].argv[0], "arg") == 0);
+    free_batch(batch);
+
+    batch = read_test_manifest("first.bin\nsecond.bin >\n", -1);
+    free_batch(batch);
+
+    batch = read_test_manifest("first.bin > \t\n", -1);
+    free_batch(batch);
+}
+
+
+/*
+Whitespace at the end of a line, including a carriage return or no newline at the end of the file,
+should not end up in the program, its arguments or its output file.
+*/
+void test_manifest_trailing_whitespace() {
+    Batch* batch = read_test_manifest(
+        "first.bin a \t \n"
+        "second.bin > second.txt   \r\n"
+        "third.bin b\t",
+        0);
+
+    assert(batch->num_jobs == 3);
+    assert(batch->jobs[0].argc == 1 && strcmp(batch->jobs[0].argv[0], "a") == 0);
+    assert(strcmp(batch->jobs[1].program, "second.bin") == 0);
+    assert(strcmp(batch->jobs[1].output_path, "second.txt") == 0);
+    assert(strcmp(batch->jobs[2].program, "third.bin") == 0);
+    assert(batch->jobs[2].argc == 1 && strcmp(batch->jobs[2].argv[0], "b") == 0);
+
+    free_batch(batch);
+}
+
+
+/*
+An empty manifest, or one of only comments, should be read without any jobs being added, while a
+manifest which does not exist should not be read at all.
+*/
+void test_manifest_empty() {
+    Batch* batch = read_test_manifest("", 0);
+    assert(batch->num_jobs == 0);
+    free_batch(batch);
+
+    batch = read_test_manifest("# nothing to run\n\n", 0);
+    assert(batch->num_jobs == 0);
+    free_batch(batch);
+
+    batch = new_batch();
+    assert(read_manifest(batch, "/tmp/iridium_manifest_which_does_not_exist") == -1);
+    assert(batch->num_jobs == 0);
+    free_batch(batch);
+}
+
+
+/*
+Running a batch whose program files do not exist, or whose output files cannot be opened, should
+leave those jobs reported as not loaded, rather than stopping the batch.
+*/
+void test_manifest_missing_program() {
+    Batch* batch = read_test_manifest(
+        "/tmp/iridium_program_which_does_not_exist.bin\n"
+        "/tmp/iridium_program_which_does_not_exist.bin > /tmp/iridium_no_such_directory/out.txt\n",
+        0);
+    assert(batch->num_jobs == 2);
+
+    Machine* machine = new_machine(init_RAM(RAM_FRAME_STORE, 1024), 1);
+    init_MMU(machine, 1024);
+    init_TLB(machine, DEFAULT_TLB_SIZE);
+    init_processes(machine);
+
+    run_batch(batch, machine);
+    assert(batch->jobs[0].report.exit_status == JOB_NOT_LOADED);
+    assert(batch->jobs[0].report.instructions_retired == 0);
+    assert(batch->jobs[1].report.exit_status == JOB_NOT_LOADED);
+    assert(machine->num_active_processes == 0);
+
+    free_machine(machine);
+    free_batch(batch);
+}
+
+
+/*
+A job which runs an invalid instruction or syscall, or jumps to a page it does not have, should be ended
+with exit status -1 on its own, with the instructions it ran before it counted, while the jobs after it
+still run and halt normally.
+*/
+void test_manifest_faulting_job() {
+    const uint16_t invalid_instr[] = { 0x3101, 0xEFFF, 0x0000 };
+    const uint16_t invalid_syscall[] = { 0x3101, 0x3101, 0xFC00, 0x0000 };
+    // $ra is shifted up to 0x10000000, far past the end of the process, and jumped to
+    const uint16_t unmapped_jump[] = { 0x3EE1, 0x310E, 0x5EE1, 0x5EE1, 0xF20E, 0x0000 };
+    const uint16_t valid[] = { 0x3101, 0x0000 };
+    char invalid_instr_path[32], invalid_syscall_path[32], unmapped_jump_path[32], valid_path[32];
+    write_program(invalid_instr_path, invalid_instr, 3);
+    write_program(invalid_syscall_path, invalid_syscall, 4);
+    write_program(unmapped_jump_path, unmapped_jump, 6);
+    write_program(valid_path, valid, 2);
+
+    Batch* batch = new_batch();
+    add_batch_job(batch, invalid_instr_path, 0, NULL, "/dev/null");
+    add_batch_job(batch, invalid_syscall_path, 0, NULL, "/dev/null");
+    add_batch_job(batch, unmapped_jump_path, 0, NULL, "/dev/null");
+    add_batch_job(batch, valid_path, 0, NULL, "/dev/null");
+
+    Machine* machine = new_machine(init_RAM(RAM_FRAME_STORE, 1024), 1);
+    init_MMU(machine, 1024);
+    init_TLB(machine, DEFAULT_TLB_SIZE);
+    init_processes(machine);
+
+    run_batch(batch, machine);
+    assert(batch->jobs[0].report.exit_status == -1);
+    assert(batch->jobs[0].report.instructions_retired == 1);
+    assert(batch->jobs[1].report.exit_status == -1);
+    assert(batch->jobs[1].report.instructions_retired == 2);
+    assert(batch->jobs[2].report.exit_status == -1);
+    assert(batch->jobs[2].report.instructions_retired == 5);
+    assert(batch->jobs[3].report.exit_status == 0);
+    assert(batch->jobs[3].report.instructions_retired == 1);
+
+    unlink(invalid_instr_path);
+    unlink(invalid_syscall_path);
+    unlink(unmapped_jump_path);
+    unlink(valid_path);
+    free_machine(machine);
+    free_batch(batch);
+}
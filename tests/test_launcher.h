@@ -0,0 +1,11 @@
+#ifndef TEST_LAUNCHER
+#define TEST_LAUNCHER
+
+void test_manifest_comments();
+void test_manifest_output();
+void test_manifest_trailing_whitespace();
+void test_manifest_empty();
+void test_manifest_missing_program();
+void test_manifest_faulting_job();
+
+#endif
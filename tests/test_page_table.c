@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../os/page_table.h"
+
+#define FALSE 0
+#define TRUE  1
+
+
+/*
+Mapping, looking up and unmapping pages should:
+  - map every address in a page to the same entry, holding the frame and PTE_PRESENT
+  - leave the neighbouring pages unmapped
+  - give back 0 for a page after it is unmapped, without affecting other pages
+*/
+void test_page_table_map() {
+    PageTable* table = new_page_table();
+
+    map_page(table, 0x00003000, 7, 0);
+    map_page(table, 0x00404000, 0x12345, 0);
+    assert(lookup_page(table, 0x00003000) == (PTE_PRESENT | 7));
+    assert(lookup_page(table, 0x00003FFF) == (PTE_PRESENT | 7));
+    assert(lookup_page(table, 0x00404ABC) == (PTE_PRESENT | 0x12345));
+    assert(lookup_page(table, 0x00002FFF) == 0);
+    assert(lookup_page(table, 0x00004000) == 0);
+
+    // mapping a page again replaces its frame
+    map_page(table, 0x00003000, 8, 0);
+    assert(lookup_page(table, 0x00003000) == (PTE_PRESENT | 8));
+
+    unmap_page(table, 0x00003123);
+    assert(lookup_page(table, 0x00003000) == 0);
+    assert(lookup_page(table, 0x00404000) == (PTE_PRESENT | 0x12345));
+
+    free_page_table(table);
+}
+
+
+/*
+Looking up an address which was never mapped should:
+  - give back 0, whether or not the table of entries for its range exists
+  - not allocate a table of entries, unless an entry is asked for with create set
+  - leave unmapping it as doing nothing
+*/
+void test_page_table_unmapped() {
+    PageTable* table = new_page_table();
+
+    assert(lookup_page(table, 0x00000000) == 0);
+    assert(lookup_page(table, 0xFFFFF000) == 0);
+    assert(get_page_table_entry(table, 0x00400000, FALSE) == NULL);
+    unmap_page(table, 0x00400000);
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        assert(table->directory[i] == NULL);
+    }
+
+    PageTableEntry* entry = get_page_table_entry(table, 0x00400000, TRUE);
+    assert(entry != NULL && *entry == 0);
+    assert(table->directory[1] != NULL);
+    assert(get_page_table_entry(table, 0x00400FFF, FALSE) == entry);
+    assert(lookup_page(table, 0x00400000) == 0);
+    assert(lookup_page(table, 0x00401000) == 0);
+
+    free_page_table(table);
+}
+
+
+/*
+The flags an entry is mapped with should be kept alongside PTE_PRESENT and the frame, and not spill
+into or out of the frame bits.
+*/
+void test_page_table_flags() {
+    PageTable* table = new_page_table();
+
+    map_page(table, 0x00010000, PTE_FRAME_MASK, PTE_READ_ONLY);
+    map_page(table, 0x00011000, 3, PTE_LARGE);
+    map_page(table, 0x00012000, 4, PTE_READ_ONLY | PTE_LARGE);
+
+    PageTableEntry entry = lookup_page(table, 0x00010000);
+    assert(entry & PTE_PRESENT && entry & PTE_READ_ONLY);
+    assert(!(entry & (PTE_LARGE | PTE_SWAPPED)));
+    assert((entry & PTE_FRAME_MASK) == PTE_FRAME_MASK);
+
+    entry = lookup_page(table, 0x00011000);
+    assert(entry == (PTE_PRESENT | PTE_LARGE | 3));
+    entry = lookup_page(table, 0x00012000);
+    assert(entry == (PTE_PRESENT | PTE_READ_ONLY | PTE_LARGE | 4));
+
+    // a frame too large for the entry is cut down to its bits rather than setting flags
+    map_page(table, 0x00013000, 0xFFF00005, 0);
+    assert(lookup_page(table, 0x00013000) == (PTE_PRESENT | 5));
+
+    // entries written through a pointer, as for swapped pages, keep their flags too
+    *get_page_table_entry(table, 0x00014000, TRUE) = PTE_SWAPPED | 9;
+    entry = lookup_page(table, 0x00014000);
+    assert(entry == (PTE_SWAPPED | 9) && !(entry & PTE_PRESENT));
+
+    // clearing a flag in place leaves the rest of the entry alone
+    *get_page_table_entry(table, 0x00012000, FALSE) &= ~PTE_READ_ONLY;
+    assert(lookup_page(table, 0x00012000) == (PTE_PRESENT | PTE_LARGE | 4));
+
+    free_page_table(table);
+}
+
+
+/*
+A page table with mappings across the whole address space should:
+  - allocate a table of entries for each range of the directory with a page mapped in it, and no others
+  - keep that table once its pages are unmapped, with all of its entries cleared, so that freeing the page 
+    table is what frees it
+  - miss on a fresh lookup of every page once it is unmapped
+
+Whether freeing the table releases its tables of entries is left to ASan or valgrind to check.
+*/
+void test_page_table_free() {
+    PageTable* table = new_page_table();
+    for (uint32_t i = 0; i < 256; i++) {
+        map_page(table, i << 24, i, 0);
+    }
+
+    map_page(table, 0xFFFFF000, 1, 0);
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        assert((table->directory[i] != NULL) == (i % 4 == 0 || i == PAGE_DIRECTORY_SIZE - 1));
+    }
+
+    for (uint32_t i = 0; i < 256; i++) {
+        unmap_page(table, i << 24);
+    }
+
+    unmap_page(table, 0xFFFFF000);
+    for (int i = 0; i < PAGE_DIRECTORY_SIZE; i++) {
+        if (table->directory[i] == NULL)
+            continue;
+
+        for (int j = 0; j < PAGE_TABLE_SIZE; j++) {
+            assert(table->directory[i][j] == 0);
+        }
+    }
+
+    assert(table->directory[PAGE_DIRECTORY_SIZE - 1] != NULL);
+    for (uint32_t i = 0; i < 256; i++) {
+        assert(lookup_page(table, i << 24) == 0);
+    }
+
+    assert(lookup_page(table, 0xFFFFF000) == 0);
+    free_page_table(table);
+}
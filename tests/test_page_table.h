@@ -0,0 +1,9 @@
+#ifndef TEST_PAGE_TABLE
+#define TEST_PAGE_TABLE
+
+void test_page_table_map();
+void test_page_table_unmapped();
+void test_page_table_flags();
+void test_page_table_free();
+
+#endif
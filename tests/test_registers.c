@@ -8,12 +8,9 @@ Test the following situations:
   - All registers should be 0 at initialisation
 */
 void test_registers_init() {
-    Register* registers = init_registers();
+    uint32_t* registers = init_registers();
     for (int i = 0; i < 16; i++) {
-        if (i < 12)
-            assert(registers[i].word_16 == 0);
-        else
-            assert(registers[i].word_32 == 0);
+        assert(registers[i] == 0);
     }
 
     free(registers);
@@ -32,7 +29,7 @@ Test the following situations:
   - 32-bit registers should do all of the above
 */
 void test_registers_update() {
-    Register* registers = init_registers();
+    uint32_t* registers = init_registers();
 
     // Check constant 0 cannot be updated
     Register new_val;
@@ -111,7 +108,7 @@ Test the following situations:
   - 32-bit registers shall return the set value
 */
 void test_registers_get() {
-    Register* registers = init_registers();
+    uint32_t* registers = init_registers();
     Register new_val;
 
     // Check $zero always returns constant 0
@@ -130,3 +127,42 @@ void test_registers_get() {
 
     free(registers);
 }
+
+
+/*
+Test the following situations:
+  - writes to $zero through the accessors are dropped
+  - writes to 16-bit registers keep only the lower 16 bits, so the registers are read back zero extended
+  - writes to 32-bit registers keep all 32 bits
+  - writing the lower 16 bits of a 32-bit register keeps its upper 16 bits
+*/
+void test_registers_accessors() {
+    uint32_t* registers = init_registers();
+
+    // Check $zero cannot be written
+    write_register(registers, 0, 0x12345678);
+    write_register_lower(registers, 0, 0x5678);
+    assert(read_register(registers, 0) == 0);
+
+    // Check 16-bit registers are masked
+    write_register(registers, 1, 0xFEDCBA98);
+    assert(read_register(registers, 1) == 0xBA98);
+    assert(read_register_16(registers, 1) == 0xBA98);
+
+    write_register_lower(registers, 11, 0x1234);
+    assert(read_register(registers, 11) == 0x1234);
+
+    // Check 32-bit registers keep every bit
+    write_register(registers, 13, 0xFEDCBA98);
+    assert(read_register(registers, 13) == 0xFEDCBA98);
+    assert(read_register_16(registers, 13) == 0xBA98);
+
+    write_register_32(registers, 15, 0x00010002);
+    assert(get_register(15, registers).word_32 == 0x00010002);
+
+    // Check writing the lower 16 bits keeps the upper 16 bits
+    write_register_lower(registers, 13, 0x1234);
+    assert(read_register(registers, 13) == 0xFEDC1234);
+
+    free(registers);
+}
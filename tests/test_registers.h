@@ -4,5 +4,6 @@
 void test_registers_init();
 void test_registers_update();
 void test_registers_get();
+void test_registers_accessors();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../os/tlb.h"
+
+
+/*
+A new TLB should round its size up to a power of 2 and miss on every address, and once an address is
+filled it should:
+  - hit on every address in the same page, keeping the offset into the page
+  - count the hits and misses
+  - miss on a write to a page filled as read-only, but not on a read
+*/
+void test_tlb_fill() {
+    TLB* tlb = new_TLB(50);
+    uint32_t physical_addr = 0;
+    assert(tlb->mask == 63);
+    assert(tlb->process_id == -1);
+
+    assert(!lookup_TLB(tlb, 0x00005123, &physical_addr));
+    assert(tlb->misses == 1 && tlb->hits == 0);
+
+    fill_TLB(tlb, 0x00005123, 0x00ABC456, 1);
+    assert(lookup_TLB(tlb, 0x00005123, &physical_addr));
+    assert(physical_addr == 0x00ABC123);
+    assert(lookup_TLB_write(tlb, 0x00005FFF, &physical_addr));
+    assert(physical_addr == 0x00ABCFFF);
+    assert(tlb->hits == 2 && tlb->misses == 1);
+
+    assert(!lookup_TLB(tlb, 0x00006000, &physical_addr));
+
+    fill_TLB(tlb, 0x00007000, 0x00123000, 0);
+    assert(lookup_TLB(tlb, 0x00007004, &physical_addr));
+    assert(physical_addr == 0x00123004);
+    assert(!lookup_TLB_write(tlb, 0x00007004, &physical_addr));
+
+    free_TLB(tlb);
+}
+
+
+/*
+Filling a page whose entry holds another page, as the TLB is direct-mapped, should evict that page and
+leave every other entry alone.
+*/
+void test_tlb_conflict() {
+    TLB* tlb = new_TLB(64);
+    uint32_t physical_addr = 0;
+
+    fill_TLB(tlb, 0x00001000, 0x00010000, 1);
+    fill_TLB(tlb, 0x00002000, 0x00020000, 1);
+
+    // page 0x41 has the same low bits as page 0x01
+    fill_TLB(tlb, 0x00041000, 0x00030000, 1);
+    assert(lookup_TLB(tlb, 0x00041008, &physical_addr));
+    assert(physical_addr == 0x00030008);
+    assert(!lookup_TLB(tlb, 0x00001008, &physical_addr));
+    assert(lookup_TLB(tlb, 0x00002008, &physical_addr));
+    assert(physical_addr == 0x00020008);
+
+    free_TLB(tlb);
+}
+
+
+/*
+Invalidating a single page should:
+  - make that page miss, and the large page holding it
+  - leave the other entries alone
+  - do nothing to an entry holding another page
+  - bump the generation, so copies of translations can tell they may be stale
+*/
+void test_tlb_invalidate() {
+    TLB* tlb = new_TLB(64);
+    uint32_t physical_addr = 0;
+
+    fill_TLB(tlb, 0x00001000, 0x00010000, 1);
+    fill_TLB(tlb, 0x00002000, 0x00020000, 1);
+    unsigned long generation = tlb->generation;
+
+    invalidate_TLB_page(tlb, 0x00001ABC);
+    assert(tlb->generation > generation);
+    assert(!lookup_TLB(tlb, 0x00001000, &physical_addr));
+    assert(lookup_TLB(tlb, 0x00002000, &physical_addr));
+
+    // page 0x42 shares an entry with page 0x02, which must stay cached
+    invalidate_TLB_page(tlb, 0x00042000);
+    assert(lookup_TLB(tlb, 0x00002000, &physical_addr));
+    assert(physical_addr == 0x00020000);
+
+    fill_large_TLB(tlb, 0x00030000, 0x00100000, 1);
+    invalidate_TLB_page(tlb, 0x00035000);
+    assert(!lookup_TLB(tlb, 0x00030000, &physical_addr));
+    assert(lookup_TLB(tlb, 0x00002000, &physical_addr));
+
+    free_TLB(tlb);
+}
+
+
+/*
+Flushing the TLB should make every ordinary and large entry miss, mark it as holding no process, and
+count the flush and bump the generation.
+*/
+void test_tlb_flush() {
+    TLB* tlb = new_TLB(64);
+    uint32_t physical_addr = 0;
+    unsigned long flushes = tlb->flushes;
+    unsigned long generation = tlb->generation;
+
+    tlb->process_id = 3;
+    for (uint32_t page = 0; page < 64; page++) {
+        fill_TLB(tlb, page << 12, page << 12, 1);
+    }
+
+    fill_large_TLB(tlb, 0x00100000, 0x00200000, 1);
+
+    flush_TLB(tlb);
+    assert(tlb->flushes == flushes + 1);
+    assert(tlb->generation > generation);
+    assert(tlb->process_id == -1);
+    for (uint32_t page = 0; page < 64; page++) {
+        assert(!lookup_TLB(tlb, page << 12, &physical_addr));
+    }
+
+    assert(!lookup_TLB(tlb, 0x00100000, &physical_addr));
+
+    free_TLB(tlb);
+}
+
+
+/*
+A large page entry should:
+  - translate all 16 of the pages in it, counting them as large hits
+  - keep the offset into the large page, not just into the page
+  - miss on a write if it is read-only
+  - miss on the pages either side of it
+*/
+void test_tlb_large_page() {
+    TLB* tlb = new_TLB(64);
+    uint32_t physical_addr = 0;
+
+    fill_large_TLB(tlb, 0x00050000, 0x00A51234, 1);
+    for (uint32_t page = 0; page < 16; page++) {
+        uint32_t offset = (page << 12) | 0x0ABC;
+        assert(lookup_TLB(tlb, 0x00050000 | offset, &physical_addr));
+        assert(physical_addr == (0x00A50000 | offset));
+        assert(lookup_TLB_write(tlb, 0x00050000 | offset, &physical_addr));
+    }
+
+    assert(tlb->large_hits == 32 && tlb->hits == 32);
+    assert(!lookup_TLB(tlb, 0x0004FFFF, &physical_addr));
+    assert(!lookup_TLB(tlb, 0x00060000, &physical_addr));
+
+    // an ordinary entry for a page in the large page is checked first
+    fill_TLB(tlb, 0x00053000, 0x00777000, 1);
+    assert(lookup_TLB(tlb, 0x00053010, &physical_addr));
+    assert(physical_addr == 0x00777010);
+
+    fill_large_TLB(tlb, 0x00080000, 0x00300000, 0);
+    assert(lookup_TLB(tlb, 0x0008F000, &physical_addr));
+    assert(!lookup_TLB_write(tlb, 0x0008F000, &physical_addr));
+
+    free_TLB(tlb);
+}
@@ -0,0 +1,10 @@
+#ifndef TEST_TLB
+#define TEST_TLB
+
+void test_tlb_fill();
+void test_tlb_conflict();
+void test_tlb_invalidate();
+void test_tlb_flush();
+void test_tlb_large_page();
+
+#endif
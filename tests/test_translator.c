@@ -0,0 +1,167 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "../machine.h"
+#include "../translator.h"
+#include "../os/microkernel.h"
+
+
+/*
+Writes the words of a block into the first page of RAM at an offset, and translates the block starting
+there into the decoded instructions of that page.
+*/
+static void translate_test_block(Machine* machine, DecodedInstr* instrs, uint32_t offset, const uint16_t* words, uint32_t len) {
+    ram_write_block(machine->ram, offset, words, len);
+    translate_block(machine, &machine->cpus[0], instrs, 0, offset);
+}
+
+
+/*
+Creates a machine with one CPU, and the decoded instructions of a page for blocks to be translated into.
+*/
+static DecodedInstr* new_translator_test(Machine** machine) {
+    *machine = new_machine(init_RAM(RAM_FRAME_STORE, 1024), 1);
+    DecodedInstr* instrs = calloc(PAGE_SIZE, sizeof(DecodedInstr));
+    assert(instrs != NULL);
+    return instrs;
+}
+
+
+/*
+A MOVUI and MOVLI into the same register should be fused into an LI16 which:
+  - loads the whole 16-bit immediate, and runs as 2 instructions
+  - leaves the MOVLI decoded as it was, for jumps landing on it
+  - chains to the instruction after the pair, but not to a halt
+and the block should be counted along with the instructions in it.
+*/
+void test_translator_li16() {
+    Machine* machine;
+    DecodedInstr* instrs = new_translator_test(&machine);
+    FusionStats* stats = machine->cpus[0].fusion_stats;
+
+    // MOVUI $g0, 0x12; MOVLI $g0, 0x34; ADD $g0, $g1, $g2; HALT
+    const uint16_t block[] = { 0xC112, 0xD134, 0x1123, 0x0000 };
+    translate_test_block(machine, instrs, 0, block, 4);
+
+    assert(instrs[0].opcode == OP_LI16);
+    assert(instrs[0].reg_1 == 1 && instrs[0].immediate == 0x1234);
+    assert(instrs[0].length == 2 && instrs[0].handler != NULL);
+    assert(instrs[0].chains == 1);
+    assert(instrs[1].opcode == OP_MOVLI && instrs[1].length == 1);
+    assert(instrs[2].opcode == OP_ADD && instrs[2].chains == 0);
+    assert(instrs[3].halts == HALT_EXIT);
+
+    assert(stats->fused[FUSION_LI16] == 1);
+    assert(stats->blocks == 1 && stats->block_instrs == 4);
+
+    free(instrs);
+    free_machine(machine);
+}
+
+
+/*
+A CMP followed by each of BEQ, BNE, BLT and BGT should be fused into the compare-and-branch of that
+branch, which keeps the registers of both, runs as 2 instructions and ends the block.
+*/
+void test_translator_cmp_branch() {
+    Machine* machine;
+    DecodedInstr* instrs = new_translator_test(&machine);
+    FusionStats* stats = machine->cpus[0].fusion_stats;
+
+    for (int branch = 0; branch < 4; branch++) {
+        // CMP $g0, $g1; Bxx $g2, $g3
+        uint32_t offset = branch * 16;
+        const uint16_t block[] = { 0xF412, 0xF534 + (branch << 8), 0x1123 };
+        translate_test_block(machine, instrs, offset, block, 3);
+
+        DecodedInstr* fused = &instrs[offset];
+        assert(fused->opcode == OP_CMP_BEQ + branch);
+        assert(fused->reg_2 == 1 && fused->reg_3 == 2);
+        assert(fused->reg_4 == 3 && fused->reg_5 == 4);
+        assert(fused->length == 2 && fused->chains == 0);
+        assert(instrs[offset + 1].opcode == OP_BEQ + branch);
+    }
+
+    assert(stats->fused[FUSION_CMP_BRANCH] == 4);
+    assert(stats->blocks == 4 && stats->block_instrs == 8);
+
+    free(instrs);
+    free_machine(machine);
+}
+
+
+/*
+A MOVUI and MOVLI into $ua followed by a LOAD or STORE should be fused into an absolute access which:
+  - takes the registers of the access and the address from the pair, and runs as 3 instructions
+  - chains to the instruction after it if it is a load, but not if it is a store, as the store may
+    overwrite the rest of the block
+*/
+void test_translator_absolute_access() {
+    Machine* machine;
+    DecodedInstr* instrs = new_translator_test(&machine);
+    FusionStats* stats = machine->cpus[0].fusion_stats;
+
+    // LI $ua, 0x5678; LOAD $g1, $g2, $g3; LI $ua, 0x9ABC; STORE $g4, $g5, $g6; ADD $g0, $g1, $g2; HALT
+    const uint16_t block[] = { 0xCB56, 0xDB78, 0xA234, 0xCB9A, 0xDBBC, 0xB567, 0x1123, 0x0000 };
+    translate_test_block(machine, instrs, 0, block, 8);
+
+    assert(instrs[0].opcode == OP_ABS_LOAD);
+    assert(instrs[0].reg_1 == 2 && instrs[0].reg_2 == 3 && instrs[0].reg_3 == 4);
+    assert(instrs[0].immediate == 0x5678 && instrs[0].length == 3);
+    assert(instrs[0].chains == 1);
+
+    assert(instrs[3].opcode == OP_ABS_STORE);
+    assert(instrs[3].reg_1 == 5 && instrs[3].reg_2 == 6 && instrs[3].reg_3 == 7);
+    assert(instrs[3].immediate == 0x9ABC && instrs[3].length == 3);
+    assert(instrs[3].chains == 0);
+
+    assert(instrs[2].opcode == OP_LOAD && instrs[5].opcode == OP_STORE);
+    assert(stats->fused[FUSION_ABS_LOAD] == 1 && stats->fused[FUSION_ABS_STORE] == 1);
+    assert(stats->fused[FUSION_LI16] == 0);
+
+    free(instrs);
+    free_machine(machine);
+}
+
+
+/*
+Runs of instructions which do not match a pattern should be left decoded as they are, each running as
+1 instruction, including:
+  - a MOVUI and MOVLI into different registers, or a MOVUI into the PC
+  - a CMP followed by anything but a branch, or as the last instruction of the page
+  - a MOVUI and MOVLI into $ua followed by anything but a LOAD or STORE, which is only an LI16
+*/
+void test_translator_no_fusion() {
+    Machine* machine;
+    DecodedInstr* instrs = new_translator_test(&machine);
+    FusionStats* stats = machine->cpus[0].fusion_stats;
+
+    // MOVUI $g0, 0x12; MOVLI $g1, 0x34; CMP $g0, $g1; ADD $g0, $g1, $g2; MOVUI $pc, 0x00
+    const uint16_t unfused[] = { 0xC112, 0xD234, 0xF412, 0x1123, 0xCF00, 0xDF00 };
+    translate_test_block(machine, instrs, 0, unfused, 6);
+
+    assert(instrs[0].opcode == OP_MOVUI && instrs[0].length == 1 && instrs[0].chains == 1);
+    assert(instrs[1].opcode == OP_MOVLI && instrs[1].length == 1);
+    assert(instrs[2].opcode == OP_CMP && instrs[2].length == 1);
+    assert(instrs[3].opcode == OP_ADD);
+    assert(instrs[4].opcode == OP_MOVUI && instrs[4].chains == 0);
+    assert(stats->block_instrs == 5);
+
+    // CMP $g0, $g1 as the last instruction of the page, so the block cannot run into a branch
+    const uint16_t last[] = { 0xF412 };
+    translate_test_block(machine, instrs, PAGE_SIZE - 1, last, 1);
+    assert(instrs[PAGE_SIZE - 1].opcode == OP_CMP && instrs[PAGE_SIZE - 1].chains == 0);
+
+    // LI $ua, 0x5678; ADD $g0, $g1, $g2; HALT
+    const uint16_t no_access[] = { 0xCB56, 0xDB78, 0x1123, 0x0000 };
+    translate_test_block(machine, instrs, 16, no_access, 4);
+    assert(instrs[16].opcode == OP_LI16 && instrs[16].reg_1 == 11);
+
+    for (int kind = 0; kind < NUM_FUSION_KINDS; kind++) {
+        assert(stats->fused[kind] == (kind == FUSION_LI16));
+    }
+
+    free(instrs);
+    free_machine(machine);
+}
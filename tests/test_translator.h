@@ -0,0 +1,9 @@
+#ifndef TEST_TRANSLATOR
+#define TEST_TRANSLATOR
+
+void test_translator_li16();
+void test_translator_cmp_branch();
+void test_translator_absolute_access();
+void test_translator_no_fusion();
+
+#endif
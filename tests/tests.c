@@ -2,6 +2,14 @@
 #include "test_registers.h"
 #include "test_internal_memory.h"
 #include "test_ALU.h"
+#include "test_frame_allocator.h"
+#include "test_executable.h"
+#include "test_page_table.h"
+#include "test_tlb.h"
+#include "test_launcher.h"
+#include "test_heap.h"
+#include "test_translator.h"
+#include "test_jit.h"
 
 
 int main() {
@@ -9,17 +17,78 @@ int main() {
     test_registers_init();
     test_registers_update();
     test_registers_get();
+    test_registers_accessors();
     printf("Registers OK!\n");
 
     // testing the RAM
     test_ram_init();
     test_ram_insert();
     test_ram_update();
+    test_ram_stats();
+    test_ram_block();
+    test_ram_release();
     printf("INTERNAL MEMORY OK!\n");
 
     test_ALU();
     printf("ALU OK!\n");
 
+    // testing the frame allocator
+    test_frame_allocator_single();
+    test_frame_allocator_bulk();
+    test_frame_allocator_aligned();
+    test_frame_allocator_double_free();
+    test_frame_allocator_exhaustion();
+    printf("FRAME ALLOCATOR OK!\n");
+
+    // testing executable headers and section scanning
+    test_executable_header();
+    test_executable_bad_header();
+    test_executable_raw_image();
+    test_executable_split_scan();
+    printf("EXECUTABLE OK!\n");
+
+    // testing page tables
+    test_page_table_map();
+    test_page_table_unmapped();
+    test_page_table_flags();
+    test_page_table_free();
+    printf("PAGE TABLE OK!\n");
+
+    // testing the TLB
+    test_tlb_fill();
+    test_tlb_conflict();
+    test_tlb_invalidate();
+    test_tlb_flush();
+    test_tlb_large_page();
+    printf("TLB OK!\n");
+
+    // testing batch manifests
+    test_manifest_comments();
+    test_manifest_output();
+    test_manifest_trailing_whitespace();
+    test_manifest_empty();
+    test_manifest_missing_program();
+    test_manifest_faulting_job();
+    printf("MANIFEST OK!\n");
+
+    // testing heap allocation
+    test_heap_allocate();
+    test_heap_allocate_after_sbrk();
+    printf("HEAP OK!\n");
+
+    // testing block translation and fusion
+    test_translator_li16();
+    test_translator_cmp_branch();
+    test_translator_absolute_access();
+    test_translator_no_fusion();
+    printf("TRANSLATOR OK!\n");
+
+    // testing the JIT against the interpreter
+    test_jit_memory_loops();
+    test_jit_shifts_and_logic();
+    test_jit_jumps_and_calls();
+    printf("JIT OK!\n");
+
     printf("\nALL TESTS PASSED!\n");
     
     return 0;
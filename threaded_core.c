@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "threaded_core.h"
+#include "ALU.h"
+#include "control_unit.h"
+#include "decode_cache.h"
+#include "translator.h"
+#include "os/interrupt_handler.h"
+
+
+// Reads and writes the registers held in the locals of the burst, which are masked like the registers
+#define LOCAL_REG_VAL(index) read_register(regs, index)
+#define SET_LOCAL_REG(index, value) write_register(regs, index, value)
+
+// the same as BRANCH_TARGET in the control unit
+#define BRANCH_TARGET(upper_reg, lower_reg) (LOCAL_REG_VAL(lower_reg) - (lower_reg < 12))
+
+
+/*
+Adds in the same way as addition, on the registers and last flag-setting operation held in the 
+locals of the burst.
+*/
+static inline void local_addition(uint32_t* regs, struct ALU_last_op* last_op, short operand_a, short operand_b, unsigned int output_reg) {
+    write_register_lower(regs, output_reg, operand_a + operand_b);
+    last_op->operand_a = operand_a;
+    last_op->operand_b = operand_b;
+}
+
+
+static inline void local_subtraction(uint32_t* regs, struct ALU_last_op* last_op, short operand_a, short operand_b, unsigned int output_reg) {
+    operand_b = (~operand_b) + 1;
+    local_addition(regs, last_op, operand_a, operand_b, output_reg);
+}
+
+
+/*
+Copies the registers into the locals of a burst.
+*/
+static void load_local_registers(uint32_t* regs, uint32_t* registers) {
+    memcpy(regs, registers, NUM_REGISTERS * sizeof(uint32_t));
+}
+
+
+/*
+Copies the registers held in the locals of a burst back into the registers.
+*/
+static void store_local_registers(uint32_t* regs, uint32_t* registers) {
+    memcpy(registers, regs, NUM_REGISTERS * sizeof(uint32_t));
+}
+
+
+/**
+ * @brief Runs a process for a burst with a directly threaded interpreter. Each decoded instruction holds 
+ * the address of the label for its operation, so every instruction ends in a single indirect jump to 
+ * the next one, and the PC, registers and flags are kept in locals for the whole burst, only going back 
+ * into the registers around syscalls and when the burst ends.
+ * 
+ * The interpreter behaves exactly like the handlers in the control unit, including for operations that 
+ * go through the ALU.
+ * 
+ * @param machine The machine whose CPU holds the registers of the process
+ * @param process The process being executed
+ * @param burst_len The number of instructions to execute
+ * @param instrs_executed Set to the number of instructions executed
+ * @return How the process halted, HALT_EXIT or HALT_FAULT, or 0 if the burst ended
+ */
+int run_threaded_burst(Machine* machine, Process* process, uint32_t burst_len, uint32_t* instrs_executed) {
+#ifdef __GNUC__
+    static const void* labels[NUM_OPCODES] = {
+        [OP_NOP] = &&op_nop, [OP_ADDC] = &&op_addc, [OP_SUBC] = &&op_subc, [OP_JUMP] = &&op_jump, 
+        [OP_JAL] = &&op_jal, [OP_CMP] = &&op_cmp, [OP_BEQ] = &&op_beq, [OP_BNE] = &&op_bne, 
+        [OP_BLT] = &&op_blt, [OP_BGT] = &&op_bgt, [OP_SYSCALL] = &&op_syscall, [OP_ATOM] = &&op_atom, 
+        [OP_ADD] = &&op_add, [OP_SUB] = &&op_sub, [OP_ADDI] = &&op_addi, [OP_SUBI] = &&op_subi, 
+        [OP_SLL] = &&op_sll, [OP_SRL] = &&op_srl, [OP_SRA] = &&op_sra, [OP_NAND] = &&op_nand, 
+        [OP_OR] = &&op_or, [OP_LOAD] = &&op_load, [OP_STORE] = &&op_store, [OP_MOVUI] = &&op_movui, 
+        [OP_MOVLI] = &&op_movli, [OP_INVALID] = &&op_invalid, [OP_LI16] = &&op_li16, 
+        [OP_CMP_BEQ] = &&op_cmp_beq, [OP_CMP_BNE] = &&op_cmp_bne, [OP_CMP_BLT] = &&op_cmp_blt, 
+        [OP_CMP_BGT] = &&op_cmp_bgt, [OP_ABS_LOAD] = &&op_abs_load, [OP_ABS_STORE] = &&op_abs_store,
+    };
+
+    // called by init_threaded_core to get the labels
+    if (process == NULL) {
+        threaded_targets = labels;
+        return 0;
+    }
+
+    CPU* cpu = process->cpu;
+    FusionStats* fusion_stats = cpu->fusion_stats;
+    uint32_t regs[NUM_REGISTERS];
+    struct ALU_last_op last_op = cpu->last_op;
+    load_local_registers(regs, cpu->registers);
+
+    FetchWindow window = { TLB_INVALID_PAGE, 0, 0 };
+    uint32_t executed = 0;
+    int halted = 0;
+    const DecodedInstr* instr;
+    int operand_1, operand_2, immediate;
+    uint32_t address;
+
+    // fetch the instruction at the PC and jump to its label
+    #define DISPATCH() do { \
+            instr = fetch_instruction(process, cpu, regs[15], &window, machine); \
+            if (instr->halts) { \
+                halted = instr->halts; \
+                goto burst_end; \
+            } \
+            goto *instr->target; \
+        } while (0)
+
+    /*
+    step past the instruction just executed, ending the burst once it has run its length, and go straight
+    to the next instruction of its block if it chains, unless a translation has changed since the block 
+    was fetched
+    */
+    #define NEXT() do { \
+            regs[15]++; \
+            executed += instr->length; \
+            if (executed > burst_len && cpu->periodic_interrupts_enabled == 1) \
+                goto burst_end; \
+            if (instr->chains && window.generation == cpu->tlb->generation) { \
+                instr += instr->length; \
+                goto *instr->target; \
+            } \
+            DISPATCH(); \
+        } while (0)
+
+    DISPATCH();
+
+    op_nop:
+        NEXT();
+
+    op_addc:
+        local_addition(regs, &last_op, LOCAL_REG_VAL(instr->reg_2), last_op_carry(&last_op), instr->reg_3);
+        NEXT();
+
+    op_subc:
+        local_subtraction(regs, &last_op, LOCAL_REG_VAL(instr->reg_2), last_op_carry(&last_op), instr->reg_3);
+        NEXT();
+
+    op_jump:
+        regs[15] = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        NEXT();
+
+    op_jal:
+        address = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        regs[14] = regs[15];
+        regs[15] = address;
+        NEXT();
+
+    op_cmp:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_2, operand_1, 0); // output to $zero
+        NEXT();
+
+    op_beq:
+        if (last_op_zero(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        NEXT();
+
+    op_bne:
+        if (!last_op_zero(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        NEXT();
+
+    op_blt:
+        if (!last_op_negative(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        NEXT();
+
+    op_bgt:
+        if (last_op_negative(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_2, instr->reg_3);
+        NEXT();
+
+    op_syscall:
+        // syscalls work on the registers and flags themselves
+        store_local_registers(regs, cpu->registers);
+        cpu->last_op = last_op;
+        handle_interrupt_code(instr->immediate, machine, process);
+        load_local_registers(regs, cpu->registers);
+        last_op = cpu->last_op;
+        NEXT();
+
+    op_atom:
+        toggle_atomic_section(machine, cpu);
+        NEXT();
+
+    op_add:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_addition(regs, &last_op, operand_1, operand_2, instr->reg_1);
+        NEXT();
+
+    op_sub:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_1, operand_2, instr->reg_1);
+        NEXT();
+
+    op_addi:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        local_addition(regs, &last_op, operand_1, instr->immediate, instr->reg_1);
+        NEXT();
+
+    op_subi:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        local_subtraction(regs, &last_op, operand_1, instr->immediate, instr->reg_1);
+        NEXT();
+
+    op_sll:
+        operand_1 = (short)(LOCAL_REG_VAL(instr->reg_2));
+        operand_2 = (short)(LOCAL_REG_VAL(instr->reg_3));
+        SET_LOCAL_REG(instr->reg_1, operand_1 << operand_2);
+        NEXT();
+
+    op_srl:
+        operand_1 = (unsigned short)(LOCAL_REG_VAL(instr->reg_2));
+        operand_2 = (short)(LOCAL_REG_VAL(instr->reg_3));
+        SET_LOCAL_REG(instr->reg_1, operand_1 >> operand_2);
+        NEXT();
+
+    op_sra:
+        operand_1 = (short)(LOCAL_REG_VAL(instr->reg_2));
+        operand_2 = (short)(LOCAL_REG_VAL(instr->reg_3));
+        SET_LOCAL_REG(instr->reg_1, operand_1 >> operand_2);
+        NEXT();
+
+    op_nand:
+        operand_1 = (short)(LOCAL_REG_VAL(instr->reg_2));
+        operand_2 = (short)(LOCAL_REG_VAL(instr->reg_3));
+        SET_LOCAL_REG(instr->reg_1, ~(operand_1 & operand_2));
+        NEXT();
+
+    op_or:
+        operand_1 = (short)(LOCAL_REG_VAL(instr->reg_2));
+        operand_2 = (short)(LOCAL_REG_VAL(instr->reg_3));
+        SET_LOCAL_REG(instr->reg_1, operand_1 | operand_2);
+        NEXT();
+
+    op_load:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        address = translate_address(process, (regs[11] << 16) + (operand_1 + operand_2), machine);
+        immediate = address == NO_PHYSICAL_ADDR ? 0 : get_from_ram(machine->ram, address);
+        SET_LOCAL_REG(instr->reg_1, immediate);
+        NEXT();
+
+    op_store:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        immediate = regs[instr->reg_1] & 0x0000FFFF;
+        address = translate_write_address(process, (regs[11] << 16) + (operand_1 + operand_2), machine);
+        if (address != NO_PHYSICAL_ADDR) {
+            add_to_ram(machine->ram, address, immediate);
+            invalidate_decoded_frame(machine, cpu, address >> PAGE_OFFSET_BITS);
+        }
+        NEXT();
+
+    op_movui:
+        immediate = LOCAL_REG_VAL(instr->reg_1);
+        immediate &= 0xFFFF00FF;
+        immediate |= instr->immediate;
+        SET_LOCAL_REG(instr->reg_1, immediate);
+        NEXT();
+
+    op_movli:
+        immediate = LOCAL_REG_VAL(instr->reg_1);
+        immediate &= 0xFFFFFF00;
+        immediate |= instr->immediate;
+        SET_LOCAL_REG(instr->reg_1, immediate);
+        NEXT();
+
+    op_invalid: // never fetched, as invalid instructions are decoded as faulting
+        halted = HALT_FAULT;
+        goto burst_end;
+
+    op_li16:
+        immediate = LOCAL_REG_VAL(instr->reg_1);
+        immediate &= 0xFFFF0000;
+        immediate |= instr->immediate;
+        SET_LOCAL_REG(instr->reg_1, immediate);
+        regs[15]++;
+        fusion_stats->executed[FUSION_LI16]++;
+        NEXT();
+
+    op_cmp_beq:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_2, operand_1, 0);
+        regs[15]++;
+        if (last_op_zero(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_4, instr->reg_5);
+        fusion_stats->executed[FUSION_CMP_BRANCH]++;
+        NEXT();
+
+    op_cmp_bne:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_2, operand_1, 0);
+        regs[15]++;
+        if (!last_op_zero(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_4, instr->reg_5);
+        fusion_stats->executed[FUSION_CMP_BRANCH]++;
+        NEXT();
+
+    op_cmp_blt:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_2, operand_1, 0);
+        regs[15]++;
+        if (!last_op_negative(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_4, instr->reg_5);
+        fusion_stats->executed[FUSION_CMP_BRANCH]++;
+        NEXT();
+
+    op_cmp_bgt:
+        operand_1 = LOCAL_REG_VAL(instr->reg_2);
+        operand_2 = LOCAL_REG_VAL(instr->reg_3);
+        local_subtraction(regs, &last_op, operand_2, operand_1, 0);
+        regs[15]++;
+        if (last_op_negative(&last_op))
+            regs[15] = BRANCH_TARGET(instr->reg_4, instr->reg_5);
+        fusion_stats->executed[FUSION_CMP_BRANCH]++;
+        NEXT();
+
+    op_abs_load:
+        regs[11] = (uint16_t)instr->immediate;
+        regs[15] += 2;
+        fusion_stats->executed[FUSION_ABS_LOAD]++;
+        goto op_load;
+
+    op_abs_store:
+        regs[11] = (uint16_t)instr->immediate;
+        regs[15] += 2;
+        fusion_stats->executed[FUSION_ABS_STORE]++;
+        goto op_store;
+
+    burst_end:
+    #undef NEXT
+    #undef DISPATCH
+    store_local_registers(regs, cpu->registers);
+    cpu->last_op = last_op;
+    *instrs_executed = executed;
+    return halted;
+#else
+    printf("ERROR: THE THREADED INTERPRETER NEEDS LABELS AS VALUES!\n");
+    exit(-1);
+#endif
+}
+
+
+/**
+ * @brief Enables the threaded interpreter by giving the decoder the labels of its operations. Must be 
+ * called before any instruction is decoded.
+ * 
+ * @return 0 if the threaded interpreter is enabled, -1 if the compiler does not support it
+ */
+int init_threaded_core() {
+#ifdef __GNUC__
+    uint32_t instrs_executed;
+    run_threaded_burst(NULL, NULL, 0, &instrs_executed);
+    return 0;
+#else
+    return -1;
+#endif
+}
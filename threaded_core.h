@@ -0,0 +1,15 @@
+#ifndef THREADED_CORE
+#define THREADED_CORE
+
+#include <stdio.h>
+#include <stdint.h>
+#include "internal_memory.h"
+#include "registers.h"
+#include "machine.h"
+#include "os/microkernel.h"
+
+
+int init_threaded_core();
+int run_threaded_burst(Machine* machine, Process* process, uint32_t burst_len, uint32_t* instrs_executed);
+
+#endif
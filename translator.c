@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "translator.h"
+#include "os/microkernel.h"
+
+
+static const char* fusion_names[NUM_FUSION_KINDS] = { "LI16", "CMP+branch", "Absolute LOAD", "Absolute STORE" };
+static const int fusion_lengths[NUM_FUSION_KINDS] = { 2, 2, 3, 3 };
+
+
+/**
+ * @brief Makes the decode cache translate whole basic blocks when it misses, fusing common runs of
+ * instructions into superinstructions. Must be called before any instruction is decoded.
+ */
+void enable_block_translation(Machine* machine) {
+    machine->block_translation_enabled = 1;
+}
+
+
+/*
+Checks whether an instruction writes to the PC as an ordinary register, rather than by jumping or
+branching.
+*/
+int writes_pc(const DecodedInstr* instr) {
+    switch (instr->opcode) {
+        case OP_ADDC: case OP_SUBC:
+            return instr->reg_3 == 15;
+
+        case OP_ADD: case OP_SUB: case OP_ADDI: case OP_SUBI: case OP_SLL: case OP_SRL: case OP_SRA:
+        case OP_NAND: case OP_OR: case OP_LOAD: case OP_MOVUI: case OP_MOVLI: case OP_LI16: case OP_ABS_LOAD:
+            return instr->reg_1 == 15;
+
+        default:
+            return 0;
+    }
+}
+
+
+/*
+Checks whether an instruction is the last of a basic block, as the instruction after it may not be the
+next one executed.
+*/
+int ends_block(const DecodedInstr* instr) {
+    if (instr->halts || writes_pc(instr))
+        return 1;
+
+    switch (instr->opcode) {
+        case OP_JUMP: case OP_JAL: case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGT: case OP_SYSCALL:
+        case OP_INVALID: case OP_CMP_BEQ: case OP_CMP_BNE: case OP_CMP_BLT: case OP_CMP_BGT:
+            return 1;
+
+        default:
+            return 0;
+    }
+}
+
+
+/**
+ * @brief Fuses the instructions starting at an index of a block into a superinstruction, if they match
+ * one of the fused patterns. Only the first instruction is replaced, so that jumps into the middle of
+ * the run still find the instructions they land on.
+ *
+ * @param instrs The decoded instructions of the page
+ * @param index The index of the first instruction
+ * @param end The index after the last instruction of the block
+ * @param stats The fusion counts of the machine
+ */
+void fuse_instrs(DecodedInstr* instrs, uint32_t index, uint32_t end, FusionStats* stats) {
+    if (index + 1 >= end)
+        return;
+
+    DecodedInstr* first = &instrs[index];
+    DecodedInstr* second = &instrs[index + 1];
+    if (first->opcode == OP_CMP && second->opcode >= OP_BEQ && second->opcode <= OP_BGT) {
+        first->reg_4 = second->reg_2;
+        first->reg_5 = second->reg_3;
+        first->length = 2;
+        set_instr_operation(first, OP_CMP_BEQ + (second->opcode - OP_BEQ));
+        stats->fused[FUSION_CMP_BRANCH]++;
+        return;
+    }
+
+    // MOVUI into the PC jumps before the MOVLI
+    if (first->opcode != OP_MOVUI || second->opcode != OP_MOVLI || first->reg_1 != second->reg_1 || first->reg_1 == 15)
+        return;
+
+    first->immediate |= second->immediate;
+
+    DecodedInstr* access = &instrs[index + 2];
+    if (first->reg_1 == 11 && index + 2 < end && (access->opcode == OP_LOAD || access->opcode == OP_STORE)) {
+        first->reg_1 = access->reg_1;
+        first->reg_2 = access->reg_2;
+        first->reg_3 = access->reg_3;
+        first->length = 3;
+        set_instr_operation(first, access->opcode == OP_LOAD ? OP_ABS_LOAD : OP_ABS_STORE);
+        stats->fused[access->opcode == OP_LOAD ? FUSION_ABS_LOAD : FUSION_ABS_STORE]++;
+        return;
+    }
+
+    first->length = 2;
+    set_instr_operation(first, OP_LI16);
+    stats->fused[FUSION_LI16]++;
+}
+
+
+/**
+ * @brief Decodes the basic block starting at an offset in a page, which runs up to and including the
+ * first jump, branch, syscall, halt or write to the PC, or to the end of the page. Runs of instructions
+ * in the block are fused into superinstructions, and every instruction that is always followed by the
+ * one after it in the block is marked as chaining to it.
+ *
+ * @param machine The machine the block is translated for
+ * @param cpu The CPU whose decode cache the block is translated into
+ * @param instrs The decoded instructions of the page, PAGE_SIZE long
+ * @param page_addr The physical address of the first word of the page
+ * @param offset The offset of the first instruction of the block in the page
+ */
+void translate_block(Machine* machine, CPU* cpu, DecodedInstr* instrs, uint32_t page_addr, uint32_t offset) {
+    uint32_t end = offset;
+    while (end < PAGE_SIZE) {
+        decode_command(get_from_ram(machine->ram, page_addr + end), &instrs[end]);
+        if (ends_block(&instrs[end++]))
+            break;
+    }
+
+    for (uint32_t i = offset; i < end; i += instrs[i].length) {
+        fuse_instrs(instrs, i, end, cpu->fusion_stats);
+    }
+
+    // stores may overwrite the rest of the block, so it is fetched again after them
+    for (uint32_t i = offset; i < end; i++) {
+        DecodedInstr* instr = &instrs[i];
+        uint32_t next = i + instr->length;
+        instr->chains = !ends_block(instr) && instr->opcode != OP_STORE && instr->opcode != OP_ABS_STORE
+                        && next < end && !instrs[next].halts;
+    }
+
+    cpu->fusion_stats->blocks++;
+    cpu->fusion_stats->block_instrs += end - offset;
+}
+
+
+/*
+Prints how many superinstructions of each kind were formed and executed on all the CPUs of a machine, 
+and the share of instructions that were executed as part of one.
+*/
+void print_fusion_stats(Machine* machine) {
+    FusionStats total = { 0 };
+    for (int i = 0; i < machine->num_cpus; i++) {
+        FusionStats* cpu_stats = machine->cpus[i].fusion_stats;
+        total.blocks += cpu_stats->blocks;
+        total.block_instrs += cpu_stats->block_instrs;
+        total.instrs += cpu_stats->instrs;
+        for (int kind = 0; kind < NUM_FUSION_KINDS; kind++) {
+            total.fused[kind] += cpu_stats->fused[kind];
+            total.executed[kind] += cpu_stats->executed[kind];
+        }
+    }
+
+    FusionStats* stats = &total;
+    unsigned long fused_instrs = 0;
+    printf("Translated blocks: %lu\nAverage block length: %.2f\n", stats->blocks,
+        stats->blocks > 0 ? (double)stats->block_instrs / stats->blocks : 0);
+
+    printf("Superinstruction\tFormed\tExecuted\n");
+    for (int i = 0; i < NUM_FUSION_KINDS; i++) {
+        printf("%-16s\t%lu\t%lu\n", fusion_names[i], stats->fused[i], stats->executed[i]);
+        fused_instrs += stats->executed[i] * fusion_lengths[i];
+    }
+
+    printf("Fused instructions: %lu of %lu\nFusion hit rate: %.3f\n", fused_instrs, stats->instrs,
+        stats->instrs > 0 ? (double)fused_instrs / stats->instrs : 0);
+}
@@ -0,0 +1,40 @@
+#ifndef TRANSLATOR
+#define TRANSLATOR
+
+#include <stdint.h>
+#include "internal_memory.h"
+#include "machine.h"
+#include "control_unit.h"
+
+
+/*
+The patterns the translator fuses into superinstructions.
+*/
+typedef enum FusionKind {
+    FUSION_LI16, // MOVUI and MOVLI into the same register
+    FUSION_CMP_BRANCH, // CMP followed by BEQ, BNE, BLT or BGT
+    FUSION_ABS_LOAD, // MOVUI and MOVLI into $ua followed by LOAD
+    FUSION_ABS_STORE, // MOVUI and MOVLI into $ua followed by STORE
+    NUM_FUSION_KINDS
+} FusionKind;
+
+
+/**
+ * @brief Counts of the basic blocks translated and the superinstructions formed in them, along with how
+ * often each kind of superinstruction was executed.
+ */
+typedef struct FusionStats {
+    unsigned long blocks;
+    unsigned long block_instrs; // instructions in the translated blocks
+    unsigned long fused[NUM_FUSION_KINDS]; // superinstructions formed of each kind
+    unsigned long executed[NUM_FUSION_KINDS]; // superinstructions of each kind executed
+    unsigned long instrs; // instructions executed by all processes, fused or not
+} FusionStats;
+
+
+void enable_block_translation(Machine* machine);
+int writes_pc(const DecodedInstr* instr);
+void translate_block(Machine* machine, CPU* cpu, DecodedInstr* instrs, uint32_t page_addr, uint32_t offset);
+void print_fusion_stats(Machine* machine);
+
+#endif